@@ -1,7 +1,12 @@
 #include "../include/client.hh"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
+#include <vector>
+
+#include <grpcpp/completion_queue.h>
 
 namespace client {
 void ParkingManagerClient::createParkingLot() {
@@ -47,4 +52,125 @@ void ParkingManagerClient::createParkingLot() {
     std::cout << status.error_details() << std::endl;
   }
 }
-} // namespace client
\ No newline at end of file
+
+auto ParkingManagerClient::createParkingLot(const LotDescription &lot)
+    -> grpc::Status {
+  ParkingLotDetails details;
+  Status result;
+  grpc::ClientContext context;
+
+  details.set_name(lot.name);
+  details.set_levels(static_cast<int32_t>(lot.levels.size()));
+  for (const auto &capacity : lot.levels) {
+    ParkingLevelCapacity *level = details.add_level_vehicle_capacity();
+    level->set_minivan_capacity(capacity.minivan);
+    level->set_car_capacity(capacity.car);
+    level->set_motocycle_capacity(capacity.motorcycle);
+    level->set_cycle_capacity(capacity.cycle);
+  }
+  return m_stub->CreateParkingLot(&context, details, &result);
+}
+
+namespace {
+/// RPC of the replay in flight, it is its own completion queue tag
+struct ReplayCall {
+  const TraceEvent *event{nullptr};
+  std::chrono::steady_clock::time_point start;
+  grpc::ClientContext context;
+  grpc::Status status;
+  Slot slot;
+  Status released;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<Slot>> allocate;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<Status>> release;
+};
+
+/// Where a vehicle of the replay stands
+enum VehicleState { AWAY, ARRIVING, PARKED };
+} // namespace
+
+auto ParkingManagerClient::replayTrace(const Trace &trace,
+                                       const std::string &lot_id,
+                                       unsigned window) -> ReplayReport {
+  ReplayReport report;
+  grpc::CompletionQueue cq;
+  std::vector<VehicleState> vehicles(trace.vehicle_count, AWAY);
+  std::vector<std::string> parking_ids(trace.vehicle_count);
+  std::vector<uint64_t> latencies;
+  latencies.reserve(trace.events.size());
+  AllocateRequest allocate;
+  allocate.set_lot_id(lot_id);
+  ReleaseRequest release;
+  release.set_lot_id(lot_id);
+
+  auto start = std::chrono::steady_clock::now();
+  window = std::max(window, 1U);
+  std::size_t next = 0;
+  unsigned in_flight = 0;
+  while (next < trace.events.size() || in_flight > 0) {
+    while (next < trace.events.size() && in_flight < window) {
+      const TraceEvent &event = trace.events[next];
+      auto &vehicle = vehicles[event.vehicle];
+      if (event.operation == TraceOperation::RELEASE && vehicle == ARRIVING) {
+        break;
+      }
+      next++;
+      if (event.operation == TraceOperation::RELEASE && vehicle == AWAY) {
+        report.skipped++;
+        continue;
+      }
+
+      auto *call = new ReplayCall();
+      call->event = &event;
+      call->start = std::chrono::steady_clock::now();
+      if (event.operation == TraceOperation::ALLOCATE) {
+        allocate.set_vehicle_type(event.vehicle_type);
+        call->allocate =
+            m_stub->AsyncAllocateSlot(&call->context, allocate, &cq);
+        call->allocate->Finish(&call->slot, &call->status, call);
+        vehicle = ARRIVING;
+      } else {
+        release.set_parking_id(parking_ids[event.vehicle]);
+        call->release = m_stub->AsyncReleaseSlot(&call->context, release, &cq);
+        call->release->Finish(&call->released, &call->status, call);
+        vehicle = AWAY;
+      }
+      in_flight++;
+    }
+
+    void *tag = nullptr;
+    bool ok = false;
+    if (!cq.Next(&tag, &ok)) {
+      break;
+    }
+    std::unique_ptr<ReplayCall> call(static_cast<ReplayCall *>(tag));
+    in_flight--;
+    report.requests++;
+    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - call->start)
+                            .count());
+    bool succeeded = ok && call->status.ok();
+    if (!succeeded) {
+      report.failures++;
+    }
+    if (call->event->operation == TraceOperation::ALLOCATE) {
+      vehicles[call->event->vehicle] = succeeded ? PARKED : AWAY;
+      parking_ids[call->event->vehicle] = call->slot.parking_id();
+    }
+  }
+  report.elapsed = std::chrono::steady_clock::now() - start;
+  cq.Shutdown();
+
+  std::sort(latencies.begin(), latencies.end());
+  // Nearest rank: the smallest latency at least q of the requests stay within
+  auto quantile = [&latencies](double q) -> uint64_t {
+    auto rank = static_cast<std::size_t>(
+        std::ceil(q * static_cast<double>(latencies.size())));
+    return latencies[std::max<std::size_t>(rank, 1) - 1];
+  };
+  if (!latencies.empty()) {
+    report.p50_ns = quantile(0.5);
+    report.p99_ns = quantile(0.99);
+  }
+  return report;
+}
+} // namespace client
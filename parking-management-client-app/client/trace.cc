@@ -0,0 +1,115 @@
+#include "../include/trace.hh"
+
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace client {
+namespace {
+const std::unordered_map<std::string, VehicleType> vehicle_types = {
+    {"MV", VehicleType::MINIVAN},
+    {"CA", VehicleType::CAR},
+    {"MC", VehicleType::MOTORCYCLE},
+    {"CY", VehicleType::CYCLE},
+};
+
+/// Reads the lines of the file which are neither blank nor comments, calling
+/// fn with every line and its number until it returns false
+template <typename Fn>
+auto forEachLine(const std::string &path, std::string &error, Fn fn) -> bool {
+  std::ifstream file(path);
+  if (!file) {
+    error = "Unable to open " + path;
+    return false;
+  }
+  std::string line;
+  for (unsigned lineno = 1; std::getline(file, line); lineno++) {
+    std::istringstream words(line);
+    std::string keyword;
+    if (!(words >> keyword) || keyword[0] == '#') {
+      continue;
+    }
+    if (!fn(keyword, words)) {
+      error = path + ":" + std::to_string(lineno) + ": " + error;
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+auto readLotFile(const std::string &path, LotDescription &lot,
+                 std::string &error) -> bool {
+  bool read = forEachLine(
+      path, error, [&lot, &error](const std::string &keyword, auto &words) {
+        if (keyword == "name") {
+          std::getline(words >> std::ws, lot.name);
+        } else if (keyword == "level") {
+          LevelCapacity level;
+          if (!(words >> level.minivan >> level.car >> level.motorcycle >>
+                level.cycle)) {
+            error = "expected the minivan, car, motorcycle and cycle slots";
+            return false;
+          }
+          lot.levels.push_back(level);
+        } else {
+          error = "unknown keyword " + keyword;
+          return false;
+        }
+        return true;
+      });
+  if (read && lot.name.empty()) {
+    error = path + ": the lot has no name";
+    return false;
+  }
+  return read;
+}
+
+auto readTraceFile(const std::string &path, Trace &trace, std::string &error)
+    -> bool {
+  std::unordered_map<std::string, std::size_t> vehicles;
+  std::vector<bool> parked;
+  return forEachLine(path, error, [&](const std::string &keyword,
+                                      auto &words) {
+    std::string name;
+    if (!(words >> name)) {
+      error = "expected a vehicle";
+      return false;
+    }
+    auto vehicle = vehicles.emplace(name, vehicles.size()).first->second;
+    parked.resize(vehicles.size(), false);
+    trace.vehicle_count = vehicles.size();
+
+    TraceEvent event;
+    event.vehicle = vehicle;
+    if (keyword == "allocate") {
+      std::string type;
+      auto vt = vehicle_types.end();
+      if (!(words >> type) || (vt = vehicle_types.find(type)) ==
+                                  vehicle_types.end()) {
+        error = "expected a vehicle type among MV, CA, MC and CY";
+        return false;
+      }
+      if (parked[vehicle]) {
+        error = name + " is already parked";
+        return false;
+      }
+      event.operation = TraceOperation::ALLOCATE;
+      event.vehicle_type = vt->second;
+      parked[vehicle] = true;
+    } else if (keyword == "release") {
+      if (!parked[vehicle]) {
+        error = name + " is not parked";
+        return false;
+      }
+      event.operation = TraceOperation::RELEASE;
+      parked[vehicle] = false;
+    } else {
+      error = "unknown operation " + keyword;
+      return false;
+    }
+    trace.events.push_back(event);
+    return true;
+  });
+}
+} // namespace client
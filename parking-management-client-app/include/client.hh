@@ -1,15 +1,37 @@
 #ifndef CLIENT_HH
 #define CLIENT_HH
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 #include "parking_management.grpc.pb.h"
 #include "parking_management.pb.h"
+#include "trace.hh"
 #include <grpcpp/channel.h>
 #include <grpcpp/client_context.h>
 #include <grpcpp/create_channel.h>
 
 namespace client {
+/// Outcome of the replay of a Trace
+struct ReplayReport {
+  std::size_t requests{0};
+  std::size_t failures{0};
+  /// Releases left out because the allocation of their vehicle failed
+  std::size_t skipped{0};
+  std::chrono::steady_clock::duration elapsed{};
+  /// Latencies of the RPCs, from their start to their completion
+  uint64_t p50_ns{0};
+  uint64_t p99_ns{0};
+
+  [[nodiscard]] inline auto getThroughput() const -> double {
+    return static_cast<double>(requests) /
+           std::chrono::duration<double>(elapsed).count();
+  }
+};
+
 class ParkingManagerClient {
 private:
   std::unique_ptr<ParkingManager::Stub> m_stub;
@@ -20,6 +42,15 @@ public:
 
   /// Creates a parking lot via the user given parameter.
   void createParkingLot();
+
+  /// Creates the described parking lot, or adds the slots it misses
+  auto createParkingLot(const LotDescription &lot) -> grpc::Status;
+
+  /// Replays the trace against the lot, keeping up to window RPCs in flight
+  /// over the channel. An event starts once the ones before it started; a
+  /// release also waits for the allocation of its vehicle to complete.
+  auto replayTrace(const Trace &trace, const std::string &lot_id,
+                   unsigned window) -> ReplayReport;
 };
 } // namespace client
 
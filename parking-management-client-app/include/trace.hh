@@ -0,0 +1,68 @@
+#ifndef TRACE_HH
+#define TRACE_HH
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "parking_management.pb.h"
+
+namespace client {
+/// Slots of every vehicle type on a parking level
+struct LevelCapacity {
+  unsigned minivan{0};
+  unsigned car{0};
+  unsigned motorcycle{0};
+  unsigned cycle{0};
+};
+
+/// Parking lot as described by a lot file:
+///
+///     # comment
+///     name Downtown
+///     level 10 200 50 20
+///     level 0 300 0 0
+///
+/// Every level line gives the minivan, car, motorcycle and cycle slots of the
+/// next parking level.
+struct LotDescription {
+  std::string name;
+  std::vector<LevelCapacity> levels;
+};
+
+/// Reads a lot file. Returns false, with the reason in error, if the file
+/// cannot be read or is malformed.
+auto readLotFile(const std::string &path, LotDescription &lot,
+                 std::string &error) -> bool;
+
+enum TraceOperation { ALLOCATE, RELEASE };
+
+/// Step of a trace. Vehicles are numbered in the order the trace first
+/// mentions them.
+struct TraceEvent {
+  TraceOperation operation{ALLOCATE};
+  std::size_t vehicle{0};
+  VehicleType vehicle_type{VehicleType::CAR};
+};
+
+/// Allocations and releases to replay, read from a trace file:
+///
+///     # allocate <vehicle> <MV|CA|MC|CY>, release <vehicle>
+///     allocate bus-1 MV
+///     allocate KA01 CA
+///     release bus-1
+///
+/// A vehicle is released with the slot it was allocated last.
+struct Trace {
+  std::vector<TraceEvent> events;
+  std::size_t vehicle_count{0};
+};
+
+/// Reads a trace file. Returns false, with the reason in error, if the file
+/// cannot be read or is malformed, or if a vehicle is allocated twice or
+/// released while not parked.
+auto readTraceFile(const std::string &path, Trace &trace, std::string &error)
+    -> bool;
+} // namespace client
+
+#endif // TRACE_HH
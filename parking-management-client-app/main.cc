@@ -1,10 +1,120 @@
 #include "include/client.hh"
+#include "include/trace.hh"
 #include "parking_management.grpc.pb.h"
 #include "parking_management.pb.h"
 
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+/// Client options read from the command line. Without a lot file nor a
+/// trace the client asks the user for the lot to create.
+struct ClientOptions {
+  std::string server_address{"localhost:50051"};
+  std::string lot_file;
+  std::string trace_file;
+  /// Lot the trace is replayed against, the one of the lot file by default
+  std::string lot_id;
+  /// RPCs kept in flight by the replay
+  unsigned window{64};
+};
+
+void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--address=HOST:PORT] [--lot-file=PATH] [--trace=PATH]"
+               " [--lot=NAME] [--window=N]"
+            << std::endl;
+}
+
+/// Parses the command line, returns false on an unknown or malformed option
+auto parseOptions(int argc, char **argv, ClientOptions &options) -> bool {
+  constexpr std::string_view address_flag = "--address=";
+  constexpr std::string_view lot_file_flag = "--lot-file=";
+  constexpr std::string_view trace_flag = "--trace=";
+  constexpr std::string_view lot_flag = "--lot=";
+  constexpr std::string_view window_flag = "--window=";
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    auto matches = [&arg](std::string_view flag) {
+      return arg.substr(0, flag.size()) == flag;
+    };
+    if (matches(address_flag)) {
+      options.server_address = arg.substr(address_flag.size());
+    } else if (matches(lot_file_flag)) {
+      options.lot_file = arg.substr(lot_file_flag.size());
+    } else if (matches(trace_flag)) {
+      options.trace_file = arg.substr(trace_flag.size());
+    } else if (matches(lot_flag)) {
+      options.lot_id = arg.substr(lot_flag.size());
+    } else if (matches(window_flag)) {
+      try {
+        long window = std::stol(std::string(arg.substr(window_flag.size())));
+        if (window < 1) {
+          return false;
+        }
+        options.window = static_cast<unsigned>(window);
+      } catch (const std::exception &) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
 auto main(int argc, char **argv) -> int {
+  ClientOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
   client::ParkingManagerClient pm(grpc::CreateChannel(
-      "localhost:50051", grpc::InsecureChannelCredentials()));
-  pm.createParkingLot();
+      options.server_address, grpc::InsecureChannelCredentials()));
+  if (options.lot_file.empty() && options.trace_file.empty()) {
+    pm.createParkingLot();
+    return 0;
+  }
+
+  std::string error;
+  if (!options.lot_file.empty()) {
+    client::LotDescription lot;
+    if (!client::readLotFile(options.lot_file, lot, error)) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+    auto status = pm.createParkingLot(lot);
+    if (!status.ok()) {
+      std::cerr << "Unable to create the lot: " << status.error_message()
+                << std::endl;
+      return 1;
+    }
+    std::cout << "Parking lot " << lot.name << " created with "
+              << lot.levels.size() << " levels" << std::endl;
+    if (options.lot_id.empty()) {
+      options.lot_id = lot.name;
+    }
+  }
+
+  if (!options.trace_file.empty()) {
+    client::Trace trace;
+    if (!client::readTraceFile(options.trace_file, trace, error)) {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+    auto report = pm.replayTrace(trace, options.lot_id, options.window);
+    std::cout << "Replayed " << report.requests << " requests, "
+              << report.failures << " failed, " << report.skipped
+              << " skipped in "
+              << std::chrono::duration<double>(report.elapsed).count()
+              << " s: " << static_cast<uint64_t>(report.getThroughput())
+              << " req/s, p50 " << report.p50_ns / 1000 << " us, p99 "
+              << report.p99_ns / 1000 << " us with a window of "
+              << options.window << std::endl;
+  }
   return 0;
-}
\ No newline at end of file
+}
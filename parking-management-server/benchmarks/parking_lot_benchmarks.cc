@@ -0,0 +1,606 @@
+#include <sqlite3.h>
+
+#include <array>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "../include/parking.hh"
+#include "benchmark/benchmark.h"
+
+namespace {
+constexpr const char *benchmark_lot = "Benchmark";
+
+/// Populates the lot with the requested number of car slots at level 0
+void populate(component::ParkingLot &parkinglot, int64_t slots) {
+  parkinglot.deleteParkingSlots();
+  for (int64_t i = 0; i < slots; i++) {
+    parkinglot.addParking("0_CA_A_" + std::to_string(i));
+  }
+}
+
+/// Unique ids of the requested number of car slots spread over 20 levels
+auto makeUniqueIds(int64_t slots) -> std::vector<std::string> {
+  std::vector<std::string> unique_ids;
+  unique_ids.reserve(slots);
+  for (int64_t i = 0; i < slots; i++) {
+    unique_ids.push_back(std::to_string(i % 20) + "_CA_B_" +
+                         std::to_string(i / 20));
+  }
+  return unique_ids;
+}
+
+/// Opens the lot of the scale benchmarks with the requested number of car
+/// slots spread over 20 levels. The slots stay in its DB from one run to the
+/// next, so that every size is only provisioned once.
+auto openScaleLot(int64_t slots) -> std::unique_ptr<component::ParkingLot> {
+  auto parkinglot = std::make_unique<component::ParkingLot>("ScaleBenchmark",
+                                                            20);
+  if (parkinglot->getTotalAvailableParking() != static_cast<unsigned>(slots) ||
+      parkinglot->getTotalOccupiedParking() != 0) {
+    parkinglot->deleteParkingSlots();
+    auto unique_ids = makeUniqueIds(slots);
+    parkinglot->addParkingBatch(unique_ids.begin(), unique_ids.end());
+  }
+  return parkinglot;
+}
+
+/// Counter queries of ParkingLot
+enum CounterQuery {
+  TOTAL_AVAILABLE,
+  TOTAL_OCCUPIED,
+  TOTAL_HELD,
+  AVAILABLE_AT_LEVEL,
+  OCCUPIED_AT_LEVEL,
+  AVAILABLE_FOR_VEHICLE_TYPE,
+  OCCUPIED_FOR_VEHICLE_TYPE,
+  AVAILABLE_FOR_VEHICLE_TYPE_AT_LEVEL,
+  OCCUPIED_FOR_VEHICLE_TYPE_AT_LEVEL,
+  COUNTER_QUERY_COUNT
+};
+
+const std::array<const char *, COUNTER_QUERY_COUNT> counter_query_names = {
+    "total_available",
+    "total_occupied",
+    "total_held",
+    "available_at_level",
+    "occupied_at_level",
+    "available_for_vehicle_type",
+    "occupied_for_vehicle_type",
+    "available_for_vehicle_type_at_level",
+    "occupied_for_vehicle_type_at_level",
+};
+/// The regex based parser ParkingIdParser used to be, kept as a baseline
+class LegacyParkingIdParser {
+private:
+  enum States { PARKING_ID, PARKING_LEVEL, VEHICLE_TYPE, TOTAL_STATE };
+  inline static component::ParkingSlot m_parking_slot;
+  const inline static std::array<std::function<void(std::string)>,
+                                 States::TOTAL_STATE>
+      m_state_fptr = {
+          [](std::string unique_id) {
+            m_parking_slot.setParkingSlotId(std::move(unique_id));
+          },
+          [](const std::string &level) {
+            m_parking_slot.setParkingLevel(std::stoi(level));
+          },
+          [](const std::string &vehicle_type) {
+            m_parking_slot.setVehicleType(
+                component::m_vtstr_vt_map.find(vehicle_type)->second);
+          },
+  };
+
+public:
+  static auto parse(std::string unique_id) -> component::ParkingSlot {
+    m_state_fptr.at(static_cast<unsigned>(States::PARKING_ID))(unique_id);
+    std::regex re("_");
+    std::sregex_token_iterator it(unique_id.begin(), unique_id.end(), re, -1);
+    for (auto index = static_cast<unsigned>(States::PARKING_LEVEL);
+         index < static_cast<unsigned>(States::TOTAL_STATE); index++, it++) {
+      m_state_fptr.at(index)(*it);
+    }
+    return m_parking_slot;
+  }
+};
+} // namespace
+
+/// Parsing a unique_id with the regex based parser
+static void BM_LegacyParkingIdParse(benchmark::State &state) {
+  std::string unique_id = "12_CA_B_1234";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LegacyParkingIdParser::parse(unique_id));
+  }
+}
+BENCHMARK(BM_LegacyParkingIdParse);
+
+/// Parsing a unique_id with ParkingIdParser
+static void BM_ParkingIdParse(benchmark::State &state) {
+  std::string unique_id = "12_CA_B_1234";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(component::ParkingIdParser::parse(unique_id));
+  }
+}
+BENCHMARK(BM_ParkingIdParse);
+
+/// Per call latency of a counter query compiling its SQL on every call, the
+/// way ParkingLot used to do it
+static void BM_CountPreparedPerCall(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 1);
+  populate(parkinglot, state.range(0));
+
+  sqlite3 *db = nullptr;
+  sqlite3_open((std::string(benchmark_lot) + ".db").c_str(), &db);
+  for (auto _ : state) {
+    sqlite3_stmt *sql_stmt = nullptr;
+    std::string command = "select count (parking_id) from parking "
+                          "where occupied_status = false and parking_level = ?";
+    sqlite3_prepare_v2(db, command.c_str(), -1, &sql_stmt, nullptr);
+    sqlite3_bind_int(sql_stmt, 1, 0);
+    sqlite3_step(sql_stmt);
+    benchmark::DoNotOptimize(sqlite3_column_int(sql_stmt, 0));
+    sqlite3_finalize(sql_stmt);
+  }
+  sqlite3_close(db);
+}
+BENCHMARK(BM_CountPreparedPerCall)->Arg(16)->Arg(256);
+
+/// Per call latency of the same counter query served from the statement cache
+static void BM_CountCachedStatement(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 1);
+  populate(parkinglot, state.range(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(parkinglot.getAvailableParkingAtLevel(0));
+  }
+}
+BENCHMARK(BM_CountCachedStatement)->Arg(16)->Arg(256);
+
+/// Latency of a full allocate and return cycle
+static void BM_GetReturnParking(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 1);
+  populate(parkinglot, state.range(0));
+
+  for (auto _ : state) {
+    auto slot = parkinglot.getParking(component::VehicleType::CAR);
+    parkinglot.returnParking(slot.getData());
+  }
+}
+BENCHMARK(BM_GetReturnParking)->Arg(16)->Arg(256);
+
+/// Latency of a full allocate and return cycle for every Durability
+static void BM_GetReturnParkingDurability(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 1);
+  parkinglot.setDurability(
+      static_cast<component::Durability>(state.range(0)));
+  populate(parkinglot, 256);
+
+  for (auto _ : state) {
+    auto slot = parkinglot.getParking(component::VehicleType::CAR);
+    parkinglot.returnParking(slot.getData());
+  }
+}
+BENCHMARK(BM_GetReturnParkingDurability)
+    ->Arg(component::Durability::PER_EVENT)
+    ->Arg(component::Durability::GROUP)
+    ->Arg(component::Durability::PERIODIC);
+
+/// Allocating and returning a batch of cars at once, the way a gate
+/// controller draining its queue does
+static void BM_GetReturnParkingBatch(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 1);
+  populate(parkinglot, 256);
+  std::vector<component::VehicleType> vehicle_types(
+      state.range(0), component::VehicleType::CAR);
+  std::vector<component::SlotKey> keys;
+  keys.reserve(vehicle_types.size());
+
+  for (auto _ : state) {
+    auto slots =
+        parkinglot.getParkings(vehicle_types.begin(), vehicle_types.end());
+    keys.clear();
+    for (const auto &slot : slots) {
+      keys.push_back(slot.getData().getSlotKey());
+    }
+    benchmark::DoNotOptimize(
+        parkinglot.returnParkings(keys.begin(), keys.end()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetReturnParkingBatch)->Arg(1)->Arg(16)->Arg(128);
+
+/// Provisioning a lot one slot at a time, every slot in its own transaction
+static void BM_AddParking(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 20);
+  auto unique_ids = makeUniqueIds(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    parkinglot.deleteParkingSlots();
+    state.ResumeTiming();
+    for (const auto &unique_id : unique_ids) {
+      parkinglot.addParking(unique_id);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddParking)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+/// Provisioning a lot in a single transaction
+static void BM_AddParkingBatch(benchmark::State &state) {
+  component::ParkingLot parkinglot(benchmark_lot, 20);
+  auto unique_ids = makeUniqueIds(state.range(0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    parkinglot.deleteParkingSlots();
+    state.ResumeTiming();
+    parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddParkingBatch)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+/// Latency of an allocate and return cycle against the size of the lot, half
+/// of its slots occupied. The journal is synced periodically so that the cost
+/// of the lot itself shows rather than the one of the sync.
+static void BM_GetReturnParkingScale(benchmark::State &state) {
+  auto parkinglot = openScaleLot(state.range(0));
+  parkinglot->setDurability(component::Durability::PERIODIC);
+  std::vector<component::VehicleType> vehicle_types(
+      state.range(0) / 2, component::VehicleType::CAR);
+  std::vector<component::SlotKey> keys;
+  keys.reserve(vehicle_types.size());
+  for (const auto &slot :
+       parkinglot->getParkings(vehicle_types.begin(), vehicle_types.end())) {
+    keys.push_back(slot.getData().getSlotKey());
+  }
+
+  for (auto _ : state) {
+    auto slot = parkinglot->getParking(component::VehicleType::CAR);
+    parkinglot->returnParking(slot.getData());
+  }
+  parkinglot->returnParkings(keys.begin(), keys.end());
+}
+BENCHMARK(BM_GetReturnParkingScale)->RangeMultiplier(10)->Range(1000, 1000000);
+
+/// Latency of every counter query against the size of the lot, arguments are
+/// the CounterQuery and the number of slots. The queries vary fastest, so that
+/// the lot is provisioned once per size.
+static void BM_CounterQuery(benchmark::State &state) {
+  auto query = static_cast<CounterQuery>(state.range(0));
+  auto parkinglot = openScaleLot(state.range(1));
+  const auto vt = component::VehicleType::CAR;
+  const unsigned level = 10;
+
+  for (auto _ : state) {
+    switch (query) {
+    case TOTAL_AVAILABLE:
+      benchmark::DoNotOptimize(parkinglot->getTotalAvailableParking());
+      break;
+    case TOTAL_OCCUPIED:
+      benchmark::DoNotOptimize(parkinglot->getTotalOccupiedParking());
+      break;
+    case TOTAL_HELD:
+      benchmark::DoNotOptimize(parkinglot->getTotalHeldParking());
+      break;
+    case AVAILABLE_AT_LEVEL:
+      benchmark::DoNotOptimize(parkinglot->getAvailableParkingAtLevel(level));
+      break;
+    case OCCUPIED_AT_LEVEL:
+      benchmark::DoNotOptimize(parkinglot->getOccupiedParkingAtLevel(level));
+      break;
+    case AVAILABLE_FOR_VEHICLE_TYPE:
+      benchmark::DoNotOptimize(
+          parkinglot->getAvailableParkingForVehicleType(vt));
+      break;
+    case OCCUPIED_FOR_VEHICLE_TYPE:
+      benchmark::DoNotOptimize(
+          parkinglot->getOccupiedParkingForVehicleType(vt));
+      break;
+    case AVAILABLE_FOR_VEHICLE_TYPE_AT_LEVEL:
+      benchmark::DoNotOptimize(
+          parkinglot->getAvailableParkingForVehicleTypeAtLevel(level, vt));
+      break;
+    case OCCUPIED_FOR_VEHICLE_TYPE_AT_LEVEL:
+      benchmark::DoNotOptimize(
+          parkinglot->getOccupiedParkingForVehicleTypeAtLevel(level, vt));
+      break;
+    default:
+      break;
+    }
+  }
+  state.SetLabel(counter_query_names[query]);
+}
+BENCHMARK(BM_CounterQuery)
+    ->ArgsProduct({benchmark::CreateDenseRange(0, COUNTER_QUERY_COUNT - 1, 1),
+                   benchmark::CreateRange(1000, 1000000, 10)});
+
+/// Exporting a lot of a million slots, a tenth of them occupied, the argument
+/// being the ExportFormat. The sink only counts the bytes.
+static void BM_ExportSlots(benchmark::State &state) {
+  auto format = static_cast<component::ExportFormat>(state.range(0));
+  auto parkinglot = openScaleLot(1000000);
+  std::vector<component::SlotKey> keys;
+  for (unsigned i = 0; i < 100000; i++) {
+    auto slot = parkinglot->getParking(component::VehicleType::CAR);
+    keys.push_back(slot.getData().getSlotKey());
+  }
+
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        parkinglot->exportSlots(format, [&bytes](std::string_view chunk) {
+          bytes += chunk.size();
+          return true;
+        }));
+  }
+  parkinglot->returnParkings(keys.begin(), keys.end());
+  state.SetBytesProcessed(static_cast<int64_t>(bytes));
+  state.SetItemsProcessed(state.iterations() * 1000000);
+  state.SetLabel(component::export_format_names.at(format).data());
+}
+BENCHMARK(BM_ExportSlots)
+    ->DenseRange(0, component::TOTAL_EXPORT_FORMAT - 1, 1)
+    ->Unit(benchmark::kMillisecond);
+
+/// Opening a provisioned lot. With snapshot set the lot boots from its
+/// snapshot, otherwise the snapshot is dropped and the lot reads the DB.
+static void openLot(benchmark::State &state, bool snapshot) {
+  constexpr const char *boot_lot = "BootBenchmark";
+  {
+    component::ParkingLot parkinglot(boot_lot, 20);
+    if (parkinglot.getTotalAvailableParking() !=
+        static_cast<unsigned>(state.range(0))) {
+      parkinglot.deleteParkingSlots();
+      auto unique_ids = makeUniqueIds(state.range(0));
+      parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+    }
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    if (!snapshot) {
+      std::remove((std::string(boot_lot) + ".snapshot").c_str());
+    }
+    state.ResumeTiming();
+    auto parkinglot = std::make_unique<component::ParkingLot>(boot_lot, 20);
+    benchmark::DoNotOptimize(parkinglot->getTotalAvailableParking());
+    state.PauseTiming();
+    parkinglot.reset();
+    state.ResumeTiming();
+  }
+}
+
+static void BM_OpenFromDB(benchmark::State &state) { openLot(state, false); }
+BENCHMARK(BM_OpenFromDB)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_OpenFromSnapshot(benchmark::State &state) {
+  openLot(state, true);
+}
+BENCHMARK(BM_OpenFromSnapshot)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+/// Counting the occupied slots of a bitmap, arguments are the kernel and the
+/// number of bits
+static void BM_BitmapCount(benchmark::State &state) {
+  auto kernel = static_cast<component::OccupancyBitmap::Kernel>(state.range(0));
+  if (!component::OccupancyBitmap::setKernel(kernel)) {
+    state.SkipWithError("Kernel not supported");
+    return;
+  }
+  component::OccupancyBitmap bitmap;
+  for (int64_t i = 0; i < state.range(1); i++) {
+    bitmap.push_back(i % 3 == 0);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bitmap.count());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(1) / 8);
+}
+BENCHMARK(BM_BitmapCount)
+    ->ArgsProduct({{component::OccupancyBitmap::SCALAR,
+                    component::OccupancyBitmap::AVX2},
+                   {1 << 10, 1 << 20}});
+
+/// Allocating and releasing the only free slot of a full level, arguments
+/// are the kernel and the number of slots
+static void BM_AllocateNearlyFull(benchmark::State &state) {
+  auto kernel = static_cast<component::OccupancyBitmap::Kernel>(state.range(0));
+  if (!component::OccupancyBitmap::setKernel(kernel)) {
+    state.SkipWithError("Kernel not supported");
+    return;
+  }
+  component::OccupancyEngine engine;
+  for (int64_t i = 0; i < state.range(1); i++) {
+    auto slot = component::makeParkingSlot("0_CA_A_" + std::to_string(i));
+    if (i != state.range(1) - 1) {
+      slot.setParkingTime(1);
+    }
+    engine.addSlot(slot);
+  }
+  for (auto _ : state) {
+    auto slot = engine.allocate(component::VehicleType::CAR, 1);
+    // Releasing moves the search back to the start of the bitmap
+    engine.release(component::SlotKey::parse("0_CA_A_0").getData());
+    benchmark::DoNotOptimize(engine.allocate(component::VehicleType::CAR, 1));
+    engine.release(slot.getData().getSlotKey());
+  }
+}
+BENCHMARK(BM_AllocateNearlyFull)
+    ->ArgsProduct({{component::OccupancyBitmap::SCALAR,
+                    component::OccupancyBitmap::AVX2},
+                   {1 << 10, 1 << 16}});
+
+/// Steady state allocations at half occupancy over 20 levels of 1000 car
+/// slots each, the argument being the SlotSelection. Every iteration
+/// allocates a slot and releases the oldest one.
+static void BM_AllocateSelection(benchmark::State &state) {
+  constexpr unsigned levels = 20;
+  constexpr unsigned slots_per_level = 1000;
+  component::OccupancyEngine engine;
+  engine.setSlotSelection(
+      static_cast<component::SlotSelection>(state.range(0)));
+  for (unsigned level = 0; level < levels; level++) {
+    for (unsigned number = 0; number < slots_per_level; number++) {
+      engine.addSlot(component::makeParkingSlot(
+          std::to_string(level) + "_CA_" + (number % 2 == 0 ? "A" : "B") +
+          "_" + std::to_string(number)));
+    }
+  }
+
+  std::deque<component::SlotKey> occupied;
+  for (unsigned i = 0; i < levels * slots_per_level / 2; i++) {
+    occupied.push_back(
+        engine.allocate(component::VehicleType::CAR, 1).getData().getSlotKey());
+  }
+  for (auto _ : state) {
+    occupied.push_back(
+        engine.allocate(component::VehicleType::CAR, 1).getData().getSlotKey());
+    engine.release(occupied.front());
+    occupied.pop_front();
+  }
+}
+BENCHMARK(BM_AllocateSelection)
+    ->Arg(component::SlotSelection::LOWEST_LEVEL)
+    ->Arg(component::SlotSelection::LEAST_LOADED_LEVEL)
+    ->Arg(component::SlotSelection::ZONE_PACKING)
+    ->Arg(component::SlotSelection::NEAREST_ENTRANCE);
+
+/// One tick of the hold expiry with the given number of pending holds, spread
+/// over five minutes of 100 ms ticks. Every expired hold is scheduled again
+/// so that the number of pending holds stays the same.
+static void BM_TimerWheelTick(benchmark::State &state) {
+  constexpr uint64_t spread = 3000;
+  component::TimerWheel wheel;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    wheel.schedule(1 + static_cast<uint64_t>(i) * 7919 % spread,
+                   static_cast<uint64_t>(i));
+  }
+  std::vector<uint64_t> expired;
+  for (auto _ : state) {
+    wheel.advance(wheel.getNow() + 1, [&expired](uint64_t payload) {
+      expired.push_back(payload);
+    });
+    for (auto payload : expired) {
+      wheel.schedule(wheel.getNow() + spread, payload);
+    }
+    expired.clear();
+  }
+}
+BENCHMARK(BM_TimerWheelTick)->Arg(1 << 10)->Arg(1 << 16);
+
+namespace {
+/// Day and night rates for every vehicle type, capped daily
+auto makeTariff() -> component::Tariff {
+  component::TariffConfig config;
+  for (auto &vehicle : config.vehicles) {
+    vehicle.bands = {{0, 24 * 60, 100}, {7 * 60, 19 * 60, 250}};
+    vehicle.daily_cap_cents = 2400;
+  }
+  return component::Tariff::compile(config).getData();
+}
+
+/// A day of sessions of up to three hours
+auto makeSessions(std::size_t count) -> std::vector<component::Session> {
+  std::vector<component::Session> sessions(count);
+  for (std::size_t i = 0; i < count; i++) {
+    sessions[i].key = component::SlotKey::parse("0_CA_A_0").getData();
+    sessions[i].occupied_at = static_cast<std::time_t>(i * 86400 / count);
+    sessions[i].released_at =
+        sessions[i].occupied_at + static_cast<std::time_t>(i * 7919 % 10800);
+  }
+  return sessions;
+}
+} // namespace
+
+/// Pricing a single session
+static void BM_PriceSession(benchmark::State &state) {
+  auto tariff = makeTariff();
+  auto sessions = makeSessions(1024);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    tariff.price(sessions[i++ % sessions.size()]);
+  }
+  benchmark::DoNotOptimize(sessions.data());
+}
+BENCHMARK(BM_PriceSession);
+
+/// Settling a million sessions, the argument being the number of workers of
+/// the pool, which the calling thread joins
+static void BM_SettleSessions(benchmark::State &state) {
+  auto tariff = makeTariff();
+  auto sessions = makeSessions(1 << 20);
+  component::ThreadPool pool(static_cast<unsigned>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tariff.settle(sessions, pool));
+  }
+  state.SetItemsProcessed(state.iterations() * sessions.size());
+}
+BENCHMARK(BM_SettleSessions)
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/// Reading a log of a million sessions back, the argument being the rows per
+/// chunk
+static void BM_ReadSessionLog(benchmark::State &state) {
+  constexpr const char *path = "Benchmark.sessions";
+  std::remove(path);
+  {
+    component::SessionLog log;
+    log.open(path);
+    for (const auto &session : makeSessions(1 << 20)) {
+      log.append(session);
+    }
+  }
+  for (auto _ : state) {
+    uint64_t revenue = 0;
+    component::SessionLog::read(
+        path, static_cast<std::size_t>(state.range(0)),
+        [&revenue](const component::SessionChunk &chunk) {
+          for (auto fee : chunk.fees_cents) {
+            revenue += fee;
+          }
+        });
+    benchmark::DoNotOptimize(revenue);
+  }
+  state.SetItemsProcessed(state.iterations() * (1 << 20));
+}
+BENCHMARK(BM_ReadSessionLog)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Unit(benchmark::kMillisecond);
+
+/// Cost of counting an event, on as many threads as the argument
+static void BM_MetricsCount(benchmark::State &state) {
+  for (auto _ : state) {
+    component::Metrics::add(component::Counter::ALLOCATIONS);
+  }
+}
+BENCHMARK(BM_MetricsCount)->ThreadRange(1, 4);
+
+/// Cost of timing an operation with a ScopedLatency, clock reads included
+static void BM_MetricsScopedLatency(benchmark::State &state) {
+  for (auto _ : state) {
+    component::ScopedLatency latency(component::Histogram::LOT_GET_PARKING);
+  }
+}
+BENCHMARK(BM_MetricsScopedLatency)->ThreadRange(1, 4);
@@ -0,0 +1,105 @@
+#include "../include/billing.hh"
+
+#include <algorithm>
+
+namespace component {
+namespace {
+constexpr int64_t seconds_per_minute = 60;
+constexpr int64_t minutes_per_hour = 60;
+
+/// Sessions below which settling on another thread does not pay off
+constexpr std::size_t min_settle_chunk = 4096;
+
+[[nodiscard]] auto floor_div(int64_t value, int64_t divisor) -> int64_t {
+  int64_t quotient = value / divisor;
+  return quotient * divisor > value ? quotient - 1 : quotient;
+}
+} // namespace
+
+[[nodiscard]] auto Tariff::compile(const TariffConfig &config)
+    -> utils::StatusOr<Tariff> {
+  Tariff tariff;
+  tariff.m_utc_offset = config.utc_offset_seconds;
+  std::array<uint32_t, MINUTES_PER_DAY> rates{};
+  for (unsigned vt = 0; vt < VehicleType::TOTALVEHICLETYPE; vt++) {
+    const auto &vehicle = config.vehicles[vt];
+    rates.fill(0);
+    for (const auto &band : vehicle.bands) {
+      if (band.start_minute >= band.end_minute ||
+          band.end_minute > MINUTES_PER_DAY) {
+        return utils::StatusOr<Tariff>(utils::Status::UNAVAILABLE);
+      }
+      std::fill(rates.begin() + band.start_minute,
+                rates.begin() + band.end_minute, band.cents_per_hour);
+    }
+
+    auto &running_cost = tariff.m_running_cost[vt];
+    running_cost[0] = 0;
+    for (unsigned minute = 0; minute < MINUTES_PER_DAY; minute++) {
+      running_cost[minute + 1] = running_cost[minute] + rates[minute];
+    }
+    tariff.m_daily_cap[vt] = vehicle.daily_cap_cents;
+  }
+  return utils::StatusOr<Tariff>(std::move(tariff));
+}
+
+[[nodiscard]] auto Tariff::priceDay(const VehicleType &vt, unsigned from,
+                                    unsigned to) const -> uint64_t {
+  const auto &running_cost = m_running_cost[vt];
+  uint64_t cost = running_cost[to] - running_cost[from];
+  // Round the last fraction of a cent up
+  cost = (cost + minutes_per_hour - 1) / minutes_per_hour;
+  return m_daily_cap[vt] != 0 ? std::min(cost, m_daily_cap[vt]) : cost;
+}
+
+[[nodiscard]] auto Tariff::price(const VehicleType &vt,
+                                 std::time_t occupied_at,
+                                 std::time_t released_at) const -> uint64_t {
+  if (vt >= VehicleType::TOTALVEHICLETYPE || released_at <= occupied_at) {
+    return 0;
+  }
+
+  // Minutes since the local epoch, the one started last included
+  int64_t from = floor_div(occupied_at + m_utc_offset, seconds_per_minute);
+  int64_t to = floor_div(released_at + m_utc_offset + seconds_per_minute - 1,
+                         seconds_per_minute);
+  int64_t first_day = floor_div(from, MINUTES_PER_DAY);
+  int64_t last_day = floor_div(to - 1, MINUTES_PER_DAY);
+  auto from_minute = static_cast<unsigned>(from - first_day * MINUTES_PER_DAY);
+  auto to_minute = static_cast<unsigned>(to - last_day * MINUTES_PER_DAY);
+  if (first_day == last_day) {
+    return priceDay(vt, from_minute, to_minute);
+  }
+
+  uint64_t full_days = static_cast<uint64_t>(last_day - first_day - 1);
+  return priceDay(vt, from_minute, MINUTES_PER_DAY) +
+         full_days * priceDay(vt, 0, MINUTES_PER_DAY) +
+         priceDay(vt, 0, to_minute);
+}
+
+auto Tariff::settle(std::vector<Session> &sessions, ThreadPool &pool) const
+    -> uint64_t {
+  std::size_t chunks = std::max<std::size_t>(
+      1, std::min(pool.size() + 1, sessions.size() / min_settle_chunk));
+  std::size_t chunk_size = (sessions.size() + chunks - 1) / chunks;
+  std::vector<uint64_t> totals(chunks, 0);
+  pool.parallelFor(chunks, [this, &sessions, &totals,
+                            chunk_size](std::size_t i) {
+    auto first = sessions.begin() + std::min(i * chunk_size, sessions.size());
+    auto last =
+        sessions.begin() + std::min((i + 1) * chunk_size, sessions.size());
+    uint64_t total = 0;
+    for (; first != last; ++first) {
+      price(*first);
+      total += first->fee_cents;
+    }
+    totals[i] = total;
+  });
+
+  uint64_t total = 0;
+  for (auto chunk_total : totals) {
+    total += chunk_total;
+  }
+  return total;
+}
+} // namespace component
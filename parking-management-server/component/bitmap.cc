@@ -0,0 +1,166 @@
+#include "../include/bitmap.hh"
+
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAS_X86_KERNELS 1
+#endif
+
+namespace component {
+namespace {
+using PopcountFn = std::size_t (*)(const uint64_t *words, std::size_t count);
+/// Index of the first word having a clear bit, count if all are full
+using FindNotFullFn = std::size_t (*)(const uint64_t *words,
+                                      std::size_t count);
+
+auto popcountScalar(const uint64_t *words, std::size_t count) -> std::size_t {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    total += __builtin_popcountll(words[i]);
+  }
+  return total;
+}
+
+auto findNotFullScalar(const uint64_t *words, std::size_t count)
+    -> std::size_t {
+  for (std::size_t i = 0; i < count; i++) {
+    if (words[i] != ~0ULL) {
+      return i;
+    }
+  }
+  return count;
+}
+
+#ifdef HAS_X86_KERNELS
+/// Counts the bits of 32 bytes at a time with a nibble lookup table and sums
+/// the bytes of every 64 bit lane with a sum of absolute differences
+__attribute__((target("avx2"))) auto popcountAvx2(const uint64_t *words,
+                                                  std::size_t count)
+    -> std::size_t {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i total = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+    __m256i low = _mm256_and_si256(chunk, low_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), low_mask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                    _mm256_shuffle_epi8(lookup, high));
+    total = _mm256_add_epi64(total,
+                             _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+  }
+  std::size_t result = _mm256_extract_epi64(total, 0) +
+                       _mm256_extract_epi64(total, 1) +
+                       _mm256_extract_epi64(total, 2) +
+                       _mm256_extract_epi64(total, 3);
+  return result + popcountScalar(words + i, count - i);
+}
+
+/// Compares 4 words at a time against all ones
+__attribute__((target("avx2"))) auto findNotFullAvx2(const uint64_t *words,
+                                                     std::size_t count)
+    -> std::size_t {
+  const __m256i full = _mm256_set1_epi64x(-1);
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+    __m256i full_words = _mm256_cmpeq_epi64(chunk, full);
+    auto full_lanes = static_cast<unsigned>(
+        _mm256_movemask_pd(_mm256_castsi256_pd(full_words)));
+    if (full_lanes != 0xf) {
+      return i + __builtin_ctz(~full_lanes);
+    }
+  }
+  return i + findNotFullScalar(words + i, count - i);
+}
+#endif
+
+struct Kernels {
+  PopcountFn popcount;
+  FindNotFullFn find_not_full;
+};
+
+constexpr Kernels kernels[OccupancyBitmap::TOTAL_KERNEL] = {
+    {popcountScalar, findNotFullScalar},
+#ifdef HAS_X86_KERNELS
+    {popcountAvx2, findNotFullAvx2},
+#else
+    {popcountScalar, findNotFullScalar},
+#endif
+};
+
+auto selectKernel() -> OccupancyBitmap::Kernel {
+  return OccupancyBitmap::isSupported(OccupancyBitmap::AVX2)
+             ? OccupancyBitmap::AVX2
+             : OccupancyBitmap::SCALAR;
+}
+
+auto activeKernel() -> std::atomic<OccupancyBitmap::Kernel> & {
+  static std::atomic<OccupancyBitmap::Kernel> kernel{selectKernel()};
+  return kernel;
+}
+
+auto getKernels() -> const Kernels & {
+  return kernels[activeKernel().load(std::memory_order_relaxed)];
+}
+} // namespace
+
+[[nodiscard]] auto OccupancyBitmap::count() const -> std::size_t {
+  return getKernels().popcount(m_words.data(), m_words.size());
+}
+
+[[nodiscard]] auto OccupancyBitmap::findFirstZero(std::size_t from) const
+    -> std::size_t {
+  if (from >= m_size) {
+    return npos;
+  }
+
+  // The first word may have clear bits before from, mask them as set
+  std::size_t word = from / WORD_BITS;
+  uint64_t first = m_words[word] | ((1ULL << (from % WORD_BITS)) - 1);
+  if (first == ~0ULL) {
+    word++;
+    word += getKernels().find_not_full(m_words.data() + word,
+                                       m_words.size() - word);
+    if (word == m_words.size()) {
+      return npos;
+    }
+    first = m_words[word];
+  }
+  std::size_t index = word * WORD_BITS + __builtin_ctzll(~first);
+  return index < m_size ? index : npos;
+}
+
+[[nodiscard]] auto OccupancyBitmap::getKernel() -> Kernel {
+  return activeKernel().load(std::memory_order_relaxed);
+}
+
+auto OccupancyBitmap::setKernel(Kernel kernel) -> bool {
+  if (!isSupported(kernel)) {
+    return false;
+  }
+  activeKernel().store(kernel, std::memory_order_relaxed);
+  return true;
+}
+
+[[nodiscard]] auto OccupancyBitmap::isSupported(Kernel kernel) -> bool {
+  switch (kernel) {
+  case Kernel::SCALAR:
+    return true;
+  case Kernel::AVX2:
+#ifdef HAS_X86_KERNELS
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  default:
+    return false;
+  }
+}
+} // namespace component
@@ -0,0 +1,160 @@
+#include "../include/exporter.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+#include <vector>
+
+#include "../include/vehicle.hh"
+
+namespace component {
+namespace {
+constexpr std::array<std::string_view, TOTAL_SLOT_STATE> slot_state_names = {
+    "AVAILABLE", "OCCUPIED", "HELD", "RETIRED"};
+
+constexpr std::string_view csv_header =
+    "id,level,vehicle_type,state,occupied_at\n";
+
+/// Longest row of either format, so that a row never splits a chunk
+constexpr std::size_t max_row_bytes = 160;
+} // namespace
+
+SlotExporter::SlotExporter(ExportFormat format, ExportSink sink,
+                           std::size_t chunk_bytes)
+    : m_format(format), m_sink(std::move(sink)),
+      m_chunk_bytes(std::max<std::size_t>(chunk_bytes, 1)) {
+  m_buffer.reserve(m_chunk_bytes + max_row_bytes);
+}
+
+void SlotExporter::appendNumber(int64_t value) {
+  std::array<char, 24> digits{};
+  auto result =
+      std::to_chars(digits.data(), digits.data() + digits.size(), value);
+  m_buffer.append(digits.data(), result.ptr);
+}
+
+void SlotExporter::appendJsonString(std::string_view text) {
+  constexpr std::string_view hex = "0123456789abcdef";
+  m_buffer += '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      m_buffer += '\\';
+      m_buffer += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      m_buffer += "\\u00";
+      m_buffer += hex[(c >> 4) & 0xf];
+      m_buffer += hex[c & 0xf];
+    } else {
+      m_buffer += c;
+    }
+  }
+  m_buffer += '"';
+}
+
+void SlotExporter::appendSlotId(const SlotKey &key) {
+  uint64_t prefix_bits = key.getValue() >> SlotKey::NUMBER_BITS;
+  if (prefix_bits != m_prefix_bits) {
+    // Only formatted once per zone, the slots of a zone follow each other
+    std::string unique_id = key.toString();
+    m_prefix.assign(unique_id, 0, unique_id.rfind('_') + 1);
+    m_prefix_bits = prefix_bits;
+  }
+  m_buffer += m_prefix;
+  appendNumber(key.getNumber());
+}
+
+void SlotExporter::appendSlot(const SlotKey &key, SlotState state,
+                              std::time_t occupied_at, bool first) {
+  bool occupied = state == SlotState::OCCUPIED;
+  std::string_view vehicle_type = m_vt_vtstr.at(key.getVehicleType());
+  if (m_format == ExportFormat::CSV) {
+    appendSlotId(key);
+    m_buffer += ',';
+    appendNumber(key.getParkingLevel());
+    m_buffer += ',';
+    m_buffer += vehicle_type;
+    m_buffer += ',';
+    m_buffer += slot_state_names.at(state);
+    m_buffer += ',';
+    if (occupied) {
+      appendNumber(occupied_at);
+    }
+    m_buffer += '\n';
+    return;
+  }
+
+  m_buffer += first ? "{\"id\":\"" : ",{\"id\":\"";
+  appendSlotId(key);
+  m_buffer += "\",\"level\":";
+  appendNumber(key.getParkingLevel());
+  m_buffer += ",\"vehicle_type\":\"";
+  m_buffer += vehicle_type;
+  m_buffer += "\",\"state\":\"";
+  m_buffer += slot_state_names.at(state);
+  m_buffer += "\",\"occupied_at\":";
+  if (occupied) {
+    appendNumber(occupied_at);
+  } else {
+    m_buffer += "null";
+  }
+  m_buffer += '}';
+}
+
+void SlotExporter::flush(bool force) {
+  if (!m_open || m_buffer.empty() ||
+      (!force && m_buffer.size() < m_chunk_bytes)) {
+    return;
+  }
+  m_open = m_sink(m_buffer);
+  m_buffer.clear();
+}
+
+auto SlotExporter::write(std::string_view name, unsigned levels,
+                         const OccupancyEngine &engine) -> std::size_t {
+  std::vector<uint64_t> keys;
+  std::vector<SlotState> states;
+  std::vector<std::time_t> occupied_at;
+  engine.readTable([&](const SlotTable &table) {
+    keys = table.getKeys();
+    states = table.getStates();
+    occupied_at = table.getOccupiedAt();
+  });
+
+  if (m_format == ExportFormat::CSV) {
+    m_buffer += csv_header;
+  } else {
+    std::array<std::size_t, TOTAL_SLOT_STATE> counts{};
+    for (auto state : states) {
+      counts.at(state)++;
+    }
+    m_buffer += "{\"name\":";
+    appendJsonString(name);
+    m_buffer += ",\"levels\":";
+    appendNumber(levels);
+    m_buffer += ",\"available\":";
+    appendNumber(static_cast<int64_t>(counts[SlotState::AVAILABLE]));
+    m_buffer += ",\"occupied\":";
+    appendNumber(static_cast<int64_t>(counts[SlotState::OCCUPIED]));
+    m_buffer += ",\"held\":";
+    appendNumber(static_cast<int64_t>(counts[SlotState::HELD]));
+    m_buffer += ",\"slots\":[";
+  }
+
+  std::size_t written = 0;
+  for (std::size_t row = 0; row < keys.size() && m_open; row++) {
+    if (states[row] == SlotState::RETIRED) {
+      continue;
+    }
+    appendSlot(SlotKey(keys[row]), states[row], occupied_at[row],
+               written == 0);
+    written++;
+    flush();
+  }
+
+  if (m_format == ExportFormat::JSON) {
+    m_buffer += "]}\n";
+  }
+  flush(true);
+  return written;
+}
+} // namespace component
@@ -0,0 +1,206 @@
+#include "../include/journal.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "../include/utils.hh"
+
+namespace component {
+namespace {
+using utils::sys_call_and_check;
+using utils::writeAll;
+
+/// FNV-1a over the fields of a record, guards against torn writes
+auto checksum(const JournalRecord &record) -> uint32_t {
+  uint32_t hash = 2166136261U;
+  auto mix = [&hash](uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; i++) {
+      hash ^= static_cast<uint8_t>(value >> (i * 8));
+      hash *= 16777619U;
+    }
+  };
+  mix(record.slot_key, sizeof(record.slot_key));
+  mix(static_cast<uint64_t>(record.occupied_at), sizeof(record.occupied_at));
+  mix(record.event, sizeof(record.event));
+  return hash;
+}
+} // namespace
+
+void Journal::open(std::string path) {
+  if (isOpen()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> file_lock(m_file_mutex);
+    // Records behind the first corrupt one are dropped along with a torn tail
+    std::size_t intact = replay(path, [](const JournalRecord &) {});
+    m_file.open(std::move(path), intact);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = false;
+  }
+  m_writer = std::thread(&Journal::writeBehind, this);
+}
+
+auto Journal::append(JournalRecord::Event event, uint64_t slot_key,
+                     std::time_t occupied_at) -> uint64_t {
+  JournalRecord record;
+  record.slot_key = slot_key;
+  record.occupied_at = occupied_at;
+  record.event = event;
+  record.checksum = checksum(record);
+
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.push(record);
+    seq = ++m_appended_seq;
+  }
+  if (getDurability() == Durability::GROUP) {
+    m_pending_cv.notify_one();
+  }
+  return seq;
+}
+
+void Journal::flush() {
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  uint64_t seq = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.takePending();
+    seq = m_appended_seq;
+  }
+  m_file.writeTaken();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_durable_seq = std::max(m_durable_seq, seq);
+  }
+  m_durable_cv.notify_all();
+}
+
+void Journal::writeBehind() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop) {
+    switch (getDurability()) {
+    case Durability::PERIODIC:
+      m_pending_cv.wait_for(lock, periodic_interval,
+                            [this]() { return m_stop; });
+      break;
+    case Durability::GROUP:
+      m_pending_cv.wait(lock,
+                        [this]() { return m_stop || m_file.hasPending(); });
+      break;
+    case Durability::PER_EVENT:
+      // Callers sync their own events, only pick up what a change of the
+      // durability may have left behind
+      m_pending_cv.wait_for(lock, periodic_interval,
+                            [this]() { return m_stop; });
+      break;
+    }
+    lock.unlock();
+    flush();
+    lock.lock();
+  }
+}
+
+void Journal::waitDurable(uint64_t seq) {
+  if (seq == 0) {
+    return;
+  }
+  switch (getDurability()) {
+  case Durability::PERIODIC:
+    return;
+  case Durability::PER_EVENT: {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_durable_seq < seq) {
+      lock.unlock();
+      flush();
+    }
+    return;
+  }
+  case Durability::GROUP: {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_durable_cv.wait(lock,
+                      [this, seq]() { return m_stop || m_durable_seq >= seq; });
+    return;
+  }
+  }
+}
+
+auto Journal::rotate(const std::string &rotated_path) -> bool {
+  flush();
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  return m_file.rotate(rotated_path);
+}
+
+void Journal::close() {
+  if (m_writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_pending_cv.notify_all();
+    m_writer.join();
+  }
+  flush();
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  m_file.close();
+}
+
+auto Journal::replay(const std::string &path,
+                     const std::function<void(const JournalRecord &)> &fn)
+    -> std::size_t {
+  std::size_t count = 0;
+  RecordFile<JournalRecord>::read(
+      path, buffer_capacity,
+      [&fn, &count](const JournalRecord *records, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++) {
+          if (records[i].checksum != checksum(records[i]) ||
+              records[i].event > JournalRecord::Event::RETURN) {
+            return false;
+          }
+          fn(records[i]);
+          count++;
+        }
+        return true;
+      });
+  return count;
+}
+
+auto Journal::concatenate(const std::string &path, const std::string &to_path)
+    -> bool {
+  int to = sys_call_and_check(
+      __FILE__, __LINE__,
+      ::open(to_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+             0644));
+  if (to == -1) {
+    return false;
+  }
+
+  // Copy record by record so that a torn tail is left behind
+  std::vector<JournalRecord> records;
+  records.reserve(4096);
+  auto write_records = [to, &records]() {
+    writeAll(to, reinterpret_cast<const char *>(records.data()),
+             records.size() * sizeof(JournalRecord));
+    records.clear();
+  };
+  replay(path, [&records, &write_records](const JournalRecord &record) {
+    records.push_back(record);
+    if (records.size() == records.capacity()) {
+      write_records();
+    }
+  });
+  write_records();
+  bool synced = sys_call_and_check(__FILE__, __LINE__, ::fdatasync(to)) == 0;
+  ::close(to);
+  return synced;
+}
+
+Journal::~Journal() { close(); }
+} // namespace component
@@ -0,0 +1,76 @@
+#include "../include/lot_registry.hh"
+
+#include <mutex>
+
+namespace component {
+LotRegistry::LotRegistry(std::shared_ptr<ThreadPool> pool,
+                         Durability durability, SlotSelection selection)
+    : m_pool(std::move(pool)), m_durability(durability),
+      m_selection(selection) {}
+
+[[nodiscard]] auto LotRegistry::isValidName(std::string_view name) -> bool {
+  return !name.empty() && name != "." && name != ".." &&
+         name.find('/') == std::string_view::npos &&
+         name.find('\0') == std::string_view::npos;
+}
+
+auto LotRegistry::open(const std::string &name, unsigned parking_levels)
+    -> std::shared_ptr<ParkingLot> {
+  if (!isValidName(name)) {
+    return nullptr;
+  }
+  if (auto lot = find(name)) {
+    return lot;
+  }
+
+  // Opening a lot reads its storage, keep it out of the registry lock so
+  // that the hosted lots are still served meanwhile
+  std::lock_guard<std::mutex> open_lock(m_open_mutex);
+  if (auto lot = find(name)) {
+    return lot;
+  }
+  auto lot = std::make_shared<ParkingLot>(name, parking_levels, m_pool);
+  lot->setDurability(m_durability);
+  lot->setSlotSelection(m_selection);
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  return m_lots.emplace(name, std::move(lot)).first->second;
+}
+
+[[nodiscard]] auto LotRegistry::find(const std::string &name) const
+    -> std::shared_ptr<ParkingLot> {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  auto it = m_lots.find(name);
+  return it != m_lots.end() ? it->second : nullptr;
+}
+
+auto LotRegistry::close(const std::string &name) -> bool {
+  std::shared_ptr<ParkingLot> lot;
+  {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_lots.find(name);
+    if (it == m_lots.end()) {
+      return false;
+    }
+    lot = std::move(it->second);
+    m_lots.erase(it);
+  }
+  // The lot checkpoints on its way out, outside the registry lock
+  lot.reset();
+  return true;
+}
+
+[[nodiscard]] auto LotRegistry::getNames() const -> std::vector<std::string> {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  std::vector<std::string> names;
+  names.reserve(m_lots.size());
+  for (const auto &lot : m_lots) {
+    names.push_back(lot.first);
+  }
+  return names;
+}
+
+[[nodiscard]] auto LotRegistry::size() const -> std::size_t {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return m_lots.size();
+}
+} // namespace component
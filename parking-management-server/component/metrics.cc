@@ -0,0 +1,254 @@
+#include "../include/metrics.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+
+namespace component {
+namespace {
+/// Values recorded by a single thread. Only that thread writes them, the
+/// snapshots read them concurrently.
+struct ThreadMetrics {
+  struct Histogram {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKETS> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+  };
+
+  std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+  std::array<std::atomic<int64_t>, GAUGE_COUNT> gauges{};
+  std::array<Histogram, HISTOGRAM_COUNT> histograms{};
+  ThreadMetrics *prev{nullptr};
+  ThreadMetrics *next{nullptr};
+};
+
+/// Adds to a value only the calling thread writes, without a locked
+/// instruction
+template <typename T> inline void bump(std::atomic<T> &value, T delta) {
+  value.store(value.load(std::memory_order_relaxed) + delta,
+              std::memory_order_relaxed);
+}
+
+/// Blocks of the live threads and the totals of the exited ones
+struct Registry {
+  std::mutex mutex;
+  ThreadMetrics *head{nullptr};
+  ThreadMetrics retired;
+};
+
+/// Never destroyed, threads may exit after the static destructors ran
+auto getRegistry() -> Registry & {
+  static auto *registry = new Registry();
+  return *registry;
+}
+
+/// Adds the values of the block to the snapshot
+void collect(const ThreadMetrics &block, MetricsSnapshot &snapshot) {
+  for (unsigned i = 0; i < COUNTER_COUNT; i++) {
+    snapshot.counters.at(i) += block.counters.at(i).load();
+  }
+  for (unsigned i = 0; i < GAUGE_COUNT; i++) {
+    snapshot.gauges.at(i) += block.gauges.at(i).load();
+  }
+  for (unsigned h = 0; h < HISTOGRAM_COUNT; h++) {
+    const auto &histogram = block.histograms.at(h);
+    uint64_t sum = histogram.sum.load();
+    uint64_t max = histogram.max.load();
+    for (unsigned b = 0; b < LatencyHistogram::BUCKETS; b++) {
+      uint64_t count = histogram.buckets.at(b).load();
+      if (count > 0) {
+        snapshot.histograms.at(h).add(b, count, sum, max);
+        // The totals of the block go along with its first bucket
+        sum = 0;
+      }
+    }
+  }
+}
+
+/// Adds the values of an exiting thread to the retired totals, the registry
+/// lock must be held
+void retire(const ThreadMetrics &block, ThreadMetrics &retired) {
+  for (unsigned i = 0; i < COUNTER_COUNT; i++) {
+    bump(retired.counters.at(i), block.counters.at(i).load());
+  }
+  for (unsigned i = 0; i < GAUGE_COUNT; i++) {
+    bump(retired.gauges.at(i), block.gauges.at(i).load());
+  }
+  for (unsigned h = 0; h < HISTOGRAM_COUNT; h++) {
+    const auto &from = block.histograms.at(h);
+    auto &to = retired.histograms.at(h);
+    for (unsigned b = 0; b < LatencyHistogram::BUCKETS; b++) {
+      bump(to.buckets.at(b), from.buckets.at(b).load());
+    }
+    bump(to.sum, from.sum.load());
+    to.max = std::max(to.max.load(), from.max.load());
+  }
+}
+
+/// Block of the calling thread, registered on first use and retired when the
+/// thread exits
+class ThreadHandle {
+private:
+  ThreadMetrics *m_block{nullptr};
+
+public:
+  ThreadHandle() = default;
+  ThreadHandle(const ThreadHandle &) = delete;
+  auto operator=(const ThreadHandle &) -> ThreadHandle & = delete;
+
+  inline auto get() -> ThreadMetrics & {
+    if (m_block == nullptr) {
+      m_block = new ThreadMetrics();
+      auto &registry = getRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      m_block->next = registry.head;
+      if (registry.head != nullptr) {
+        registry.head->prev = m_block;
+      }
+      registry.head = m_block;
+    }
+    return *m_block;
+  }
+
+  ~ThreadHandle() {
+    if (m_block == nullptr) {
+      return;
+    }
+    auto &registry = getRegistry();
+    {
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      retire(*m_block, registry.retired);
+      if (m_block->prev != nullptr) {
+        m_block->prev->next = m_block->next;
+      } else {
+        registry.head = m_block->next;
+      }
+      if (m_block->next != nullptr) {
+        m_block->next->prev = m_block->prev;
+      }
+    }
+    delete m_block;
+  }
+};
+
+thread_local ThreadHandle local_metrics;
+} // namespace
+
+[[nodiscard]] auto LatencyHistogram::getBucketMax(unsigned bucket)
+    -> uint64_t {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  unsigned shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+  uint64_t sub_bucket = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+  return ((SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(unsigned bucket, uint64_t count, uint64_t sum,
+                           uint64_t max) {
+  m_buckets.at(bucket) += count;
+  m_count += count;
+  m_sum += sum;
+  m_max = std::max(m_max, max);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+  for (unsigned bucket = 0; bucket < BUCKETS; bucket++) {
+    m_buckets.at(bucket) += other.m_buckets.at(bucket);
+  }
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+  m_max = std::max(m_max, other.m_max);
+}
+
+[[nodiscard]] auto LatencyHistogram::getQuantile(double q) const -> uint64_t {
+  if (m_count == 0) {
+    return 0;
+  }
+  auto rank = std::max<uint64_t>(
+      static_cast<uint64_t>(std::ceil(q * static_cast<double>(m_count))), 1);
+  uint64_t seen = 0;
+  for (unsigned bucket = 0; bucket < BUCKETS; bucket++) {
+    seen += m_buckets.at(bucket);
+    if (seen >= rank) {
+      return std::min(getBucketMax(bucket), m_max);
+    }
+  }
+  return m_max;
+}
+
+void MetricsSnapshot::writePrometheus(std::ostream &os) const {
+  constexpr std::array<double, 4> quantiles = {0.5, 0.9, 0.99, 0.999};
+  auto precision = os.precision(9);
+
+  for (unsigned i = 0; i < COUNTER_COUNT; i++) {
+    os << "# TYPE parking_" << counter_names.at(i) << " counter\n"
+       << "parking_" << counter_names.at(i) << " " << counters.at(i) << "\n";
+  }
+  for (unsigned i = 0; i < GAUGE_COUNT; i++) {
+    os << "# TYPE parking_" << gauge_names.at(i) << " gauge\n"
+       << "parking_" << gauge_names.at(i) << " " << gauges.at(i) << "\n";
+  }
+  for (unsigned i = 0; i < HISTOGRAM_COUNT; i++) {
+    const auto &histogram = histograms.at(i);
+    std::string name = std::string("parking_") + histogram_names.at(i) +
+                       "_seconds";
+    os << "# TYPE " << name << " summary\n";
+    for (double q : quantiles) {
+      os << name << "{quantile=\"" << q << "\"} "
+         << static_cast<double>(histogram.getQuantile(q)) / 1e9 << "\n";
+    }
+    os << name << "_sum " << static_cast<double>(histogram.getSum()) / 1e9
+       << "\n"
+       << name << "_count " << histogram.getCount() << "\n";
+  }
+  os.precision(precision);
+}
+
+void Metrics::add(Counter counter, uint64_t count) {
+  bump(local_metrics.get().counters[counter], count);
+}
+
+void Metrics::add(Gauge gauge, int64_t delta) {
+  bump(local_metrics.get().gauges[gauge], delta);
+}
+
+void Metrics::record(Histogram histogram, Clock::duration latency) {
+  auto count =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+  auto ns = static_cast<uint64_t>(std::max<int64_t>(count, 0));
+  auto &block = local_metrics.get().histograms[histogram];
+  bump(block.buckets[LatencyHistogram::getBucket(ns)], uint64_t{1});
+  bump(block.sum, ns);
+  if (ns > block.max.load(std::memory_order_relaxed)) {
+    block.max.store(ns, std::memory_order_relaxed);
+  }
+}
+
+[[nodiscard]] auto Metrics::snapshot() -> std::unique_ptr<MetricsSnapshot> {
+  auto snapshot = std::make_unique<MetricsSnapshot>();
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  collect(registry.retired, *snapshot);
+  for (auto *block = registry.head; block != nullptr; block = block->next) {
+    collect(*block, *snapshot);
+  }
+  return snapshot;
+}
+
+auto Metrics::writePrometheusFile(const std::string &path) -> bool {
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::trunc);
+    snapshot()->writePrometheus(file);
+    if (!file.flush()) {
+      return false;
+    }
+  }
+  // Scrapers never see a partially written file
+  return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+} // namespace component
@@ -0,0 +1,685 @@
+#include "../include/occupancy.hh"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace component {
+[[nodiscard]] auto entranceDistance(const SlotKey &key) -> uint64_t {
+  // Walking up a level costs as much as passing this many slots
+  constexpr uint64_t level_distance = 1000;
+  return key.getParkingLevel() * level_distance + key.getNumber();
+}
+
+void OccupancyCounters::reset() {
+  auto reset_counter = [](Counter &counter) {
+    counter.available.store(0, std::memory_order_relaxed);
+    counter.occupied.store(0, std::memory_order_relaxed);
+    counter.held.store(0, std::memory_order_relaxed);
+  };
+  for (auto &level : m_level_vehicle) {
+    for (auto &counter : level) {
+      reset_counter(counter);
+    }
+  }
+  for (auto &counter : m_level) {
+    reset_counter(counter);
+  }
+  for (auto &counter : m_vehicle) {
+    reset_counter(counter);
+  }
+  reset_counter(m_total);
+}
+
+void OccupancyEngine::reserve(std::size_t slot_count) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  m_table.reserve(slot_count);
+  m_shard_position.reserve(slot_count);
+  if (isRanked()) {
+    m_rank.reserve(slot_count);
+  }
+  m_slot_index.reserve(slot_count);
+}
+
+auto OccupancyEngine::load(const SlotColumns &columns,
+                           const std::vector<SlotView> &changes) -> bool {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  if (m_table.size() != 0 ||
+      columns.count >= std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+
+  m_table.reserve(columns.count);
+  m_shard_position.reserve(columns.count);
+  m_slot_index.reserve(columns.count);
+  for (std::size_t index = 0; index < columns.count; index++) {
+    SlotKey key(columns.keys[index]);
+    if (!key.isValid() || key.getParkingLevel() >= MAX_PARKING_LEVELS ||
+        !m_slot_index.try_emplace(key.getValue(), m_table.size()).second) {
+      continue;
+    }
+    bool occupied = (columns.occupancy[index / 64] >> (index % 64)) & 1U;
+    m_table.append(key, occupied, columns.occupied_at[index]);
+  }
+  for (const auto &change : changes) {
+    auto it = m_slot_index.find(change.getSlotKey().getValue());
+    if (it == m_slot_index.end()) {
+      continue;
+    }
+    if (change.isOccupied()) {
+      m_table.occupy(it->second, change.getParkingTime().getData());
+    } else {
+      m_table.release(it->second);
+    }
+  }
+
+  // Counted per pair first, the atomic counters are updated once per pair
+  std::array<std::array<std::array<unsigned, 2>, TOTALVEHICLETYPE>,
+             MAX_PARKING_LEVELS>
+      counts{};
+  unsigned level_count = 0;
+  const auto &levels = m_table.getParkingLevels();
+  const auto &vehicle_types = m_table.getVehicleTypes();
+  for (std::size_t row = 0; row < m_table.size(); row++) {
+    bool occupied = m_table.isOccupied(row);
+    Shard &shard = m_shards[levels[row]][vehicle_types[row]];
+    m_shard_position.push_back(shard.slots.size());
+    shard.slots.push_back(static_cast<uint32_t>(row));
+    shard.occupied.push_back(occupied);
+    counts[levels[row]][vehicle_types[row]][occupied ? 1 : 0]++;
+    level_count = std::max<unsigned>(level_count, levels[row] + 1);
+  }
+  for (unsigned level = 0; level < level_count; level++) {
+    for (unsigned type = 0; type < TOTALVEHICLETYPE; type++) {
+      auto vt = static_cast<VehicleType>(type);
+      m_counters.add(level, vt, SlotState::AVAILABLE, counts[level][vt][0]);
+      m_counters.add(level, vt, SlotState::OCCUPIED, counts[level][vt][1]);
+    }
+  }
+  m_level_count.store(level_count, std::memory_order_release);
+  rebuildRanks();
+  return true;
+}
+
+auto OccupancyEngine::addSlot(const ParkingSlot &slot) -> bool {
+  auto occupied_at = slot.getParkingTime();
+  return addSlot(slot.getSlotKey(), slot.isOccupied(),
+                 occupied_at.isOk() ? occupied_at.getData() : 0);
+}
+
+auto OccupancyEngine::addSlot(const SlotKey &key, bool occupied,
+                              std::time_t occupied_at) -> bool {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  return insertSlot(key, occupied ? SlotState::OCCUPIED : SlotState::AVAILABLE,
+                    occupied_at);
+}
+
+auto OccupancyEngine::insertSlot(const SlotKey &key, SlotState state,
+                                 std::time_t occupied_at, uint64_t hold_id)
+    -> bool {
+  if (!key.isValid() || key.getParkingLevel() >= MAX_PARKING_LEVELS) {
+    return false;
+  }
+
+  if (m_table.size() >= std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  unsigned level = key.getParkingLevel();
+  VehicleType vt = key.getVehicleType();
+  auto [it, inserted] =
+      m_slot_index.try_emplace(key.getValue(), m_table.size());
+  if (!inserted) {
+    std::size_t row = it->second;
+    if (m_table.getState(row) != SlotState::RETIRED) {
+      return false;
+    }
+    // The retired row is revived in place
+    Shard &shard = getShard(level, vt);
+    std::size_t position = m_shard_position[row];
+    shard.retired--;
+    if (state == SlotState::OCCUPIED) {
+      m_table.occupy(row, occupied_at);
+    } else if (state == SlotState::HELD) {
+      m_table.hold(row);
+      shard.holds.emplace(static_cast<uint32_t>(position), hold_id);
+    } else {
+      m_table.release(row);
+      shard.occupied.reset(position);
+      putPosition(shard, row, position);
+    }
+    m_counters.add(level, vt, state);
+    return true;
+  }
+
+  if (level >= m_level_count.load(std::memory_order_relaxed)) {
+    m_level_count.store(level + 1, std::memory_order_release);
+  }
+  Shard &shard = getShard(level, vt);
+  std::size_t position = shard.slots.size();
+  m_shard_position.push_back(position);
+  shard.slots.push_back(it->second);
+  shard.occupied.push_back(state != SlotState::AVAILABLE);
+  if (isRanked()) {
+    m_rank.push_back(rankSlot(key));
+    if (state == SlotState::AVAILABLE) {
+      putPosition(shard, it->second, position);
+    }
+  }
+  m_counters.add(level, vt, state);
+  m_table.append(key, state == SlotState::OCCUPIED, occupied_at);
+  if (state == SlotState::HELD) {
+    m_table.hold(it->second);
+    shard.holds.emplace(static_cast<uint32_t>(position), hold_id);
+  }
+  return true;
+}
+
+void OccupancyEngine::setSlotSelection(SlotSelection selection,
+                                       SlotDistance distance) {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  m_selection = selection;
+  m_distance = distance ? std::move(distance) : entranceDistance;
+  rebuildRanks();
+}
+
+[[nodiscard]] auto OccupancyEngine::getSlotSelection() const -> SlotSelection {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return m_selection;
+}
+
+[[nodiscard]] auto OccupancyEngine::rankSlot(const SlotKey &key) const
+    -> uint64_t {
+  return m_selection == SlotSelection::NEAREST_ENTRANCE ? m_distance(key)
+                                                        : key.getValue();
+}
+
+void OccupancyEngine::rebuildRanks() {
+  m_rank.clear();
+  for (auto &shards : m_shards) {
+    for (auto &shard : shards) {
+      shard.free_heap.clear();
+      shard.best_rank.store(NO_RANK, std::memory_order_relaxed);
+    }
+  }
+  if (!isRanked()) {
+    m_rank.shrink_to_fit();
+    return;
+  }
+
+  m_rank.reserve(m_table.size());
+  for (std::size_t row = 0; row < m_table.size(); row++) {
+    m_rank.push_back(rankSlot(m_table.getSlotKey(row)));
+    if (m_table.getState(row) == SlotState::AVAILABLE) {
+      Shard &shard =
+          getShard(m_table.getParkingLevel(row), m_table.getVehicleType(row));
+      shard.free_heap.push_back(
+          RankedPosition{m_rank[row], m_shard_position[row]});
+    }
+  }
+  for (auto &shards : m_shards) {
+    for (auto &shard : shards) {
+      std::make_heap(shard.free_heap.begin(), shard.free_heap.end(),
+                     std::greater<>());
+      if (!shard.free_heap.empty()) {
+        shard.best_rank.store(shard.free_heap.front().rank,
+                              std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+[[nodiscard]] auto
+OccupancyEngine::selectLevel(const VehicleType &vt,
+                             const std::bitset<MAX_PARKING_LEVELS> &tried) const
+    -> unsigned {
+  unsigned selected = MAX_PARKING_LEVELS;
+  // Figure of merit of the selected level, the lower the better
+  uint64_t best_rank = NO_RANK;
+  unsigned best_available = 0;
+  unsigned best_total = 0;
+  for (unsigned level = 0; level < getLevelCount(); level++) {
+    // Skip the shards which are known to be full without locking them
+    unsigned available = m_counters.getAvailable(level, vt);
+    if (tried.test(level) || available == 0) {
+      continue;
+    }
+
+    switch (m_selection) {
+    case SlotSelection::LOWEST_LEVEL:
+      return level;
+    case SlotSelection::LEAST_LOADED_LEVEL: {
+      unsigned total = available + m_counters.getOccupied(level, vt);
+      // available / total above best_available / best_total
+      if (selected == MAX_PARKING_LEVELS ||
+          uint64_t{available} * best_total >
+              uint64_t{best_available} * total) {
+        selected = level;
+        best_available = available;
+        best_total = total;
+      }
+      break;
+    }
+    default: {
+      uint64_t rank =
+          getShard(level, vt).best_rank.load(std::memory_order_relaxed);
+      if (selected == MAX_PARKING_LEVELS || rank < best_rank) {
+        selected = level;
+        best_rank = rank;
+      }
+      break;
+    }
+    }
+  }
+  return selected;
+}
+
+[[nodiscard]] auto OccupancyEngine::takePosition(Shard &shard) -> std::size_t {
+  if (isRanked()) {
+    if (shard.free_heap.empty()) {
+      return OccupancyBitmap::npos;
+    }
+    std::pop_heap(shard.free_heap.begin(), shard.free_heap.end(),
+                  std::greater<>());
+    std::size_t position = shard.free_heap.back().position;
+    shard.free_heap.pop_back();
+    uint64_t best_rank =
+        shard.free_heap.empty() ? NO_RANK : shard.free_heap.front().rank;
+    shard.best_rank.store(best_rank, std::memory_order_relaxed);
+    return position;
+  }
+
+  std::size_t position = shard.occupied.findFirstZero(shard.first_free);
+  shard.first_free =
+      position == OccupancyBitmap::npos ? shard.occupied.size() : position + 1;
+  return position;
+}
+
+void OccupancyEngine::putPosition(Shard &shard, std::size_t row,
+                                  std::size_t position) {
+  shard.first_free = std::min(shard.first_free, position);
+  if (!isRanked()) {
+    return;
+  }
+  shard.free_heap.push_back(
+      RankedPosition{m_rank[row], static_cast<uint32_t>(position)});
+  std::push_heap(shard.free_heap.begin(), shard.free_heap.end(),
+                 std::greater<>());
+  shard.best_rank.store(shard.free_heap.front().rank,
+                        std::memory_order_relaxed);
+}
+
+[[nodiscard]] auto OccupancyEngine::allocate(const VehicleType &vt,
+                                             std::time_t occupied_at,
+                                             const SlotObserver &on_allocate)
+    -> utils::StatusOr<SlotView> {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return allocateLocked(vt, occupied_at, on_allocate);
+}
+
+[[nodiscard]] auto
+OccupancyEngine::acquireLocked(const VehicleType &vt, SlotState state,
+                               std::time_t occupied_at, uint64_t hold_id,
+                               const SlotObserver &on_acquire)
+    -> utils::StatusOr<SlotView> {
+  if (vt >= VehicleType::TOTALVEHICLETYPE) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+  // A level picked out of the counters may be emptied by a racing allocation
+  // before it is locked, the next best level is tried then
+  std::bitset<MAX_PARKING_LEVELS> tried;
+  for (unsigned level = selectLevel(vt, tried); level < MAX_PARKING_LEVELS;
+       level = selectLevel(vt, tried)) {
+    tried.set(level);
+    Shard &shard = getShard(level, vt);
+    std::lock_guard<std::mutex> shard_lock(shard.mutex);
+    std::size_t position = takePosition(shard);
+    if (position == OccupancyBitmap::npos) {
+      continue;
+    }
+    shard.occupied.set(position);
+    std::size_t row = shard.slots[position];
+    if (state == SlotState::HELD) {
+      m_table.hold(row);
+      shard.holds.emplace(static_cast<uint32_t>(position), hold_id);
+      m_counters.hold(level, vt);
+    } else {
+      m_table.occupy(row, occupied_at);
+      m_counters.occupy(level, vt);
+    }
+    SlotView slot = m_table.getView(row);
+    if (on_acquire) {
+      on_acquire(slot);
+    }
+    return utils::StatusOr<SlotView>(slot);
+  }
+  return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+}
+
+[[nodiscard]] auto OccupancyEngine::hold(const VehicleType &vt,
+                                         uint64_t hold_id,
+                                         const SlotObserver &on_hold)
+    -> utils::StatusOr<SlotView> {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return acquireLocked(vt, SlotState::HELD, 0, hold_id, on_hold);
+}
+
+[[nodiscard]] auto OccupancyEngine::confirmHold(const SlotKey &key,
+                                                uint64_t hold_id,
+                                                std::time_t occupied_at,
+                                                const SlotObserver &on_confirm)
+    -> utils::StatusOr<SlotView> {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return endHold(key, hold_id, SlotState::OCCUPIED, occupied_at, on_confirm);
+}
+
+auto OccupancyEngine::cancelHold(const SlotKey &key, uint64_t hold_id,
+                                 const SlotObserver &on_cancel) -> bool {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return endHold(key, hold_id, SlotState::AVAILABLE, 0, on_cancel).isOk();
+}
+
+auto OccupancyEngine::endHold(const SlotKey &key, uint64_t hold_id,
+                              SlotState state, std::time_t occupied_at,
+                              const SlotObserver &on_end)
+    -> utils::StatusOr<SlotView> {
+  auto it = m_slot_index.find(key.getValue());
+  if (it == m_slot_index.end()) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+
+  unsigned level = key.getParkingLevel();
+  VehicleType vt = key.getVehicleType();
+  Shard &shard = getShard(level, vt);
+  std::lock_guard<std::mutex> shard_lock(shard.mutex);
+  std::size_t row = it->second;
+  std::size_t position = m_shard_position[row];
+  auto hold = shard.holds.find(static_cast<uint32_t>(position));
+  if (hold == shard.holds.end() || hold->second != hold_id) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+  shard.holds.erase(hold);
+  if (state == SlotState::OCCUPIED) {
+    m_table.occupy(row, occupied_at);
+    m_counters.confirmHold(level, vt);
+  } else if (!retireDrained(shard, row, position)) {
+    m_table.release(row);
+    shard.occupied.reset(position);
+    putPosition(shard, row, position);
+    m_counters.cancelHold(level, vt);
+  }
+  SlotView slot = m_table.getView(row);
+  if (on_end) {
+    on_end(slot);
+  }
+  return utils::StatusOr<SlotView>(slot);
+}
+
+auto OccupancyEngine::release(const SlotKey &key,
+                              const SlotObserver &on_release) -> bool {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  return releaseLocked(key, on_release);
+}
+
+auto OccupancyEngine::releaseLocked(const SlotKey &key,
+                                    const SlotObserver &on_release) -> bool {
+  auto it = m_slot_index.find(key.getValue());
+  if (it == m_slot_index.end()) {
+    return false;
+  }
+
+  Shard &shard = getShard(key.getParkingLevel(), key.getVehicleType());
+  std::lock_guard<std::mutex> shard_lock(shard.mutex);
+  std::size_t row = it->second;
+  if (!m_table.isOccupied(row)) {
+    return false;
+  }
+  SlotView occupied = m_table.getView(row);
+  std::size_t position = m_shard_position[row];
+  if (!retireDrained(shard, row, position)) {
+    m_table.release(row);
+    shard.occupied.reset(position);
+    putPosition(shard, row, position);
+    m_counters.release(key.getParkingLevel(), key.getVehicleType());
+  }
+  if (on_release) {
+    on_release(occupied);
+  }
+  return true;
+}
+
+[[nodiscard]] auto OccupancyEngine::getSlot(const SlotKey &key) const
+    -> utils::StatusOr<SlotView> {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  auto it = m_slot_index.find(key.getValue());
+  if (it == m_slot_index.end()) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+
+  const Shard &shard = getShard(key.getParkingLevel(), key.getVehicleType());
+  std::lock_guard<std::mutex> shard_lock(shard.mutex);
+  if (m_table.getState(it->second) == SlotState::RETIRED) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+  return utils::StatusOr<SlotView>(m_table.getView(it->second));
+}
+
+[[nodiscard]] auto OccupancyEngine::countOccupied(unsigned level,
+                                                  const VehicleType &vt) const
+    -> std::size_t {
+  if (level >= MAX_PARKING_LEVELS || vt >= VehicleType::TOTALVEHICLETYPE) {
+    return 0;
+  }
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  const Shard &shard = getShard(level, vt);
+  std::lock_guard<std::mutex> shard_lock(shard.mutex);
+  return shard.occupied.count() - shard.retired;
+}
+
+void OccupancyEngine::retireRow(Shard &shard, std::size_t row,
+                                std::size_t position) {
+  m_counters.remove(m_table.getParkingLevel(row), m_table.getVehicleType(row),
+                    m_table.getState(row));
+  m_table.retire(row);
+  shard.occupied.set(position);
+  shard.retired++;
+}
+
+auto OccupancyEngine::retireDrained(Shard &shard, std::size_t row,
+                                    std::size_t position) -> bool {
+  if (shard.draining.empty() ||
+      shard.draining.erase(static_cast<uint32_t>(position)) == 0) {
+    return false;
+  }
+  retireRow(shard, row, position);
+  std::lock_guard<std::mutex> drained_lock(m_drained_mutex);
+  m_drained.push_back(m_table.getSlotKey(row));
+  return true;
+}
+
+void OccupancyEngine::pruneHeap(Shard &shard) {
+  if (!isRanked()) {
+    return;
+  }
+  auto &heap = shard.free_heap;
+  heap.erase(std::remove_if(heap.begin(), heap.end(),
+                            [&shard](const RankedPosition &ranked) {
+                              return shard.occupied.test(ranked.position);
+                            }),
+             heap.end());
+  std::make_heap(heap.begin(), heap.end(), std::greater<>());
+  shard.best_rank.store(heap.empty() ? NO_RANK : heap.front().rank,
+                        std::memory_order_relaxed);
+}
+
+auto OccupancyEngine::reconfigure(unsigned level, const VehicleType &vt,
+                                  const std::vector<SlotKey> &wanted)
+    -> SlotChanges {
+  SlotChanges changes;
+  if (level >= MAX_PARKING_LEVELS || vt >= VehicleType::TOTALVEHICLETYPE) {
+    return changes;
+  }
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  Shard &shard = getShard(level, vt);
+  std::unordered_set<uint64_t> wanted_keys;
+  wanted_keys.reserve(wanted.size());
+  for (const auto &key : wanted) {
+    if (key.getParkingLevel() != level || key.getVehicleType() != vt ||
+        !wanted_keys.insert(key.getValue()).second) {
+      continue;
+    }
+    auto it = m_slot_index.find(key.getValue());
+    if (it == m_slot_index.end()) {
+      if (insertSlot(key, SlotState::AVAILABLE, 0)) {
+        changes.added.push_back(key);
+      }
+    } else if (m_table.getState(it->second) == SlotState::RETIRED) {
+      insertSlot(key, SlotState::AVAILABLE, 0);
+      changes.revived.push_back(key);
+    } else if (shard.draining.erase(m_shard_position[it->second]) > 0) {
+      changes.kept.push_back(key);
+    }
+  }
+
+  for (std::size_t position = 0; position < shard.slots.size(); position++) {
+    std::size_t row = shard.slots[position];
+    SlotKey key = m_table.getSlotKey(row);
+    SlotState state = m_table.getState(row);
+    if (state == SlotState::RETIRED || wanted_keys.count(key.getValue()) > 0 ||
+        shard.draining.count(static_cast<uint32_t>(position)) > 0) {
+      continue;
+    }
+    if (state == SlotState::AVAILABLE) {
+      retireRow(shard, row, position);
+      changes.retired.push_back(key);
+    } else {
+      shard.draining.insert(static_cast<uint32_t>(position));
+      changes.draining.push_back(key);
+    }
+  }
+  if (!changes.retired.empty()) {
+    pruneHeap(shard);
+  }
+  return changes;
+}
+
+auto OccupancyEngine::drainSlot(const SlotKey &key) -> bool {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  auto it = m_slot_index.find(key.getValue());
+  if (it == m_slot_index.end()) {
+    return false;
+  }
+  Shard &shard = getShard(key.getParkingLevel(), key.getVehicleType());
+  std::size_t row = it->second;
+  std::size_t position = m_shard_position[row];
+  SlotState state = m_table.getState(row);
+  if (state == SlotState::RETIRED ||
+      shard.draining.count(static_cast<uint32_t>(position)) > 0) {
+    return false;
+  }
+  if (state != SlotState::AVAILABLE) {
+    shard.draining.insert(static_cast<uint32_t>(position));
+    return true;
+  }
+  retireRow(shard, row, position);
+  pruneHeap(shard);
+  std::lock_guard<std::mutex> drained_lock(m_drained_mutex);
+  m_drained.push_back(key);
+  return true;
+}
+
+[[nodiscard]] auto OccupancyEngine::isDraining(const SlotKey &key) const
+    -> bool {
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  auto it = m_slot_index.find(key.getValue());
+  if (it == m_slot_index.end()) {
+    return false;
+  }
+  const Shard &shard = getShard(key.getParkingLevel(), key.getVehicleType());
+  std::lock_guard<std::mutex> shard_lock(shard.mutex);
+  return shard.draining.count(m_shard_position[it->second]) > 0;
+}
+
+[[nodiscard]] auto OccupancyEngine::takeDrained() -> std::vector<SlotKey> {
+  std::lock_guard<std::mutex> drained_lock(m_drained_mutex);
+  return std::exchange(m_drained, {});
+}
+
+auto OccupancyEngine::clear(int level) -> std::vector<uint64_t> {
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  auto cleared = [level](unsigned slot_level) {
+    return level == -1 || slot_level == static_cast<unsigned>(level);
+  };
+  std::vector<uint64_t> dropped;
+  std::unordered_map<uint64_t, uint64_t> retained_holds;
+  for (const auto &shards : m_shards) {
+    for (const auto &shard : shards) {
+      for (const auto &[position, hold_id] : shard.holds) {
+        std::size_t row = shard.slots[position];
+        if (cleared(m_table.getParkingLevel(row))) {
+          dropped.push_back(hold_id);
+        } else {
+          retained_holds.emplace(m_table.getSlotKey(row).getValue(), hold_id);
+        }
+      }
+    }
+  }
+
+  SlotTable retained;
+  std::vector<SlotKey> draining;
+  const auto &levels = m_table.getParkingLevels();
+  for (std::size_t row = 0; row < m_table.size(); row++) {
+    if (cleared(levels[row]) || m_table.getState(row) == SlotState::RETIRED) {
+      continue;
+    }
+    retained.append(m_table.getSlotKey(row), m_table.isOccupied(row),
+                    m_table.getOccupiedAt(row));
+    if (m_table.getState(row) == SlotState::HELD) {
+      retained.hold(retained.size() - 1);
+    }
+    const Shard &shard = getShard(levels[row], m_table.getVehicleType(row));
+    if (shard.draining.count(m_shard_position[row]) > 0) {
+      draining.push_back(m_table.getSlotKey(row));
+    }
+  }
+  {
+    std::lock_guard<std::mutex> drained_lock(m_drained_mutex);
+    m_drained.erase(std::remove_if(m_drained.begin(), m_drained.end(),
+                                   [&cleared](const SlotKey &key) {
+                                     return cleared(key.getParkingLevel());
+                                   }),
+                    m_drained.end());
+  }
+
+  m_table.clear();
+  m_shard_position.clear();
+  m_rank.clear();
+  m_slot_index.clear();
+  for (auto &shards : m_shards) {
+    for (auto &shard : shards) {
+      shard.slots.clear();
+      shard.occupied.clear();
+      shard.first_free = 0;
+      shard.free_heap.clear();
+      shard.best_rank.store(NO_RANK, std::memory_order_relaxed);
+      shard.holds.clear();
+      shard.draining.clear();
+      shard.retired = 0;
+    }
+  }
+  m_level_count.store(0, std::memory_order_release);
+  m_counters.reset();
+  for (std::size_t row = 0; row < retained.size(); row++) {
+    SlotKey key = retained.getSlotKey(row);
+    auto hold = retained_holds.find(key.getValue());
+    insertSlot(key, retained.getState(row), retained.getOccupiedAt(row),
+               hold == retained_holds.end() ? 0 : hold->second);
+  }
+  // Draining slots are occupied or held, they still retire once released
+  for (const auto &key : draining) {
+    std::size_t row = m_slot_index.at(key.getValue());
+    getShard(key.getParkingLevel(), key.getVehicleType())
+        .draining.insert(m_shard_position[row]);
+  }
+  return dropped;
+}
+} // namespace component
@@ -0,0 +1,79 @@
+#include "../include/occupancy_feed.hh"
+
+#include <algorithm>
+
+namespace component {
+void OccupancyFeed::Subscription::push(const OccupancyUpdate &update) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unsigned pair = update.level * TOTALVEHICLETYPE + update.vt;
+    auto [it, inserted] = m_pending_index.try_emplace(pair, m_pending.size());
+    if (inserted) {
+      m_pending.push_back(update);
+    } else {
+      m_pending[it->second] = update;
+    }
+  }
+  m_cv.notify_one();
+}
+
+void OccupancyFeed::Subscription::close() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+  }
+  m_cv.notify_all();
+}
+
+[[nodiscard]] auto
+OccupancyFeed::Subscription::wait(std::chrono::milliseconds timeout)
+    -> std::vector<OccupancyUpdate> {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv.wait_for(lock, timeout,
+                [this]() { return m_closed || !m_pending.empty(); });
+  std::vector<OccupancyUpdate> updates;
+  updates.swap(m_pending);
+  m_pending_index.clear();
+  return updates;
+}
+
+[[nodiscard]] auto OccupancyFeed::Subscription::isClosed() -> bool {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_closed;
+}
+
+[[nodiscard]] auto OccupancyFeed::subscribe()
+    -> std::shared_ptr<Subscription> {
+  auto subscription = std::make_shared<Subscription>();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_subscriptions.push_back(subscription);
+  m_subscriber_count.fetch_add(1, std::memory_order_relaxed);
+  return subscription;
+}
+
+void OccupancyFeed::publish(const OccupancyUpdate &update) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto expired = std::remove_if(
+      m_subscriptions.begin(), m_subscriptions.end(),
+      [&update](const std::weak_ptr<Subscription> &weak_subscription) {
+        auto subscription = weak_subscription.lock();
+        if (subscription == nullptr) {
+          return true;
+        }
+        subscription->push(update);
+        return false;
+      });
+  m_subscriber_count.fetch_sub(std::distance(expired, m_subscriptions.end()),
+                               std::memory_order_relaxed);
+  m_subscriptions.erase(expired, m_subscriptions.end());
+}
+
+OccupancyFeed::~OccupancyFeed() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto &weak_subscription : m_subscriptions) {
+    if (auto subscription = weak_subscription.lock()) {
+      subscription->close();
+    }
+  }
+}
+} // namespace component
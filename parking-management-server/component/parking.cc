@@ -1,26 +1,86 @@
 #include "../include/parking.hh"
 
+#include <cstdio>
 #include <ctime>
-#include <regex>
+#include <vector>
 
 #include "../include/utils.hh"
 namespace component {
 auto sql_call_and_check = [](std::string_view filename, int lineno, sqlite3 *db,
                              auto fn) {
   int error_code = fn();
-  if (error_code != SQLITE_OK && error_code != SQLITE_DONE &&
-      error_code != SQLITE_ROW) {
+  bool ok = error_code == SQLITE_OK || error_code == SQLITE_DONE ||
+            error_code == SQLITE_ROW;
+  if (!ok) {
     std::cerr << filename.data() << "@" << lineno << " : " << error_code << "="
               << sqlite3_errmsg(db) << std::endl;
+    Metrics::add(Counter::SQL_ERRORS);
   }
+  return ok;
 };
 
+/// Steps a statement, recording its latency, and reports the failure if any
+auto sql_step_and_check = [](std::string_view filename, int lineno, sqlite3 *db,
+                             sqlite3_stmt *sql_stmt) {
+  ScopedLatency latency(Histogram::SQL_STEP);
+  return sql_call_and_check(filename, lineno, db,
+                            std::bind(sqlite3_step, sql_stmt));
+};
+
+namespace {
+// clang format off
+constexpr const char *create_table_command =
+    "create table if not exists parking ("
+    "slot_key integer primary key,"
+    "occupied_status binary,"
+    "parking_level int,"
+    "vehicle_type int,"
+    "occupied_at time);"
+    "create table if not exists retired_slots ("
+    "slot_key integer primary key);";
+
+constexpr std::array<const char *, 8> sql_statements = {
+    "update parking set occupied_status = true, "
+    "occupied_at = ? where slot_key = ?",
+    "update parking set occupied_status = false where slot_key = ?",
+    "insert or replace into parking values(?, ?, ?, ?, ?);",
+    "delete from parking where slot_key = ?",
+    "insert or ignore into retired_slots values(?);",
+    "delete from retired_slots where slot_key = ?",
+    "begin transaction;",
+    "commit transaction;"};
+// clang format on
+
+/// Resets a cached statement once it goes out of scope so that it neither
+/// keeps stale bindings nor holds on to a read transaction.
+class StatementReset {
+private:
+  sqlite3_stmt *m_stmt;
+
+public:
+  explicit StatementReset(sqlite3_stmt *stmt) : m_stmt(stmt) {}
+  StatementReset(const StatementReset &) = delete;
+  auto operator=(const StatementReset &) -> StatementReset & = delete;
+  ~StatementReset() {
+    sqlite3_reset(m_stmt);
+    sqlite3_clear_bindings(m_stmt);
+  }
+};
+} // namespace
+
 ParkingLot::ParkingLot(std::string name, unsigned parking_level_count)
     : m_parking_name(std::move(name)),
       m_parking_level_count(parking_level_count) {
   openDB();
 }
 
+ParkingLot::ParkingLot(std::string name, unsigned parking_level_count,
+                       std::shared_ptr<ThreadPool> pool)
+    : m_parking_name(std::move(name)),
+      m_parking_level_count(parking_level_count), m_pool(std::move(pool)) {
+  openDB();
+}
+
 void ParkingLot::setName(std::string name) {
   m_parking_name = std::move(name);
   openDB();
@@ -34,328 +94,667 @@ void ParkingLot::openDB() {
   m_db_name = m_parking_name + ".db";
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_open, m_db_name.c_str(), &m_db));
-  sqlite3_stmt *sql_stmt = nullptr;
 
-  // clang format off
-  std::string command = "create table if not exists parking ("
-                        "parking_id varchar(20) primary key,"
-                        "occupied_status binary,"
-                        "parking_level int,"
-                        "vehicle_type varchar(20),"
-                        "occupied_at time);";
-  // clang format on
+  bool legacy = hasLegacySchema();
+  if (legacy) {
+    sql_call_and_check(__FILE__, __LINE__, m_db,
+                       std::bind(sqlite3_exec, m_db,
+                                 "begin transaction;"
+                                 "alter table parking rename to parking_legacy;",
+                                 nullptr, nullptr, nullptr));
+  }
+  sql_call_and_check(__FILE__, __LINE__, m_db,
+                     std::bind(sqlite3_exec, m_db, create_table_command,
+                               nullptr, nullptr, nullptr));
+  prepareStatements();
+  if (legacy) {
+    migrateLegacySlots();
+  } else {
+    // Recover the events which did not make it to a checkpoint
+    std::lock_guard<std::mutex> provision_lock(m_provision_mutex);
+    applyJournal(getCheckpointPath());
+    applyJournal(getJournalPath());
+    if (!loadSnapshot()) {
+      loadOccupancy();
+      m_snapshot_dirty = true;
+    }
+  }
+  loadRetiredSlots();
+  m_snapshot_time = std::chrono::steady_clock::now();
+
+  m_journal.open(getJournalPath());
+  m_sessions.open(getSessionLogPath());
+  m_checkpoint_task =
+      m_pool->scheduleEvery(checkpoint_interval, [this]() { checkpoint(); });
+  m_hold_task = m_pool->scheduleEvery(hold_tick, [this]() { expireHolds(); });
+}
+
+void ParkingLot::applyJournal(const std::string &path) {
+  beginTransaction();
+  Journal::replay(path, [this](const JournalRecord &record) {
+    std::lock_guard<std::mutex> lock(m_db_mutex);
+    if (record.event == JournalRecord::Event::OCCUPY) {
+      sqlite3_stmt *sql_stmt = getStatement(Statement::OCCUPY);
+      StatementReset reset(sql_stmt);
+      sql_call_and_check(
+          __FILE__, __LINE__, m_db,
+          std::bind(sqlite3_bind_int64, sql_stmt, 1, record.occupied_at));
+      sql_call_and_check(
+          __FILE__, __LINE__, m_db,
+          std::bind(sqlite3_bind_int64, sql_stmt, 2, record.slot_key));
+      sql_step_and_check(__FILE__, __LINE__, m_db, sql_stmt);
+    } else {
+      sqlite3_stmt *sql_stmt = getStatement(Statement::RETURN);
+      StatementReset reset(sql_stmt);
+      sql_call_and_check(
+          __FILE__, __LINE__, m_db,
+          std::bind(sqlite3_bind_int64, sql_stmt, 1, record.slot_key));
+      sql_step_and_check(__FILE__, __LINE__, m_db, sql_stmt);
+    }
+  });
+  // A file whose events are not committed is replayed at the next boot
+  if (commitTransaction() &&
+      Journal::concatenate(path, getAppliedJournalPath())) {
+    std::remove(path.c_str());
+  }
+}
 
+void ParkingLot::checkpointJournal() {
+  if (m_journal.rotate(getCheckpointPath())) {
+    applyJournal(getCheckpointPath());
+    m_snapshot_dirty = true;
+  }
+}
+
+auto ParkingLot::loadSnapshot() -> bool {
+  Snapshot snapshot(getSnapshotPath());
+  if (!snapshot.isValid()) {
+    return false;
+  }
+
+  // The events set aside since the Snapshot are applied on top of it in
+  // order, so the latest event of every slot wins
+  std::vector<SlotView> changes;
+  Journal::replay(getAppliedJournalPath(),
+                  [&changes](const JournalRecord &record) {
+                    bool occupied =
+                        record.event == JournalRecord::Event::OCCUPY;
+                    changes.emplace_back(
+                        SlotKey(record.slot_key),
+                        occupied ? SlotState::OCCUPIED : SlotState::AVAILABLE,
+                        record.occupied_at);
+                  });
+  return m_occupancy.load(snapshot.getColumns(), changes);
+}
+
+void ParkingLot::writeSnapshot() {
+  std::lock_guard<std::mutex> lock(m_provision_mutex);
+  // Clear first, a change racing with the Snapshot marks it dirty again
+  m_snapshot_dirty = false;
+  if (!Snapshot::write(getSnapshotPath(), m_occupancy)) {
+    m_snapshot_dirty = true;
+    return;
+  }
+  // Every event set aside happened before the Snapshot was taken
+  std::remove(getAppliedJournalPath().c_str());
+  m_snapshot_time = std::chrono::steady_clock::now();
+}
+
+void ParkingLot::invalidateSnapshot() {
+  std::remove(getSnapshotPath().c_str());
+  std::remove(getAppliedJournalPath().c_str());
+  m_snapshot_dirty = true;
+}
+
+void ParkingLot::checkpoint(bool snapshot) {
+  ScopedLatency latency(Histogram::LOT_CHECKPOINT);
+  std::lock_guard<std::mutex> lock(m_checkpoint_mutex);
+  m_sessions.flush();
+  {
+    std::lock_guard<std::mutex> provision_lock(m_provision_mutex);
+    checkpointJournal();
+    deleteDrainedSlots();
+  }
+  if (m_db != nullptr && m_snapshot_dirty &&
+      (snapshot || std::chrono::steady_clock::now() - m_snapshot_time >=
+                       snapshot_interval)) {
+    writeSnapshot();
+  }
+}
+
+void ParkingLot::stopCheckpoint() {
+  m_pool->cancel(m_checkpoint_task);
+  m_checkpoint_task = ThreadPool::INVALID_TASK;
+}
+
+[[nodiscard]] auto ParkingLot::hasLegacySchema() const -> bool {
+  sqlite3_stmt *sql_stmt = nullptr;
+  std::string command = "select count (name) from pragma_table_info('parking') "
+                        "where name = 'parking_id'";
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
                                &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
+  sql_step_and_check(__FILE__, __LINE__, m_db, sql_stmt);
+  bool legacy = sqlite3_column_int(sql_stmt, 0) != 0;
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_finalize, sql_stmt));
+  return legacy;
 }
 
-[[nodiscard]] auto ParkingLot::getTotalAvailableParking() const -> unsigned {
+void ParkingLot::migrateLegacySlots() {
   sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = false";
-  // clang format on
+  std::string command = "select * from parking_legacy";
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
                                &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
+  while (sqlite3_step(sql_stmt) == SQLITE_ROW) {
+    const char *unique_id =
+        reinterpret_cast<const char *>(sqlite3_column_text(sql_stmt, 0));
+    bool isOccupied = sqlite3_column_int(sql_stmt, 1);
+    std::time_t occupied_at = sqlite3_column_int64(sql_stmt, 4);
+    ParkingSlot slot = makeParkingSlot(unique_id);
+    if (isOccupied) {
+      slot.setParkingTime(occupied_at);
+    }
+    insertParking(std::move(slot));
+  }
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  sql_call_and_check(__FILE__, __LINE__, m_db,
+                     std::bind(sqlite3_exec, m_db,
+                               "drop table parking_legacy;"
+                               "commit transaction;",
+                               nullptr, nullptr, nullptr));
 }
 
-[[nodiscard]] auto ParkingLot::getTotalOccupiedParking() const -> unsigned {
+void ParkingLot::loadOccupancy() {
   sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = true";
-  // clang format on
+  std::string command = "select * from parking";
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
                                &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
+  while (sqlite3_step(sql_stmt) == SQLITE_ROW) {
+    SlotKey key(sqlite3_column_int64(sql_stmt, 0));
+    bool isOccupied = sqlite3_column_int(sql_stmt, 1);
+    std::time_t occupied_at = sqlite3_column_int64(sql_stmt, 4);
+    m_occupancy.addSlot(key, isOccupied, occupied_at);
+  }
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_finalize, sql_stmt));
-  return result;
 }
 
-[[nodiscard]] auto ParkingLot::getAvailableParkingAtLevel(unsigned pl) const
-    -> unsigned {
+void ParkingLot::loadRetiredSlots() {
   sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = false and parking_level = ?";
-  // clang format on
+  std::string command = "select slot_key from retired_slots";
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
                                &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_int, sql_stmt, 1, pl));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
+  while (sqlite3_step(sql_stmt) == SQLITE_ROW) {
+    m_occupancy.drainSlot(SlotKey(sqlite3_column_int64(sql_stmt, 0)));
+  }
   sql_call_and_check(__FILE__, __LINE__, m_db,
                      std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  // Slots released before the lot went down retire right away
+  std::lock_guard<std::mutex> provision_lock(m_provision_mutex);
+  deleteDrainedSlots();
+}
+
+void ParkingLot::deleteDrainedSlots() {
+  auto drained = m_occupancy.takeDrained();
+  if (drained.empty()) {
+    return;
+  }
+  // A Snapshot still has them
+  invalidateSnapshot();
+  beginTransaction();
+  for (const auto &key : drained) {
+    // A slot added back since keeps its row
+    if (!m_occupancy.getSlot(key).isOk()) {
+      executeForSlot(Statement::DELETE, key);
+    }
+    executeForSlot(Statement::KEEP, key);
+  }
+  commitTransaction();
+}
+
+void ParkingLot::prepareStatements() {
+  static_assert(sql_statements.size() == Statement::TOTAL_STATEMENT,
+                "Every statement must have its SQL");
+  for (unsigned index = 0; index < Statement::TOTAL_STATEMENT; index++) {
+    sql_call_and_check(__FILE__, __LINE__, m_db,
+                       std::bind(sqlite3_prepare_v3, m_db,
+                                 sql_statements.at(index), -1,
+                                 SQLITE_PREPARE_PERSISTENT,
+                                 &m_statements.at(index), nullptr));
+  }
+}
+
+void ParkingLot::finalizeStatements() {
+  for (auto &sql_stmt : m_statements) {
+    sql_call_and_check(__FILE__, __LINE__, m_db,
+                       std::bind(sqlite3_finalize, sql_stmt));
+    sql_stmt = nullptr;
+  }
+}
+
+[[nodiscard]] auto ParkingLot::getStatement(Statement statement) const
+    -> sqlite3_stmt * {
+  assert(m_statements.at(statement) != nullptr);
+  return m_statements.at(statement);
+}
+
+[[nodiscard]] auto ParkingLot::getTotalAvailableParking() const -> unsigned {
+  return m_occupancy.getCounters().getTotalAvailable();
+}
+
+[[nodiscard]] auto ParkingLot::getTotalOccupiedParking() const -> unsigned {
+  return m_occupancy.getCounters().getTotalOccupied();
+}
+
+[[nodiscard]] auto ParkingLot::getAvailableParkingAtLevel(unsigned pl) const
+    -> unsigned {
+  return m_occupancy.getCounters().getAvailableAtLevel(pl);
 };
 
 [[nodiscard]] auto ParkingLot::getOccupiedParkingAtLevel(unsigned int pl) const
     -> unsigned {
-  sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = true and parking_level = ?";
-  // clang format on
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_int, sql_stmt, 1, pl));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  return m_occupancy.getCounters().getOccupiedAtLevel(pl);
 }
 
 [[nodiscard]] auto
 ParkingLot::getAvailableParkingForVehicleType(const VehicleType &vt) const
     -> unsigned {
-  sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = false and vehicle_type = ?";
-  // clang format on
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               m_vt_vtstr[static_cast<unsigned>(vt)].c_str(),
-                               -1, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  return m_occupancy.getCounters().getAvailableForVehicleType(vt);
 }
 
 [[nodiscard]] auto
 ParkingLot::getOccupiedParkingForVehicleType(const VehicleType &vt) const
     -> unsigned {
-  sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = true and vehicle_type = ?";
-  // clang format on
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               m_vt_vtstr[static_cast<unsigned>(vt)].c_str(),
-                               -1, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  return m_occupancy.getCounters().getOccupiedForVehicleType(vt);
 }
 
 [[nodiscard]] auto ParkingLot::getAvailableParkingForVehicleTypeAtLevel(
     unsigned level, const VehicleType &vt) const -> unsigned {
-  sqlite3_stmt *sql_stmt = nullptr;
+  return m_occupancy.getCounters().getAvailable(level, vt);
+}
 
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = false and vehicle_type = ? "
-                        "and parking_level = ?";
-  // clang format on
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               m_vt_vtstr[static_cast<unsigned>(vt)].c_str(),
-                               -1, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_int, sql_stmt, 2, level));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+[[nodiscard]] auto ParkingLot::getHeldParkingForVehicleTypeAtLevel(
+    unsigned level, const VehicleType &vt) const -> unsigned {
+  return m_occupancy.getCounters().getHeld(level, vt);
+}
+
+[[nodiscard]] auto ParkingLot::getTotalHeldParking() const -> unsigned {
+  return m_occupancy.getCounters().getTotalHeld();
 }
 
 [[nodiscard]] auto ParkingLot::getOccupiedParkingForVehicleTypeAtLevel(
     unsigned level, const VehicleType &vt) const -> unsigned {
-  sqlite3_stmt *sql_stmt = nullptr;
-
-  // clang format off
-  std::string command = "select count (parking_id) from parking "
-                        "where occupied_status = true and vehicle_type = ? "
-                        "and parking_level = ?";
-  // clang format on
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               m_vt_vtstr[static_cast<unsigned>(vt)].c_str(),
-                               -1, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_int, sql_stmt, 2, level));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  unsigned result = sqlite3_column_int(sql_stmt, 0);
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  return m_occupancy.getCounters().getOccupied(level, vt);
 }
 
 [[nodiscard]] auto ParkingLot::getParking(const VehicleType &vt)
-    -> utils::StatusOr<ParkingSlot> {
-  sqlite3_stmt *sql_stmt = nullptr;
-  utils::StatusOr<ParkingSlot> result;
+    -> utils::StatusOr<SlotView> {
+  ScopedLatency latency(Histogram::LOT_GET_PARKING);
+  uint64_t seq = 0;
+  auto slot = m_occupancy.allocate(
+      vt, std::time(nullptr),
+      [this, &seq](const SlotView &slot) { seq = recordOccupied(slot); });
+  m_journal.waitDurable(seq);
+  if (!slot.isOk()) {
+    Metrics::add(Counter::ALLOCATION_FAILURES);
+  }
+  return slot;
+}
 
-  // clang format off
-  std::string command = "select * from parking where vehicle_type= ? and "
-                        "occupied_status=false limit 1";
-  // clang format on
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               m_vt_vtstr[static_cast<unsigned>(vt)].c_str(),
-                               -1, nullptr));
+[[nodiscard]] auto ParkingLot::checkout(const SlotKey &key)
+    -> utils::StatusOr<Session> {
+  ScopedLatency latency(Histogram::LOT_RETURN_PARKING);
+  // A single capture besides this keeps the observer within the small
+  // buffer of std::function, returns do not allocate
+  struct {
+    uint64_t seq{0};
+    Session session;
+  } returned;
+  bool released = m_occupancy.release(
+      key, [this, &returned](const SlotView &occupied) {
+        returned.seq = recordReturned(occupied, returned.session);
+      });
+  if (released) {
+    m_sessions.append(returned.session);
+  }
+  m_journal.waitDurable(returned.seq);
+  if (!released) {
+    Metrics::add(Counter::RETURN_FAILURES);
+    return utils::StatusOr<Session>(utils::Status::UNAVAILABLE);
+  }
+  return utils::StatusOr<Session>(returned.session);
+}
 
-  if (sqlite3_step(sql_stmt) == SQLITE_ROW) {
-    ParkingSlot slot;
-    slot.setParkingSlotId(
-        reinterpret_cast<const char *>(sqlite3_column_text(sql_stmt, 0)));
-    slot.setParkingLevel(sqlite3_column_int(sql_stmt, 2));
-    slot.setVehicleType(vt);
-    slot.setParkingTime(std::time(nullptr));
-    result.setData(std::move(slot));
+void ParkingLot::setTariff(Tariff tariff) {
+  std::atomic_store(&m_tariff,
+                    std::shared_ptr<const Tariff>(
+                        std::make_shared<const Tariff>(std::move(tariff))));
+}
 
-    sql_call_and_check(__FILE__, __LINE__, m_db,
-                       std::bind(sqlite3_finalize, sql_stmt));
-    std::string command = "update parking set occupied_status = true, "
-                          "occupied_at = ? where parking_id = ?";
-    sql_call_and_check(__FILE__, __LINE__, m_db,
-                       std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                                 &sql_stmt, nullptr));
-    sql_call_and_check(__FILE__, __LINE__, m_db,
-                       std::bind(sqlite3_bind_int64, sql_stmt, 1,
-                                 slot.getParkingTime().getData()));
-    sql_call_and_check(__FILE__, __LINE__, m_db,
-                       std::bind(sqlite3_bind_text, sql_stmt, 2,
-                                 slot.getParkingSlotId().c_str(), -1, nullptr));
-    sql_call_and_check(__FILE__, __LINE__, m_db,
-                       std::bind(sqlite3_step, sql_stmt));
+[[nodiscard]] auto ParkingLot::getTariff() const
+    -> std::shared_ptr<const Tariff> {
+  return std::atomic_load(&m_tariff);
+}
+
+auto ParkingLot::settle(std::time_t from, std::time_t to,
+                        std::size_t chunk_rows) -> SettledSessions {
+  ScopedLatency latency(Histogram::LOT_SETTLE);
+  auto tariff = getTariff();
+  SettledSessions settled;
+  std::vector<Session> sessions;
+  // Sessions still buffered are settled as well
+  m_sessions.flush();
+  SessionLog::read(
+      getSessionLogPath(), chunk_rows,
+      [this, &tariff, &settled, &sessions](const SessionChunk &chunk) {
+        sessions.clear();
+        for (std::size_t i = 0; i < chunk.size(); i++) {
+          sessions.push_back({SlotKey(chunk.slot_keys[i]),
+                              chunk.occupied_at[i], chunk.released_at[i], 0});
+        }
+        settled.count += sessions.size();
+        settled.total_cents += tariff->settle(sessions, *m_pool);
+      },
+      from, to);
+  return settled;
+}
+
+auto ParkingLot::recordOccupied(const SlotView &slot) -> uint64_t {
+  uint64_t seq = m_journal.append(JournalRecord::Event::OCCUPY,
+                                  slot.getSlotKey().getValue(),
+                                  slot.getParkingTime().getData());
+  publishOccupancy(slot.getSlotKey());
+  Metrics::add(Counter::ALLOCATIONS);
+  return seq;
+}
+
+auto ParkingLot::recordReturned(const SlotView &occupied, Session &session)
+    -> uint64_t {
+  session.key = occupied.getSlotKey();
+  session.occupied_at = occupied.getParkingTime().getData();
+  session.released_at = std::time(nullptr);
+  std::atomic_load(&m_tariff)->price(session);
+
+  uint64_t seq = m_journal.append(JournalRecord::Event::RETURN,
+                                  session.key.getValue(), 0);
+  publishOccupancy(session.key);
+  Metrics::add(Counter::RETURNS);
+  return seq;
+}
+
+auto ParkingLot::exportSessions(
+    std::time_t from, std::time_t to, std::size_t chunk_rows,
+    const std::function<void(const SessionChunk &)> &fn) -> std::size_t {
+  // Sessions still buffered are part of the export
+  m_sessions.flush();
+  return SessionLog::read(getSessionLogPath(), chunk_rows, fn, from, to);
+}
+
+auto ParkingLot::exportSlots(ExportFormat format, const ExportSink &sink,
+                             std::size_t chunk_bytes) -> std::size_t {
+  ScopedLatency latency(Histogram::LOT_EXPORT_SLOTS);
+  SlotExporter exporter(format, sink, chunk_bytes);
+  return exporter.write(m_parking_name, m_parking_level_count, m_occupancy);
+}
+
+[[nodiscard]] auto ParkingLot::reserve(const VehicleType &vt,
+                                       std::chrono::seconds hold_for)
+    -> utils::StatusOr<Hold> {
+  ScopedLatency latency(Histogram::LOT_RESERVE);
+  uint64_t hold_id = ++m_next_hold_id;
+  auto slot = m_occupancy.hold(vt, hold_id, [this](const SlotView &slot) {
+    publishOccupancy(slot.getSlotKey());
+  });
+  if (!slot.isOk()) {
+    return utils::StatusOr<Hold>(utils::Status::UNAVAILABLE);
   }
 
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  uint64_t deadline = getHoldTick(std::chrono::steady_clock::now() + hold_for);
+  {
+    std::lock_guard<std::mutex> lock(m_hold_mutex);
+    m_holds.emplace(hold_id,
+                    PendingHold{slot.getData().getSlotKey(),
+                                m_hold_wheel.schedule(deadline, hold_id)});
+  }
+  return utils::StatusOr<Hold>(
+      Hold{hold_id, slot.getData(), std::time(nullptr) + hold_for.count()});
 }
 
-void ParkingLot::returnParking(const ParkingSlot &slot) {
-  sqlite3_stmt *sql_stmt = nullptr;
-  std::string command = "update parking set occupied_status = false "
-                        "where parking_id = ?";
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               slot.getParkingSlotId().c_str(), -1, nullptr));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
+[[nodiscard]] auto ParkingLot::confirm(uint64_t hold_id)
+    -> utils::StatusOr<SlotView> {
+  ScopedLatency latency(Histogram::LOT_CONFIRM);
+  SlotKey key;
+  if (!takeHold(hold_id, key)) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+  uint64_t seq = 0;
+  auto slot = m_occupancy.confirmHold(
+      key, hold_id, std::time(nullptr),
+      [this, &seq](const SlotView &slot) { seq = recordOccupied(slot); });
+  m_journal.waitDurable(seq);
+  return slot;
+}
+
+auto ParkingLot::cancel(uint64_t hold_id) -> bool {
+  ScopedLatency latency(Histogram::LOT_CANCEL);
+  SlotKey key;
+  if (!takeHold(hold_id, key)) {
+    return false;
+  }
+  return m_occupancy.cancelHold(key, hold_id, [this](const SlotView &slot) {
+    publishOccupancy(slot.getSlotKey());
+  });
+}
+
+auto ParkingLot::takeHold(uint64_t hold_id, SlotKey &key) -> bool {
+  std::lock_guard<std::mutex> lock(m_hold_mutex);
+  auto it = m_holds.find(hold_id);
+  if (it == m_holds.end()) {
+    return false;
+  }
+  key = it->second.key;
+  m_hold_wheel.cancel(it->second.timer);
+  m_holds.erase(it);
+  return true;
+}
+
+[[nodiscard]] auto
+ParkingLot::getHoldTick(std::chrono::steady_clock::time_point time) const
+    -> uint64_t {
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time - m_hold_epoch);
+  return static_cast<uint64_t>(
+      (elapsed + hold_tick - std::chrono::nanoseconds(1)) / hold_tick);
+}
+
+void ParkingLot::expireHolds() {
+  {
+    std::lock_guard<std::mutex> lock(m_hold_mutex);
+    // A tick is due once it is fully past
+    uint64_t now = getHoldTick(std::chrono::steady_clock::now());
+    m_hold_wheel.advance(now > 0 ? now - 1 : 0, [this](uint64_t id) {
+      auto it = m_holds.find(id);
+      m_expired_holds.emplace_back(id, it->second.key);
+      m_holds.erase(it);
+    });
+  }
+
+  for (const auto &[hold_id, key] : m_expired_holds) {
+    m_occupancy.cancelHold(key, hold_id, [this](const SlotView &slot) {
+      publishOccupancy(slot.getSlotKey());
+    });
+  }
+  m_expired_holds.clear();
+}
+
+void ParkingLot::stopHoldExpiry() {
+  m_pool->cancel(m_hold_task);
+  m_hold_task = ThreadPool::INVALID_TASK;
+}
+
+void ParkingLot::publishOccupancy(unsigned level, const VehicleType &vt) {
+  if (!m_feed.hasSubscribers()) {
+    return;
+  }
+  const auto &counters = m_occupancy.getCounters();
+  m_feed.publish(OccupancyUpdate{level, vt, counters.getAvailable(level, vt),
+                                 counters.getOccupied(level, vt),
+                                 counters.getHeld(level, vt)});
+}
+
+[[nodiscard]] auto ParkingLot::subscribeOccupancy()
+    -> std::shared_ptr<OccupancyFeed::Subscription> {
+  return m_feed.subscribe();
+}
+
+auto ParkingLot::execute(Statement statement) -> bool {
+  sqlite3_stmt *sql_stmt = getStatement(statement);
+  StatementReset reset(sql_stmt);
+  return sql_step_and_check(__FILE__, __LINE__, m_db, sql_stmt);
+}
+
+void ParkingLot::beginTransaction() {
+  std::lock_guard<std::mutex> lock(m_db_mutex);
+  if (m_transaction_depth++ == 0) {
+    execute(Statement::BEGIN);
+  }
+}
+
+auto ParkingLot::commitTransaction() -> bool {
+  std::lock_guard<std::mutex> lock(m_db_mutex);
+  assert(m_transaction_depth > 0);
+  return --m_transaction_depth == 0 && execute(Statement::COMMIT);
 }
 
 void ParkingLot::addParking(std::string unique_id) {
-  ParkingSlot slot = makeParkingSlot(unique_id);
+  ScopedLatency latency(Histogram::LOT_ADD_PARKING);
+  std::lock_guard<std::mutex> lock(m_provision_mutex);
+  invalidateSnapshot();
+  beginTransaction();
+  insertParking(makeParkingSlot(std::move(unique_id)));
+  deleteDrainedSlots();
+  commitTransaction();
+}
 
-  sqlite3_stmt *sql_stmt = nullptr;
-  std::string command = "insert into parking values(?, ?, ?, ?, ?);";
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
+void ParkingLot::insertParking(ParkingSlot slot) {
+  SlotKey key = slot.getSlotKey();
+  bool occupied = slot.isOccupied();
+  auto occupied_at = slot.getParkingTime();
+  if (!m_occupancy.addSlot(std::move(slot))) {
+    return;
+  }
+  insertRow(key, occupied, occupied_at.valueOr(std::time(nullptr)));
+}
+
+void ParkingLot::insertRow(const SlotKey &key, bool occupied,
+                           std::time_t occupied_at) {
+  std::lock_guard<std::mutex> lock(m_db_mutex);
+  sqlite3_stmt *sql_stmt = getStatement(Statement::INSERT);
+  StatementReset reset(sql_stmt);
+  sql_call_and_check(
+      __FILE__, __LINE__, m_db,
+      std::bind(sqlite3_bind_int64, sql_stmt, 1, key.getValue()));
   sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_bind_text, sql_stmt, 1,
-                               slot.getParkingSlotId().c_str(), -1, nullptr));
+                     std::bind(sqlite3_bind_int, sql_stmt, 2, occupied));
   sql_call_and_check(
       __FILE__, __LINE__, m_db,
-      std::bind(sqlite3_bind_int, sql_stmt, 2, slot.isOccupied()));
+      std::bind(sqlite3_bind_int, sql_stmt, 3, key.getParkingLevel()));
   sql_call_and_check(
       __FILE__, __LINE__, m_db,
-      std::bind(sqlite3_bind_int, sql_stmt, 3, slot.getParkingLevel()));
+      std::bind(sqlite3_bind_int, sql_stmt, 4, key.getVehicleType()));
   sql_call_and_check(
       __FILE__, __LINE__, m_db,
-      std::bind(
-          sqlite3_bind_text, sql_stmt, 4,
-          m_vt_vtstr[static_cast<unsigned>(slot.getVehicleType())].c_str(), -1,
-          nullptr));
+      std::bind(sqlite3_bind_int64, sql_stmt, 5, occupied_at));
+  sql_step_and_check(__FILE__, __LINE__, m_db, sql_stmt);
+}
+
+void ParkingLot::executeForSlot(Statement statement, const SlotKey &key) {
+  std::lock_guard<std::mutex> lock(m_db_mutex);
+  sqlite3_stmt *sql_stmt = getStatement(statement);
+  StatementReset reset(sql_stmt);
   sql_call_and_check(
       __FILE__, __LINE__, m_db,
-      std::bind(sqlite3_bind_int64, sql_stmt, 5, std::time(nullptr)));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_step, sql_stmt));
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
+      std::bind(sqlite3_bind_int64, sql_stmt, 1, key.getValue()));
+  sql_step_and_check(__FILE__, __LINE__, m_db, sql_stmt);
 }
 
-[[nodiscard]] auto ParkingLot::getParkingSlot(std::string unique_id)
-    -> utils::StatusOr<ParkingSlot> {
-  utils::StatusOr<ParkingSlot> result;
-  sqlite3_stmt *sql_stmt = nullptr;
-  std::string command =
-      "select * from parking where parking_id = \"" + unique_id + "\"";
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_prepare_v2, m_db, command.c_str(), -1,
-                               &sql_stmt, nullptr));
-  if (sqlite3_step(sql_stmt) == SQLITE_ROW) {
-    const char *unique_id =
-        reinterpret_cast<const char *>(sqlite3_column_text(sql_stmt, 0));
-    bool isOccupied = sqlite3_column_int(sql_stmt, 1);
-    int level = sqlite3_column_int(sql_stmt, 2);
-    const char *vehicle_type =
-        reinterpret_cast<const char *>(sqlite3_column_text(sql_stmt, 3));
-    assert(m_vtstr_vt_map.find(vehicle_type) != m_vtstr_vt_map.end());
-    VehicleType vt = m_vtstr_vt_map[vehicle_type];
-    std::time_t occupied_at = sqlite3_column_int(sql_stmt, 4);
-    ParkingSlot slot(level, unique_id, vt);
-    if (isOccupied) {
-      slot.setParkingTime(occupied_at);
+auto ParkingLot::reconfigureLevel(unsigned level, const LevelCapacity &capacity)
+    -> utils::StatusOr<LevelChanges> {
+  ScopedLatency latency(Histogram::LOT_RECONFIGURE_LEVEL);
+  if (level >= MAX_PARKING_LEVELS ||
+      std::any_of(capacity.begin(), capacity.end(), [](unsigned slots) {
+        return slots >= max_level_capacity;
+      })) {
+    return utils::StatusOr<LevelChanges>(utils::Status::UNAVAILABLE);
+  }
+
+  LevelChanges changes;
+  std::lock_guard<std::mutex> lock(m_provision_mutex);
+  invalidateSnapshot();
+  beginTransaction();
+  for (unsigned type = 0; type < TOTALVEHICLETYPE; type++) {
+    auto vt = static_cast<VehicleType>(type);
+    std::vector<SlotKey> wanted;
+    wanted.reserve(capacity.at(type));
+    for (unsigned number = 0; number < capacity.at(type); number++) {
+      auto key = SlotKey::make(level, vt, level_zones.at(type), number);
+      if (!key.isOk()) {
+        break;
+      }
+      wanted.push_back(key.getData());
+    }
+
+    auto slots = m_occupancy.reconfigure(level, vt, wanted);
+    for (const auto &key : slots.added) {
+      insertRow(key, false, std::time(nullptr));
+    }
+    for (const auto &key : slots.revived) {
+      insertRow(key, false, std::time(nullptr));
+      executeForSlot(Statement::KEEP, key);
+    }
+    for (const auto &key : slots.kept) {
+      executeForSlot(Statement::KEEP, key);
+    }
+    for (const auto &key : slots.retired) {
+      executeForSlot(Statement::DELETE, key);
+    }
+    for (const auto &key : slots.draining) {
+      executeForSlot(Statement::RETIRE, key);
+    }
+    changes.added += static_cast<unsigned>(
+        slots.added.size() + slots.revived.size() + slots.kept.size());
+    changes.retired += static_cast<unsigned>(slots.retired.size());
+    changes.draining += static_cast<unsigned>(slots.draining.size());
+    if (!slots.added.empty() || !slots.revived.empty() ||
+        !slots.retired.empty()) {
+      publishOccupancy(level, vt);
     }
-    result.setData(slot);
   }
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_finalize, sql_stmt));
-  return result;
+  deleteDrainedSlots();
+  commitTransaction();
+  if (level >= m_parking_level_count) {
+    m_parking_level_count = level + 1;
+  }
+  return utils::StatusOr<LevelChanges>(changes);
+}
+
+[[nodiscard]] auto ParkingLot::getParkingSlot(std::string_view unique_id)
+    -> utils::StatusOr<SlotView> {
+  auto key = SlotKey::parse(unique_id);
+  if (!key.isOk()) {
+    return utils::StatusOr<SlotView>(utils::Status::UNAVAILABLE);
+  }
+  return getParkingSlot(key.getData());
+}
+
+[[nodiscard]] auto ParkingLot::getParkingSlot(const SlotKey &key)
+    -> utils::StatusOr<SlotView> {
+  return m_occupancy.getSlot(key);
 }
 
 void ParkingLot::deleteParkingSlots(int level) {
@@ -363,42 +762,76 @@ void ParkingLot::deleteParkingSlots(int level) {
   if (level != -1) {
     command += " where parking_level = " + std::to_string(level);
   }
-  sql_call_and_check(__FILE__, __LINE__, m_db,
-                     std::bind(sqlite3_exec, m_db, command.c_str(), nullptr,
-                               nullptr, nullptr));
+  command += ";delete from retired_slots where slot_key not in "
+             "(select slot_key from parking);";
+  std::vector<uint64_t> dropped;
+  {
+    std::lock_guard<std::mutex> provision_lock(m_provision_mutex);
+    dropped = m_occupancy.clear(level);
+    // Every event of the dropped slots is journaled once they are cleared.
+    // Apply them before the rows go, under the same lock, so that none is
+    // replayed onto new slots with the same keys.
+    checkpointJournal();
+    invalidateSnapshot();
+
+    std::lock_guard<std::mutex> lock(m_db_mutex);
+    sql_call_and_check(__FILE__, __LINE__, m_db,
+                       std::bind(sqlite3_exec, m_db, command.c_str(), nullptr,
+                                 nullptr, nullptr));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_hold_mutex);
+    for (auto hold_id : dropped) {
+      auto it = m_holds.find(hold_id);
+      if (it != m_holds.end()) {
+        m_hold_wheel.cancel(it->second.timer);
+        m_holds.erase(it);
+      }
+    }
+  }
+  unsigned first = level == -1 ? 0 : static_cast<unsigned>(level);
+  unsigned last = level == -1 ? m_parking_level_count : first + 1;
+  for (unsigned cleared = first; cleared < last; cleared++) {
+    for (unsigned type = 0; type < TOTALVEHICLETYPE; type++) {
+      publishOccupancy(cleared, static_cast<VehicleType>(type));
+    }
+  }
 }
 
 ParkingLot::~ParkingLot() {
+  stopHoldExpiry();
+  stopCheckpoint();
+  checkpoint(true);
+  m_journal.close();
+  m_sessions.close();
+  finalizeStatements();
   sql_call_and_check(__FILE__, __LINE__, m_db, std::bind(sqlite3_close, m_db));
 }
 
-[[nodiscard]] auto ParkingIdParser::parse(std::string unique_id)
-    -> ParkingSlot {
-  m_state_fptr.at(static_cast<unsigned>(States::PARKING_ID))(unique_id);
-  std::regex re("_");
-  std::sregex_token_iterator it(unique_id.begin(), unique_id.end(), re, -1);
-  for (auto index = static_cast<unsigned>(States::PARKING_LEVEL);
-       index < static_cast<unsigned>(States::TOTAL_STATE); index++, it++) {
-    m_state_fptr.at(index)(*it);
-  }
-  return m_parking_slot;
-}
-
 [[nodiscard]] auto makeParkingSlot(std::string unique_id) -> ParkingSlot {
-  return ParkingIdParser::parse(std::move(unique_id));
+  auto key = SlotKey::parse(unique_id);
+  if (!key.isOk()) {
+    ParkingSlot slot;
+    slot.setParkingSlotId(std::move(unique_id));
+    return slot;
+  }
+  return ParkingSlot(key.getData());
 }
 
-/// Dumper routine for component::ParkingSlot
+/// Writes component::ParkingSlot as a single line JSON object
 auto operator<<(std::ostream &os, const component::ParkingSlot &obj)
     -> std::ostream & {
-  PRINT_CONTAINER_START();
-  PRINT_FIELD("Parking Level : ", obj.m_parking_level);
-  PRINT_FIELD("Parking Id : ", obj.m_parking_slot_id);
-  PRINT_FIELD("Vehicle Type : ", obj.m_vt);
-  PRINT_FIELD("Occupied : ", obj.m_occupied);
-  PRINT_FIELD("Occupied at :",
-              std::asctime(std::localtime(&obj.m_occupied_at)));
-  PRINT_CONTAINER_END();
-  return os;
+  os << "{\"id\":\"" << obj.m_parking_slot_id
+     << "\",\"level\":" << obj.m_parking_level << ",\"vehicle_type\":\""
+     << (obj.m_vt < TOTALVEHICLETYPE ? m_vt_vtstr.at(obj.m_vt) : "UNKNOWN")
+     << "\",\"occupied\":" << (obj.m_occupied ? "true" : "false")
+     << ",\"occupied_at\":";
+  if (obj.m_occupied) {
+    os << static_cast<int64_t>(obj.m_occupied_at);
+  } else {
+    os << "null";
+  }
+  return os << "}";
 }
 } // namespace component
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "../include/session_log.hh"
+
+#include <utility>
+
+namespace component {
+void SessionChunk::clear() {
+  slot_keys.clear();
+  parking_levels.clear();
+  vehicle_types.clear();
+  occupied_at.clear();
+  released_at.clear();
+  fees_cents.clear();
+}
+
+void SessionChunk::reserve(std::size_t rows) {
+  slot_keys.reserve(rows);
+  parking_levels.reserve(rows);
+  vehicle_types.reserve(rows);
+  occupied_at.reserve(rows);
+  released_at.reserve(rows);
+  fees_cents.reserve(rows);
+}
+
+void SessionChunk::push_back(const SessionRecord &record) {
+  SlotKey key(record.slot_key);
+  slot_keys.push_back(record.slot_key);
+  parking_levels.push_back(static_cast<uint8_t>(key.getParkingLevel()));
+  vehicle_types.push_back(static_cast<uint8_t>(key.getVehicleType()));
+  occupied_at.push_back(record.occupied_at);
+  released_at.push_back(record.released_at);
+  fees_cents.push_back(record.fee_cents);
+}
+
+void SessionLog::open(std::string path) {
+  if (isOpen()) {
+    return;
+  }
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  std::size_t intact = RecordFile<SessionRecord>::countRecords(path);
+  m_file.open(std::move(path), intact);
+}
+
+void SessionLog::append(const Session &session) {
+  SessionRecord record;
+  record.slot_key = session.key.getValue();
+  record.occupied_at = session.occupied_at;
+  record.released_at = session.released_at;
+  record.fee_cents = session.fee_cents;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.push(record);
+    if (m_file.getPendingCount() <
+        RecordFile<SessionRecord>::buffer_capacity) {
+      return;
+    }
+  }
+  flush();
+}
+
+void SessionLog::flush() {
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.takePending();
+  }
+  m_file.writeTaken();
+}
+
+void SessionLog::close() {
+  flush();
+  std::lock_guard<std::mutex> file_lock(m_file_mutex);
+  m_file.close();
+}
+
+auto SessionLog::read(const std::string &path, std::size_t chunk_rows,
+                      const std::function<void(const SessionChunk &)> &fn,
+                      std::time_t from, std::time_t to) -> std::size_t {
+  std::size_t count = 0;
+  SessionChunk chunk;
+  chunk.reserve(chunk_rows == 0 ? 1 : chunk_rows);
+  RecordFile<SessionRecord>::read(
+      path, chunk_rows,
+      [&](const SessionRecord *records, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++) {
+          if (records[i].released_at >= from && records[i].released_at < to) {
+            chunk.push_back(records[i]);
+          }
+        }
+        if (chunk.size() != 0) {
+          count += chunk.size();
+          fn(chunk);
+          chunk.clear();
+        }
+        return true;
+      });
+  return count;
+}
+
+SessionLog::~SessionLog() { close(); }
+} // namespace component
@@ -0,0 +1,136 @@
+#include "../include/slot_key.hh"
+
+#include <array>
+#include <charconv>
+
+namespace component {
+namespace {
+/// Maps a zone character to its base 37 digit, 0 if it can't be encoded
+constexpr auto encode_zone_char(char zone_char) -> unsigned {
+  if (zone_char >= '0' && zone_char <= '9') {
+    return zone_char - '0' + 1;
+  }
+  if (zone_char >= 'A' && zone_char <= 'Z') {
+    return zone_char - 'A' + 11;
+  }
+  return 0;
+}
+
+/// Maps a non zero base 37 digit back to its zone character
+constexpr auto decode_zone_char(unsigned digit) -> char {
+  return digit <= 10 ? static_cast<char>('0' + digit - 1)
+                     : static_cast<char>('A' + digit - 11);
+}
+} // namespace
+
+[[nodiscard]] auto ParkingIdParser::parseNumber(std::string_view field,
+                                                unsigned &number) -> bool {
+  if (field.empty()) {
+    return false;
+  }
+  auto [ptr, ec] =
+      std::from_chars(field.data(), field.data() + field.size(), number);
+  return ec == std::errc() && ptr == field.data() + field.size();
+}
+
+[[nodiscard]] auto ParkingIdParser::parse(std::string_view unique_id)
+    -> utils::StatusOr<ParkingId> {
+  std::array<std::string_view, States::TOTAL_STATE> fields;
+  std::size_t start = 0;
+  for (unsigned index = 0; index < States::TOTAL_STATE; index++) {
+    std::size_t end = unique_id.find('_', start);
+    bool last = index + 1 == States::TOTAL_STATE;
+    if ((end == std::string_view::npos) != last) {
+      return utils::StatusOr<ParkingId>(utils::Status::UNAVAILABLE);
+    }
+    fields.at(index) = unique_id.substr(start, end - start);
+    start = end + 1;
+  }
+
+  ParkingId parking_id;
+  parking_id.vt = toVehicleType(fields[States::VEHICLE_TYPE]);
+  parking_id.zone = fields[States::PARKING_ZONE];
+  if (!parseNumber(fields[States::PARKING_LEVEL], parking_id.level) ||
+      !parseNumber(fields[States::PARKING_NUMBER], parking_id.number) ||
+      parking_id.vt == VehicleType::TOTALVEHICLETYPE ||
+      parking_id.zone.empty()) {
+    return utils::StatusOr<ParkingId>(utils::Status::UNAVAILABLE);
+  }
+  return utils::StatusOr<ParkingId>(parking_id);
+}
+
+[[nodiscard]] auto SlotKey::make(unsigned level, const VehicleType &vt,
+                                 std::string_view zone, unsigned number)
+    -> utils::StatusOr<SlotKey> {
+  if (level >= (1U << LEVEL_BITS) || vt >= VehicleType::TOTALVEHICLETYPE ||
+      number >= (1U << NUMBER_BITS) || zone.empty() ||
+      zone.size() > MAX_ZONE_LENGTH) {
+    return utils::StatusOr<SlotKey>(utils::Status::UNAVAILABLE);
+  }
+
+  uint64_t encoded_zone = 0;
+  for (unsigned index = 0; index < MAX_ZONE_LENGTH; index++) {
+    unsigned digit = 0;
+    if (index < zone.size()) {
+      digit = encode_zone_char(zone[index]);
+      if (digit == 0) {
+        return utils::StatusOr<SlotKey>(utils::Status::UNAVAILABLE);
+      }
+    }
+    encoded_zone = encoded_zone * ZONE_RADIX + digit;
+  }
+
+  return utils::StatusOr<SlotKey>(SlotKey(
+      (uint64_t{level} << LEVEL_SHIFT) |
+      (uint64_t{static_cast<unsigned>(vt)} << VEHICLE_TYPE_SHIFT) |
+      (encoded_zone << ZONE_SHIFT) | uint64_t{number}));
+}
+
+[[nodiscard]] auto SlotKey::parse(std::string_view unique_id)
+    -> utils::StatusOr<SlotKey> {
+  auto parking_id = ParkingIdParser::parse(unique_id);
+  if (!parking_id.isOk()) {
+    return utils::StatusOr<SlotKey>(utils::Status::UNAVAILABLE);
+  }
+  const ParkingId &fields = parking_id.getData();
+  return make(fields.level, fields.vt, fields.zone, fields.number);
+}
+
+[[nodiscard]] auto SlotKey::getZone() const -> std::string {
+  std::array<unsigned, MAX_ZONE_LENGTH> digits{};
+  unsigned encoded_zone = field(ZONE_SHIFT, ZONE_BITS);
+  for (unsigned index = MAX_ZONE_LENGTH; index > 0; index--) {
+    digits.at(index - 1) = encoded_zone % ZONE_RADIX;
+    encoded_zone /= ZONE_RADIX;
+  }
+
+  std::string zone;
+  for (unsigned digit : digits) {
+    if (digit == 0) {
+      break;
+    }
+    zone += decode_zone_char(digit);
+  }
+  return zone;
+}
+
+[[nodiscard]] auto SlotKey::toString() const -> std::string {
+  if (!isValid()) {
+    return std::string();
+  }
+
+  std::string unique_id = std::to_string(getParkingLevel());
+  unique_id += '_';
+  for (const auto &vehicle_code : vehicle_codes) {
+    if (vehicle_code.second == getVehicleType()) {
+      unique_id += vehicle_code.first;
+      break;
+    }
+  }
+  unique_id += '_';
+  unique_id += getZone();
+  unique_id += '_';
+  unique_id += std::to_string(getNumber());
+  return unique_id;
+}
+} // namespace component
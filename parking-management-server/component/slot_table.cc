@@ -0,0 +1,29 @@
+#include "../include/slot_table.hh"
+
+namespace component {
+void SlotTable::reserve(std::size_t rows) {
+  m_keys.reserve(rows);
+  m_levels.reserve(rows);
+  m_vehicle_types.reserve(rows);
+  m_states.reserve(rows);
+  m_occupied_at.reserve(rows);
+}
+
+void SlotTable::clear() {
+  m_keys.clear();
+  m_levels.clear();
+  m_vehicle_types.clear();
+  m_states.clear();
+  m_occupied_at.clear();
+}
+
+auto SlotTable::append(const SlotKey &key, bool occupied,
+                       std::time_t occupied_at) -> std::size_t {
+  m_keys.push_back(key.getValue());
+  m_levels.push_back(static_cast<uint8_t>(key.getParkingLevel()));
+  m_vehicle_types.push_back(static_cast<uint8_t>(key.getVehicleType()));
+  m_states.push_back(occupied ? SlotState::OCCUPIED : SlotState::AVAILABLE);
+  m_occupied_at.push_back(occupied ? occupied_at : 0);
+  return m_keys.size() - 1;
+}
+} // namespace component
@@ -0,0 +1,162 @@
+#include "../include/snapshot.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "../include/utils.hh"
+
+namespace component {
+namespace {
+using utils::sys_call_and_check;
+using utils::writeAll;
+
+/// Rounds the offset up to the alignment of the sections
+constexpr auto align(uint64_t offset) -> uint64_t {
+  return (offset + 7) & ~7ULL;
+}
+} // namespace
+
+Snapshot::Snapshot(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return;
+  }
+  struct stat st {};
+  if (sys_call_and_check(__FILE__, __LINE__, ::fstat(fd, &st)) == 0 &&
+      static_cast<std::size_t>(st.st_size) >= sizeof(SnapshotHeader)) {
+    void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      m_data = static_cast<const char *>(data);
+      m_size = st.st_size;
+    }
+  }
+  ::close(fd);
+  if (m_data == nullptr) {
+    return;
+  }
+
+  const auto *header = reinterpret_cast<const SnapshotHeader *>(m_data);
+  m_header = header;
+  if (!validate()) {
+    m_header = nullptr;
+    return;
+  }
+  m_keys = reinterpret_cast<const uint64_t *>(m_data + header->keys_offset);
+  m_occupancy =
+      reinterpret_cast<const uint64_t *>(m_data + header->occupancy_offset);
+  m_occupied_at =
+      reinterpret_cast<const int64_t *>(m_data + header->occupied_at_offset);
+  // The sections are read front to back right after being mapped
+  ::madvise(const_cast<char *>(m_data), m_size, MADV_SEQUENTIAL);
+}
+
+[[nodiscard]] auto Snapshot::validate() const -> bool {
+  if (std::memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      m_header->version != VERSION ||
+      m_header->header_size != sizeof(SnapshotHeader) ||
+      m_header->file_size != m_size) {
+    return false;
+  }
+
+  uint64_t count = m_header->slot_count;
+  auto fits = [this](uint64_t offset, uint64_t bytes) {
+    return offset % 8 == 0 && offset >= sizeof(SnapshotHeader) &&
+           offset <= m_size && bytes <= m_size - offset;
+  };
+  return count <= m_size / sizeof(uint64_t) &&
+         fits(m_header->keys_offset, count * sizeof(uint64_t)) &&
+         fits(m_header->occupancy_offset,
+              (count + 63) / 64 * sizeof(uint64_t)) &&
+         fits(m_header->occupied_at_offset, count * sizeof(int64_t));
+}
+
+auto Snapshot::write(const std::string &path, const OccupancyEngine &engine)
+    -> bool {
+  std::vector<uint64_t> keys;
+  std::vector<uint64_t> occupancy;
+  std::vector<int64_t> occupied_at;
+  // Copy the columns out under the engine lock, the file is written after
+  engine.readTable([&](const SlotTable &table) {
+    const auto &states = table.getStates();
+    bool retired = std::find(states.begin(), states.end(),
+                             SlotState::RETIRED) != states.end();
+    if (!retired) {
+      keys = table.getKeys();
+      occupied_at.assign(table.getOccupiedAt().begin(),
+                         table.getOccupiedAt().end());
+    } else {
+      // Retired slots are left out
+      for (std::size_t row = 0; row < states.size(); row++) {
+        if (states[row] != SlotState::RETIRED) {
+          keys.push_back(table.getKeys()[row]);
+          occupied_at.push_back(table.getOccupiedAt()[row]);
+        }
+      }
+    }
+    // Holds are not kept across restarts, held slots are saved available
+    occupancy.assign((keys.size() + 63) / 64, 0);
+    std::size_t index = 0;
+    for (auto state : states) {
+      if (state == SlotState::RETIRED) {
+        continue;
+      }
+      uint64_t occupied = state == SlotState::OCCUPIED ? 1 : 0;
+      occupancy[index / 64] |= occupied << (index % 64);
+      index++;
+    }
+  });
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.header_size = sizeof(SnapshotHeader);
+  header.slot_count = keys.size();
+  header.keys_offset = align(sizeof(SnapshotHeader));
+  header.occupancy_offset =
+      align(header.keys_offset + keys.size() * sizeof(uint64_t));
+  header.occupied_at_offset =
+      align(header.occupancy_offset + occupancy.size() * sizeof(uint64_t));
+  header.file_size =
+      header.occupied_at_offset + occupied_at.size() * sizeof(int64_t);
+
+  std::string temp_path = path + ".tmp";
+  int fd = sys_call_and_check(
+      __FILE__, __LINE__,
+      ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+             0644));
+  if (fd == -1) {
+    return false;
+  }
+  // Every section starts 8 byte aligned and every element is 8 bytes, so the
+  // sections follow each other without padding
+  writeAll(fd, reinterpret_cast<const char *>(&header), sizeof(header));
+  writeAll(fd, reinterpret_cast<const char *>(keys.data()),
+           keys.size() * sizeof(uint64_t));
+  writeAll(fd, reinterpret_cast<const char *>(occupancy.data()),
+           occupancy.size() * sizeof(uint64_t));
+  writeAll(fd, reinterpret_cast<const char *>(occupied_at.data()),
+           occupied_at.size() * sizeof(int64_t));
+  bool synced = sys_call_and_check(__FILE__, __LINE__, ::fsync(fd)) == 0;
+  ::close(fd);
+  if (!synced) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return sys_call_and_check(
+             __FILE__, __LINE__,
+             std::rename(temp_path.c_str(), path.c_str())) == 0;
+}
+
+Snapshot::~Snapshot() {
+  if (m_data != nullptr) {
+    ::munmap(const_cast<char *>(m_data), m_size);
+  }
+}
+} // namespace component
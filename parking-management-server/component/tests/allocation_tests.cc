@@ -0,0 +1,73 @@
+#include <cstdlib>
+#include <new>
+
+#include "../../include/parking.hh"
+#include "gtest/gtest.h"
+
+namespace {
+/// Heap allocations made by the current thread while counting is on. Other
+/// threads, the Journal writer and the checkpointer, are left out.
+thread_local bool counting = false;
+thread_local std::size_t allocations = 0;
+
+/// Counts the heap allocations of the current thread over its lifetime
+class AllocationCounter {
+public:
+  AllocationCounter() {
+    allocations = 0;
+    counting = true;
+  }
+  AllocationCounter(const AllocationCounter &) = delete;
+  auto operator=(const AllocationCounter &) -> AllocationCounter & = delete;
+
+  [[nodiscard]] inline auto getCount() const -> std::size_t {
+    return allocations;
+  }
+
+  ~AllocationCounter() { counting = false; }
+};
+} // namespace
+
+auto operator new(std::size_t size) -> void * {
+  if (counting) {
+    allocations++;
+  }
+  if (void *data = std::malloc(size == 0 ? 1 : size)) {
+    return data;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *data) noexcept { std::free(data); }
+
+void operator delete(void *data, std::size_t) noexcept { std::free(data); }
+
+TEST(ParkingLot, ParkingLotAllocationFree) {
+  component::ParkingLot parkinglot("AllocationFree", 2);
+  parkinglot.setDurability(component::Durability::PERIODIC);
+  parkinglot.deleteParkingSlots();
+  parkinglot.addParking("0_CA_A_0");
+  parkinglot.addParking("1_CA_A_0");
+
+  // Warm up the buffers on the way
+  for (int i = 0; i < 8; i++) {
+    auto slot = parkinglot.getParking(component::VehicleType::CAR);
+    ASSERT_EQ(parkinglot.returnParking(slot.getData()), true)
+        << "Unable to return the slot" << std::endl;
+  }
+
+  constexpr int rounds = 100;
+  int allocated = 0;
+  std::size_t count = 0;
+  {
+    AllocationCounter counter;
+    for (int i = 0; i < rounds; i++) {
+      auto slot = parkinglot.getParking(component::VehicleType::CAR);
+      allocated += slot.isOk() ? 1 : 0;
+      parkinglot.returnParking(slot.getData());
+    }
+    count = counter.getCount();
+  }
+  ASSERT_EQ(allocated, rounds) << "Unable to allocate a slot" << std::endl;
+  ASSERT_EQ(count, 0) << "getParking must not allocate" << std::endl;
+}
@@ -1,6 +1,17 @@
+#include <sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <thread>
 
+#include "../../include/lot_registry.hh"
+#include "../../include/metrics.hh"
 #include "../../include/parking.hh"
 #include "gtest/gtest.h"
 
@@ -108,4 +119,1266 @@ TEST(ParkingLot, ParkingLotAPI) {
       << "Incorrect available count" << std::endl;
   ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 0)
       << "Incorrect occupied count" << std::endl;
-}
\ No newline at end of file
+}
+
+TEST(OccupancyEngine, OccupancyEngineAPI) {
+  component::OccupancyEngine engine;
+  ASSERT_EQ(engine.addSlot(component::makeParkingSlot("0_MC_A_0")), true)
+      << "Unable to add a slot" << std::endl;
+  ASSERT_EQ(engine.addSlot(component::makeParkingSlot("0_MC_A_0")), false)
+      << "Duplicate slot must not be added" << std::endl;
+  ASSERT_EQ(engine.addSlot(component::makeParkingSlot("2_MC_A_0")), true)
+      << "Unable to add a slot" << std::endl;
+  ASSERT_EQ(engine.getLevelCount(), 3) << "Incorrect level count" << std::endl;
+
+  auto slot = engine.allocate(component::VehicleType::MOTORCYCLE, 10);
+  ASSERT_EQ(slot.isOk(), true) << "Unable to allocate a slot" << std::endl;
+  ASSERT_EQ(slot.getData().getParkingLevel(), 0)
+      << "Lowest level must be allocated first" << std::endl;
+  ASSERT_EQ(engine.getCounters().getOccupied(
+                0, component::VehicleType::MOTORCYCLE),
+            1)
+      << "Incorrect occupied count" << std::endl;
+  ASSERT_EQ(engine.allocate(component::VehicleType::CAR, 10).isOk(), false)
+      << "No car slot must be available" << std::endl;
+
+  ASSERT_EQ(engine.release(slot.getData().getSlotKey()), true)
+      << "Unable to release the slot" << std::endl;
+  ASSERT_EQ(engine.release(slot.getData().getSlotKey()), false)
+      << "Slot must not be released twice" << std::endl;
+  ASSERT_EQ(engine.getCounters().getAvailable(
+                0, component::VehicleType::MOTORCYCLE),
+            1)
+      << "Incorrect available count" << std::endl;
+
+  ASSERT_EQ(engine.countOccupied(0, component::VehicleType::MOTORCYCLE), 0)
+      << "Bitmap must agree with the counters" << std::endl;
+
+  engine.clear(0);
+  ASSERT_EQ(engine.getSlot(component::SlotKey::parse("0_MC_A_0").getData())
+                .isOk(), false)
+      << "Slot must be removed with its level" << std::endl;
+  ASSERT_EQ(engine.getCounters().getAvailable(
+                2, component::VehicleType::MOTORCYCLE),
+            1)
+      << "Other levels must be retained" << std::endl;
+}
+
+TEST(OccupancyEngine, OccupancySlotSelection) {
+  auto allocateId = [](component::OccupancyEngine &engine) {
+    return engine.allocate(component::VehicleType::CAR, 10)
+        .getData()
+        .getParkingSlotId();
+  };
+
+  component::OccupancyEngine engine;
+  for (const auto *id :
+       {"1_CA_A_0", "0_CA_B_7", "0_CA_B_1", "0_CA_A_3", "1_CA_A_1"}) {
+    engine.addSlot(component::makeParkingSlot(id));
+  }
+  ASSERT_EQ(allocateId(engine), "0_CA_B_7")
+      << "Lowest level must be allocated in insertion order" << std::endl;
+
+  engine.setSlotSelection(component::SlotSelection::LEAST_LOADED_LEVEL);
+  ASSERT_EQ(allocateId(engine), "1_CA_A_0")
+      << "Least loaded level must be allocated" << std::endl;
+  ASSERT_EQ(allocateId(engine), "0_CA_B_1")
+      << "Least loaded level must be allocated" << std::endl;
+
+  engine.setSlotSelection(component::SlotSelection::ZONE_PACKING);
+  ASSERT_EQ(allocateId(engine), "0_CA_A_3")
+      << "Lowest zone must be allocated first" << std::endl;
+  ASSERT_EQ(engine.release(component::SlotKey::parse("0_CA_B_1").getData()),
+            true)
+      << "Unable to release the slot" << std::endl;
+  ASSERT_EQ(engine.release(component::SlotKey::parse("0_CA_B_7").getData()),
+            true)
+      << "Unable to release the slot" << std::endl;
+  ASSERT_EQ(allocateId(engine), "0_CA_B_1")
+      << "Released slots must be ranked again" << std::endl;
+
+  engine.setSlotSelection(component::SlotSelection::NEAREST_ENTRANCE);
+  ASSERT_EQ(allocateId(engine), "0_CA_B_7")
+      << "Nearest slot must be allocated first" << std::endl;
+  ASSERT_EQ(allocateId(engine), "1_CA_A_1")
+      << "Nearest slot must be allocated first" << std::endl;
+  ASSERT_EQ(engine.allocate(component::VehicleType::CAR, 10).isOk(), false)
+      << "No car slot must be available" << std::endl;
+
+  // Entrance at the top level
+  engine.setSlotSelection(component::SlotSelection::NEAREST_ENTRANCE,
+                          [](const component::SlotKey &key) -> uint64_t {
+                            return 1 - key.getParkingLevel();
+                          });
+  for (const auto *id : {"0_CA_B_7", "1_CA_A_0"}) {
+    engine.release(component::SlotKey::parse(id).getData());
+  }
+  ASSERT_EQ(allocateId(engine), "1_CA_A_0")
+      << "Custom distance must be honored" << std::endl;
+}
+
+TEST(SlotTable, SlotTableAPI) {
+  component::SlotTable table;
+  auto key = component::SlotKey::parse("3_MC_C_7").getData();
+  ASSERT_EQ(table.append(key, false, 42), 0) << "Incorrect row" << std::endl;
+  ASSERT_EQ(table.append(component::SlotKey::parse("0_CA_B_1").getData(), true,
+                         10),
+            1)
+      << "Incorrect row" << std::endl;
+  ASSERT_EQ(table.getParkingLevel(0), 3) << "Incorrect level" << std::endl;
+  ASSERT_EQ(table.getVehicleType(0), component::VehicleType::MOTORCYCLE)
+      << "Incorrect VehicleType" << std::endl;
+  ASSERT_EQ(table.getOccupiedAt(0), 0)
+      << "Available rows have no occupied_at" << std::endl;
+
+  table.occupy(0, 20);
+  auto view = table.getView(0);
+  ASSERT_EQ(view.getParkingSlotId(), "3_MC_C_7")
+      << "Incorrect unique_id" << std::endl;
+  ASSERT_EQ(view.getParkingTime().getData(), 20)
+      << "Incorrect occupied_at" << std::endl;
+  table.release(0);
+  ASSERT_EQ(view.isOccupied(), true)
+      << "A view must not follow the table" << std::endl;
+  ASSERT_EQ(table.getView(0).getParkingTime().isOk(), false)
+      << "Released row must be available" << std::endl;
+  ASSERT_EQ(table.getStates(),
+            (std::vector<component::SlotState>{
+                component::SlotState::AVAILABLE,
+                component::SlotState::OCCUPIED}))
+      << "Incorrect state column" << std::endl;
+}
+
+TEST(OccupancyBitmap, OccupancyBitmapAPI) {
+  for (int kernel = component::OccupancyBitmap::SCALAR;
+       kernel < component::OccupancyBitmap::TOTAL_KERNEL; kernel++) {
+    if (!component::OccupancyBitmap::setKernel(
+            static_cast<component::OccupancyBitmap::Kernel>(kernel))) {
+      continue;
+    }
+
+    component::OccupancyBitmap bitmap;
+    ASSERT_EQ(bitmap.findFirstZero(), component::OccupancyBitmap::npos)
+        << "Empty bitmap has no clear bit" << std::endl;
+    for (std::size_t i = 0; i < 1000; i++) {
+      bitmap.push_back(i != 700 && i != 999);
+    }
+    ASSERT_EQ(bitmap.count(), 998) << "Incorrect count" << std::endl;
+    ASSERT_EQ(bitmap.findFirstZero(), 700)
+        << "Incorrect first clear bit" << std::endl;
+    ASSERT_EQ(bitmap.findFirstZero(701), 999)
+        << "Search must start at the given bit" << std::endl;
+
+    bitmap.set(700);
+    bitmap.set(999);
+    ASSERT_EQ(bitmap.findFirstZero(), component::OccupancyBitmap::npos)
+        << "Bits past the size must not be found" << std::endl;
+    bitmap.reset(3);
+    ASSERT_EQ(bitmap.test(3), false) << "Bit must be cleared" << std::endl;
+    ASSERT_EQ(bitmap.findFirstZero(), 3)
+        << "Incorrect first clear bit" << std::endl;
+    ASSERT_EQ(bitmap.count(), 999) << "Incorrect count" << std::endl;
+  }
+  component::OccupancyBitmap::setKernel(component::OccupancyBitmap::AVX2);
+}
+
+TEST(TimerWheel, TimerWheelAPI) {
+  component::TimerWheel wheel;
+  std::vector<uint64_t> fired;
+  auto collect = [&fired](uint64_t payload) { fired.push_back(payload); };
+
+  // One timer per level of the wheel, and one beyond its span
+  std::vector<uint64_t> deadlines = {5,    64,     100,    4096,
+                                     5000, 300000, 20000000};
+  for (auto deadline : deadlines) {
+    wheel.schedule(deadline, deadline);
+  }
+  auto cancelled = wheel.schedule(70, 70);
+  ASSERT_EQ(wheel.size(), deadlines.size() + 1)
+      << "Incorrect number of timers" << std::endl;
+  ASSERT_EQ(wheel.cancel(cancelled), true)
+      << "Pending timer must be cancelled" << std::endl;
+  ASSERT_EQ(wheel.cancel(cancelled), false)
+      << "Timer must only be cancelled once" << std::endl;
+
+  for (std::size_t i = 0; i < deadlines.size(); i++) {
+    wheel.advance(deadlines[i] - 1, collect);
+    ASSERT_EQ(fired.size(), i)
+        << "Timer must not fire before its deadline" << std::endl;
+    wheel.advance(deadlines[i], collect);
+    ASSERT_EQ(fired.size(), i + 1)
+        << "Timer must fire at its deadline" << std::endl;
+  }
+  ASSERT_EQ(fired, deadlines) << "Timers must fire in order" << std::endl;
+  ASSERT_EQ(wheel.size(), 0) << "All the timers must be fired" << std::endl;
+
+  wheel.schedule(wheel.getNow(), 1);
+  wheel.advance(wheel.getNow() + 1, collect);
+  ASSERT_EQ(fired.back(), 1) << "Past deadline must fire on the next tick"
+                             << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotReservation) {
+  component::ParkingLot parkinglot("Reservation", 1);
+  parkinglot.deleteParkingSlots();
+  parkinglot.addParking("0_CA_A_0");
+  parkinglot.addParking("0_CA_A_1");
+
+  auto hold = parkinglot.reserve(component::VehicleType::CAR,
+                                 std::chrono::seconds(60));
+  ASSERT_EQ(hold.isOk(), true) << "Unable to reserve a slot" << std::endl;
+  ASSERT_EQ(hold.getData().slot.isHeld(), true)
+      << "Reserved slot must be held" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalHeldParking(), 1)
+      << "Incorrect held slots" << std::endl;
+  ASSERT_EQ(parkinglot.getHeldParkingForVehicleTypeAtLevel(
+                0, component::VehicleType::CAR),
+            1)
+      << "Incorrect held slots" << std::endl;
+  ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(
+                component::VehicleType::CAR),
+            1)
+      << "Held slot must not be available" << std::endl;
+
+  auto other = parkinglot.getParking(component::VehicleType::CAR);
+  ASSERT_EQ(other.isOk(), true) << "Free slot must be allocated" << std::endl;
+  ASSERT_NE(other.getData().getSlotKey(), hold.getData().slot.getSlotKey())
+      << "Held slot must not be allocated" << std::endl;
+  ASSERT_EQ(parkinglot.reserve(component::VehicleType::CAR,
+                               std::chrono::seconds(60))
+                .isOk(),
+            false)
+      << "Full lot must not be reserved" << std::endl;
+
+  ASSERT_EQ(parkinglot.cancel(hold.getData().id), true)
+      << "Pending hold must be cancelled" << std::endl;
+  ASSERT_EQ(parkinglot.confirm(hold.getData().id).isOk(), false)
+      << "Cancelled hold must not be confirmed" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalHeldParking(), 0)
+      << "Incorrect held slots" << std::endl;
+
+  hold = parkinglot.reserve(component::VehicleType::CAR,
+                            std::chrono::seconds(60));
+  ASSERT_EQ(hold.isOk(), true) << "Unable to reserve a slot" << std::endl;
+  auto slot = parkinglot.confirm(hold.getData().id);
+  ASSERT_EQ(slot.isOk(), true) << "Unable to confirm the hold" << std::endl;
+  ASSERT_EQ(slot.getData().isOccupied(), true)
+      << "Confirmed slot must be occupied" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 2)
+      << "Incorrect occupied slots" << std::endl;
+  ASSERT_EQ(parkinglot.cancel(hold.getData().id), false)
+      << "Confirmed hold must not be cancelled" << std::endl;
+
+  ASSERT_EQ(parkinglot.returnParking(slot.getData()), true)
+      << "Unable to return the slot" << std::endl;
+  hold = parkinglot.reserve(component::VehicleType::CAR,
+                            std::chrono::seconds(0));
+  ASSERT_EQ(hold.isOk(), true) << "Unable to reserve a slot" << std::endl;
+  for (int i = 0; i < 50 && parkinglot.getTotalHeldParking() != 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  ASSERT_EQ(parkinglot.getTotalHeldParking(), 0)
+      << "Hold must expire" << std::endl;
+  ASSERT_EQ(parkinglot.confirm(hold.getData().id).isOk(), false)
+      << "Expired hold must not be confirmed" << std::endl;
+  ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(
+                component::VehicleType::CAR),
+            1)
+      << "Expired hold must be available" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotDeleteLevelHolds) {
+  component::ParkingLot parkinglot("DeleteLevelHolds", 2);
+  parkinglot.deleteParkingSlots();
+  parkinglot.addParking("0_CA_A_0");
+  parkinglot.addParking("1_CA_A_0");
+  parkinglot.addParking("1_CA_A_1");
+
+  auto dropped = parkinglot.reserve(component::VehicleType::CAR,
+                                    std::chrono::seconds(60));
+  auto kept = parkinglot.reserve(component::VehicleType::CAR,
+                                 std::chrono::seconds(60));
+  auto occupied = parkinglot.getParking(component::VehicleType::CAR);
+  ASSERT_EQ(dropped.isOk() && kept.isOk() && occupied.isOk(), true)
+      << "Unable to take the slots" << std::endl;
+  ASSERT_EQ(dropped.getData().slot.getParkingLevel(), 0)
+      << "Lowest level must be held first" << std::endl;
+  ASSERT_EQ(kept.getData().slot.getParkingLevel(), 1)
+      << "Incorrect held level" << std::endl;
+
+  auto feed = parkinglot.subscribeOccupancy();
+  parkinglot.deleteParkingSlots(0);
+  ASSERT_EQ(parkinglot.getTotalHeldParking(), 1)
+      << "Holds of other levels must be retained" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 1)
+      << "Occupied slots of other levels must be retained" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalAvailableParking(), 0)
+      << "Held slot must not become available" << std::endl;
+  auto updates = feed->wait(std::chrono::milliseconds(0));
+  ASSERT_EQ(updates.size(), component::TOTALVEHICLETYPE)
+      << "Cleared level must be published" << std::endl;
+  ASSERT_EQ(updates[0].level, 0) << "Incorrect level" << std::endl;
+  ASSERT_EQ(updates[0].held, 0) << "Incorrect held" << std::endl;
+
+  ASSERT_EQ(parkinglot.confirm(dropped.getData().id).isOk(), false)
+      << "Hold of the cleared level must be dropped" << std::endl;
+  auto slot = parkinglot.confirm(kept.getData().id);
+  ASSERT_EQ(slot.isOk(), true)
+      << "Hold of another level must be confirmed" << std::endl;
+  ASSERT_EQ(slot.getData().getSlotKey(), kept.getData().slot.getSlotKey())
+      << "Incorrect confirmed slot" << std::endl;
+}
+
+TEST(Tariff, TariffAPI) {
+  constexpr std::time_t day = 24 * 60 * 60;
+  constexpr std::time_t hour = 60 * 60;
+  constexpr std::time_t midnight = 10 * day;
+
+  component::TariffConfig config;
+  auto &car = config.vehicles[component::VehicleType::CAR];
+  car.bands = {{0, 24 * 60, 100}, {8 * 60, 20 * 60, 300}};
+  car.daily_cap_cents = 2000;
+  auto tariff = component::Tariff::compile(config);
+  ASSERT_EQ(tariff.isOk(), true) << "Unable to compile the tariff"
+                                 << std::endl;
+  const auto &cars = tariff.getData();
+
+  ASSERT_EQ(cars.price(component::VehicleType::CAR, midnight + 9 * hour,
+                       midnight + 9 * hour + 1800),
+            150)
+      << "Incorrect fee within a band" << std::endl;
+  ASSERT_EQ(cars.price(component::VehicleType::CAR, midnight + 9 * hour,
+                       midnight + 9 * hour + 1),
+            5)
+      << "Started minute must be charged" << std::endl;
+  ASSERT_EQ(cars.price(component::VehicleType::CAR, midnight + 7 * hour + 1800,
+                       midnight + 8 * hour + 1800),
+            200)
+      << "Incorrect fee across bands" << std::endl;
+  ASSERT_EQ(cars.price(component::VehicleType::CAR, midnight,
+                       midnight + 20 * hour),
+            2000)
+      << "Day must be capped" << std::endl;
+  ASSERT_EQ(cars.price(component::VehicleType::CAR, midnight + 23 * hour,
+                       midnight + 2 * day + hour),
+            100 + 2000 + 100)
+      << "Every day must be capped on its own" << std::endl;
+  ASSERT_EQ(cars.price(component::VehicleType::MINIVAN, midnight,
+                       midnight + hour),
+            0)
+      << "Vehicle type without bands must be free" << std::endl;
+
+  config.utc_offset_seconds = -8 * hour;
+  auto shifted = component::Tariff::compile(config);
+  ASSERT_EQ(shifted.getData().price(component::VehicleType::CAR,
+                                    midnight + 9 * hour,
+                                    midnight + 9 * hour + 1800),
+            50)
+      << "Bands must follow the local time" << std::endl;
+
+  config.vehicles[component::VehicleType::CYCLE].bands = {{60, 60, 10}};
+  ASSERT_EQ(component::Tariff::compile(config).isOk(), false)
+      << "Empty band must be rejected" << std::endl;
+
+  std::vector<component::Session> sessions(20000);
+  uint64_t expected = 0;
+  for (std::size_t i = 0; i < sessions.size(); i++) {
+    sessions[i].key = component::SlotKey::parse("0_CA_A_0").getData();
+    sessions[i].occupied_at = midnight + static_cast<std::time_t>(i) * 37;
+    sessions[i].released_at = sessions[i].occupied_at + 5400;
+    expected += cars.price(component::VehicleType::CAR,
+                           sessions[i].occupied_at, sessions[i].released_at);
+  }
+  component::ThreadPool pool(3);
+  ASSERT_EQ(cars.settle(sessions, pool), expected)
+      << "Incorrect settlement total" << std::endl;
+  ASSERT_EQ(sessions.back().fee_cents,
+            cars.price(component::VehicleType::CAR,
+                       sessions.back().occupied_at,
+                       sessions.back().released_at))
+      << "Sessions must be priced in place" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotCheckout) {
+  component::ParkingLot parkinglot("Checkout", 1);
+  parkinglot.deleteParkingSlots();
+  parkinglot.addParking("0_MC_C_0");
+
+  component::TariffConfig config;
+  config.vehicles[component::VehicleType::MOTORCYCLE].bands = {
+      {0, 24 * 60, 60}};
+  parkinglot.setTariff(component::Tariff::compile(config).getData());
+
+  auto slot = parkinglot.getParking(component::VehicleType::MOTORCYCLE);
+  ASSERT_EQ(slot.isOk(), true) << "Unable to fetch a slot" << std::endl;
+  auto session = parkinglot.checkout(slot.getData().getSlotKey());
+  ASSERT_EQ(session.isOk(), true) << "Unable to check out" << std::endl;
+  ASSERT_EQ(session.getData().key, slot.getData().getSlotKey())
+      << "Incorrect slot" << std::endl;
+  ASSERT_EQ(session.getData().occupied_at,
+            slot.getData().getParkingTime().getData())
+      << "Session must start when the slot was occupied" << std::endl;
+  ASSERT_EQ(session.getData().fee_cents,
+            parkinglot.getTariff()->price(component::VehicleType::MOTORCYCLE,
+                                          session.getData().occupied_at,
+                                          session.getData().released_at))
+      << "Session must be priced with the tariff of the lot" << std::endl;
+  ASSERT_EQ(parkinglot.checkout(slot.getData().getSlotKey()).isOk(), false)
+      << "Available slot must not be checked out" << std::endl;
+}
+
+TEST(SessionLog, SessionLogAPI) {
+  std::remove("Sessions.sessions");
+  auto key = component::SlotKey::parse("2_CY_D_7").getData();
+  {
+    component::SessionLog log;
+    log.open("Sessions.sessions");
+    for (std::time_t i = 0; i < 5; i++) {
+      log.append(component::Session{key, 100 * i, 100 * i + 50,
+                                    static_cast<uint64_t>(i)});
+    }
+  }
+  {
+    // Torn record left behind by a crash
+    std::ofstream file("Sessions.sessions", std::ios::app | std::ios::binary);
+    file << "torn";
+  }
+  {
+    component::SessionLog log;
+    log.open("Sessions.sessions");
+    log.append(component::Session{key, 500, 550, 5});
+  }
+
+  std::vector<std::size_t> chunk_sizes;
+  std::vector<uint64_t> fees;
+  auto count = component::SessionLog::read(
+      "Sessions.sessions", 4,
+      [&chunk_sizes, &fees](const component::SessionChunk &chunk) {
+        chunk_sizes.push_back(chunk.size());
+        fees.insert(fees.end(), chunk.fees_cents.begin(),
+                    chunk.fees_cents.end());
+        ASSERT_EQ(chunk.parking_levels[0], 2) << "Incorrect level" << std::endl;
+        ASSERT_EQ(chunk.vehicle_types[0], component::VehicleType::CYCLE)
+            << "Incorrect vehicle type" << std::endl;
+      });
+  ASSERT_EQ(count, 6) << "Torn tail must be dropped" << std::endl;
+  ASSERT_EQ(chunk_sizes, (std::vector<std::size_t>{4, 2}))
+      << "Sessions must be read in chunks" << std::endl;
+  ASSERT_EQ(fees, (std::vector<uint64_t>{0, 1, 2, 3, 4, 5}))
+      << "Sessions must be read in order" << std::endl;
+  ASSERT_EQ(component::SessionLog::read(
+                "Sessions.sessions", 4,
+                [](const component::SessionChunk &) {}, 150, 350),
+            2)
+      << "Sessions must be filtered on their return" << std::endl;
+
+  using SessionFile = component::RecordFile<component::SessionRecord>;
+  std::remove("Sessions.sessions");
+  component::SessionLog log;
+  log.open("Sessions.sessions");
+  for (std::size_t i = 0; i < SessionFile::buffer_capacity; i++) {
+    log.append(component::Session{key, 0, 50, 0});
+  }
+  ASSERT_EQ(SessionFile::countRecords("Sessions.sessions"),
+            SessionFile::buffer_capacity)
+      << "A full buffer must be written out" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotSessionExport) {
+  std::remove("Exported.sessions");
+  component::ParkingLot parkinglot("Exported", 2);
+  parkinglot.deleteParkingSlots();
+  std::vector<std::string> unique_ids = {"0_CA_A_0", "1_CA_A_0", "1_MC_C_0"};
+  parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+
+  std::vector<component::VehicleType> vehicle_types = {
+      component::VehicleType::CAR, component::VehicleType::CAR,
+      component::VehicleType::MOTORCYCLE};
+  std::vector<component::SlotKey> keys;
+  for (const auto &slot :
+       parkinglot.getParkings(vehicle_types.begin(), vehicle_types.end())) {
+    keys.push_back(slot.getData().getSlotKey());
+  }
+  ASSERT_EQ(parkinglot.returnParking(keys[0]), true)
+      << "Unable to return the slot" << std::endl;
+  parkinglot.returnParkings(keys.begin() + 1, keys.end());
+
+  component::SessionChunk sessions;
+  auto count = parkinglot.exportSessions(
+      0, std::numeric_limits<std::time_t>::max(), 2,
+      [&sessions](const component::SessionChunk &chunk) {
+        for (std::size_t i = 0; i < chunk.size(); i++) {
+          sessions.push_back({chunk.slot_keys[i], chunk.occupied_at[i],
+                              chunk.released_at[i], chunk.fees_cents[i]});
+        }
+      });
+  ASSERT_EQ(count, 3) << "Every return must be logged" << std::endl;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(sessions.slot_keys[i], keys[i].getValue())
+        << "Sessions must be logged in order" << std::endl;
+    ASSERT_EQ(sessions.parking_levels[i], keys[i].getParkingLevel())
+        << "Incorrect level" << std::endl;
+    ASSERT_LE(sessions.occupied_at[i], sessions.released_at[i])
+        << "Session must end after it started" << std::endl;
+  }
+}
+
+TEST(ParkingLot, ParkingLotSettle) {
+  constexpr std::time_t hour = 60 * 60;
+  constexpr std::time_t midnight = 10 * 24 * hour;
+  std::remove("Settled.sessions");
+  {
+    component::SessionLog log;
+    log.open("Settled.sessions");
+    auto key = component::SlotKey::parse("0_CA_A_0").getData();
+    log.append({key, midnight + 9 * hour, midnight + 10 * hour, 0});
+    log.append({key, midnight + 11 * hour, midnight + 13 * hour, 0});
+    // Returned the day before
+    log.append({key, midnight - 2 * hour, midnight - hour, 0});
+  }
+
+  component::ParkingLot parkinglot("Settled", 1);
+  component::TariffConfig config;
+  config.vehicles[component::VehicleType::CAR].bands = {{0, 24 * 60, 100}};
+  parkinglot.setTariff(component::Tariff::compile(config).getData());
+
+  auto day = parkinglot.settle(midnight, midnight + 24 * hour, 1);
+  ASSERT_EQ(day.count, 2) << "Sessions of the day must be settled"
+                          << std::endl;
+  ASSERT_EQ(day.total_cents, 300) << "Incorrect total of the day"
+                                  << std::endl;
+  auto all = parkinglot.settle(0, std::numeric_limits<std::time_t>::max());
+  ASSERT_EQ(all.count, 3) << "Every session must be settled" << std::endl;
+  ASSERT_EQ(all.total_cents, 400) << "Incorrect total" << std::endl;
+}
+
+TEST(ThreadPool, ThreadPoolAPI) {
+  component::ThreadPool pool(2);
+  ASSERT_EQ(pool.size(), 2) << "Incorrect number of workers" << std::endl;
+
+  std::vector<int> visits(1000, 0);
+  pool.parallelFor(visits.size(), [&visits](std::size_t i) { visits[i]++; });
+  for (auto count : visits) {
+    ASSERT_EQ(count, 1) << "Every index must be visited once" << std::endl;
+  }
+
+  std::atomic<unsigned> runs{0};
+  auto id = pool.scheduleEvery(std::chrono::milliseconds(1),
+                               [&runs]() { runs++; });
+  while (runs < 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  pool.cancel(id);
+  auto cancelled_runs = runs.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(runs, cancelled_runs)
+      << "A cancelled task must not run again" << std::endl;
+
+  // Tasks scheduled while cancel() waits for a run rehash the tasks
+  std::atomic<bool> started{false};
+  std::vector<component::ThreadPool::TaskId> scheduled;
+  id = pool.scheduleEvery(std::chrono::milliseconds(1), [&]() {
+    if (started.exchange(true)) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (int i = 0; i < 256; i++) {
+      scheduled.push_back(pool.scheduleEvery(std::chrono::hours(1), []() {}));
+    }
+  });
+  while (!started) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  pool.cancel(id);
+  ASSERT_EQ(scheduled.size(), 256)
+      << "Cancel must wait for the running task" << std::endl;
+  for (auto task : scheduled) {
+    pool.cancel(task);
+  }
+}
+
+TEST(LotRegistry, LotRegistryAPI) {
+  for (const auto &name : {"North", "South"}) {
+    std::remove((std::string(name) + ".db").c_str());
+    std::remove((std::string(name) + ".journal").c_str());
+    std::remove((std::string(name) + ".sessions").c_str());
+  }
+  component::LotRegistry registry(std::make_shared<component::ThreadPool>(2));
+  ASSERT_EQ(registry.open("../North", 1), nullptr)
+      << "A lot name must be a plain file name" << std::endl;
+  ASSERT_EQ(registry.find("North"), nullptr)
+      << "A lot must not be found before it is opened" << std::endl;
+
+  auto north = registry.open("North", 1);
+  auto south = registry.open("South", 2);
+  ASSERT_NE(north, nullptr) << "Unable to open the lot" << std::endl;
+  ASSERT_NE(south, nullptr) << "Unable to open the lot" << std::endl;
+  ASSERT_EQ(registry.open("North", 1), north)
+      << "A lot must only be opened once" << std::endl;
+  ASSERT_EQ(registry.find("South"), south) << "Lot not found" << std::endl;
+  ASSERT_EQ(registry.size(), 2) << "Incorrect number of lots" << std::endl;
+
+  north->deleteParkingSlots();
+  south->deleteParkingSlots();
+  std::vector<std::string> unique_ids = {"0_CA_A_0"};
+  north->addParkingBatch(unique_ids.begin(), unique_ids.end());
+  ASSERT_EQ(north->getParking(component::VehicleType::CAR).isOk(), true)
+      << "Unable to park in the lot" << std::endl;
+  ASSERT_EQ(south->getParking(component::VehicleType::CAR).isOk(), false)
+      << "Lots must not share their slots" << std::endl;
+
+  ASSERT_EQ(registry.close("North"), true) << "Unable to close" << std::endl;
+  ASSERT_EQ(registry.close("North"), false)
+      << "A lot must only be closed once" << std::endl;
+  ASSERT_EQ(registry.find("North"), nullptr)
+      << "A closed lot must not be found" << std::endl;
+  ASSERT_EQ(registry.getNames(), std::vector<std::string>{"South"})
+      << "Incorrect hosted lots" << std::endl;
+}
+
+TEST(LatencyHistogram, LatencyHistogramAPI) {
+  using component::LatencyHistogram;
+  for (uint64_t ns = 0; ns < LatencyHistogram::SUB_BUCKETS; ns++) {
+    ASSERT_EQ(LatencyHistogram::getBucketMax(LatencyHistogram::getBucket(ns)),
+              ns)
+        << "Small values must be exact" << std::endl;
+  }
+  for (uint64_t ns : {17ULL, 1000ULL, 123456ULL, 987654321ULL}) {
+    uint64_t max =
+        LatencyHistogram::getBucketMax(LatencyHistogram::getBucket(ns));
+    ASSERT_GE(max, ns) << "A value must be within its bucket" << std::endl;
+    ASSERT_LE(max - ns, ns / LatencyHistogram::SUB_BUCKETS)
+        << "Bucket too wide" << std::endl;
+  }
+  ASSERT_EQ(LatencyHistogram::getBucket(~0ULL), LatencyHistogram::BUCKETS - 1)
+      << "Huge values must land in the last bucket" << std::endl;
+
+  LatencyHistogram histogram;
+  ASSERT_EQ(histogram.getQuantile(0.5), 0) << "Empty histogram" << std::endl;
+  for (uint64_t ns = 1; ns <= 1000; ns++) {
+    histogram.record(ns * 1000);
+  }
+  LatencyHistogram merged;
+  merged.merge(histogram);
+  ASSERT_EQ(merged.getCount(), 1000) << "Incorrect count" << std::endl;
+  ASSERT_EQ(merged.getSum(), 500500000) << "Incorrect sum" << std::endl;
+  ASSERT_EQ(merged.getMax(), 1000000) << "Incorrect max" << std::endl;
+  for (double q : {0.5, 0.99, 0.999}) {
+    auto expected = static_cast<double>(q * 1000000);
+    auto quantile = static_cast<double>(merged.getQuantile(q));
+    ASSERT_GE(quantile, expected) << "Quantile too low" << std::endl;
+    ASSERT_LE(quantile, expected * 1.0625) << "Quantile too high" << std::endl;
+  }
+}
+
+TEST(Metrics, MetricsAPI) {
+  auto before = component::Metrics::snapshot();
+  {
+    component::ParkingLot parkinglot("Metered", 1);
+    parkinglot.deleteParkingSlots();
+    std::vector<std::string> unique_ids = {"0_CA_A_0"};
+    parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+    auto slot = parkinglot.getParking(component::VehicleType::CAR);
+    ASSERT_EQ(parkinglot.getParking(component::VehicleType::CAR).isOk(), false)
+        << "The lot must be full" << std::endl;
+    ASSERT_EQ(parkinglot.returnParking(slot.getData()), true)
+        << "Unable to return the slot" << std::endl;
+  }
+  // Records of exited threads must be kept
+  std::thread([]() {
+    component::Metrics::add(component::Counter::SQL_ERRORS, 2);
+    component::Metrics::record(component::Histogram::RPC_GET_METRICS,
+                               std::chrono::microseconds(5));
+  }).join();
+
+  auto after = component::Metrics::snapshot();
+  auto counted = [&before, &after](component::Counter counter) {
+    return after->counters.at(counter) - before->counters.at(counter);
+  };
+  auto recorded = [&before, &after](component::Histogram histogram) {
+    return after->histograms.at(histogram).getCount() -
+           before->histograms.at(histogram).getCount();
+  };
+  ASSERT_GE(counted(component::Counter::ALLOCATIONS), 1)
+      << "Allocations must be counted" << std::endl;
+  ASSERT_GE(counted(component::Counter::ALLOCATION_FAILURES), 1)
+      << "Failed allocations must be counted" << std::endl;
+  ASSERT_GE(counted(component::Counter::RETURNS), 1)
+      << "Returns must be counted" << std::endl;
+  ASSERT_GE(counted(component::Counter::SQL_ERRORS), 2)
+      << "Counters of an exited thread must be kept" << std::endl;
+  ASSERT_GE(recorded(component::Histogram::LOT_GET_PARKING), 2)
+      << "getParking latency must be recorded" << std::endl;
+  ASSERT_GE(recorded(component::Histogram::SQL_STEP), 1)
+      << "SQL steps must be recorded" << std::endl;
+  ASSERT_GE(recorded(component::Histogram::RPC_GET_METRICS), 1)
+      << "Histograms of an exited thread must be kept" << std::endl;
+
+  std::ostringstream text;
+  after->writePrometheus(text);
+  ASSERT_NE(text.str().find("# TYPE parking_allocations_total counter\n"),
+            std::string::npos)
+      << "Counters must be exported" << std::endl;
+  ASSERT_NE(
+      text.str().find("parking_lot_get_parking_seconds{quantile=\"0.99\"}"),
+      std::string::npos)
+      << "Quantiles must be exported" << std::endl;
+
+  ASSERT_EQ(component::Metrics::writePrometheusFile("Metered.prom"), true)
+      << "Unable to write the metrics file" << std::endl;
+  std::ifstream file("Metered.prom");
+  std::string first_line;
+  std::getline(file, first_line);
+  ASSERT_EQ(first_line, "# TYPE parking_allocations_total counter")
+      << "Incorrect metrics file" << std::endl;
+  std::remove("Metered.prom");
+}
+
+TEST(ParkingLot, ParkingLotReload) {
+  std::string occupied_id;
+  {
+    component::ParkingLot parkinglot("Reload", 1);
+    parkinglot.deleteParkingSlots();
+    parkinglot.addParking("0_CY_D_0");
+    parkinglot.addParking("0_CY_D_1");
+    auto slot = parkinglot.getParking(component::VehicleType::CYCLE);
+    ASSERT_EQ(slot.isOk(), true) << "Unable to fetch a slot" << std::endl;
+    occupied_id = slot.getData().getParkingSlotId();
+  }
+
+  component::ParkingLot parkinglot("Reload", 1);
+  ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(
+                component::VehicleType::CYCLE),
+            1)
+      << "Available slots must be loaded from the DB" << std::endl;
+  ASSERT_EQ(parkinglot.getOccupiedParkingForVehicleType(
+                component::VehicleType::CYCLE),
+            1)
+      << "Occupied slots must be loaded from the DB" << std::endl;
+  ASSERT_EQ(parkinglot.getParkingSlot(occupied_id).getData().isOccupied(), true)
+      << "Occupancy must be loaded from the DB" << std::endl;
+}
+
+TEST(OccupancyCounters, OccupancyCountersAPI) {
+  component::OccupancyCounters counters;
+  counters.add(0, component::VehicleType::CAR, false);
+  counters.add(1, component::VehicleType::CAR, false);
+  counters.add(1, component::VehicleType::MINIVAN, true);
+  counters.occupy(0, component::VehicleType::CAR);
+
+  ASSERT_EQ(counters.getTotalAvailable(), 1)
+      << "Incorrect available count" << std::endl;
+  ASSERT_EQ(counters.getTotalOccupied(), 2)
+      << "Incorrect occupied count" << std::endl;
+  ASSERT_EQ(counters.getOccupiedAtLevel(1), 1)
+      << "Incorrect occupied count for level 1" << std::endl;
+  ASSERT_EQ(counters.getOccupiedForVehicleType(component::VehicleType::CAR), 1)
+      << "Incorrect occupied count for car" << std::endl;
+
+  counters.release(0, component::VehicleType::CAR);
+  ASSERT_EQ(counters.getAvailable(0, component::VehicleType::CAR), 1)
+      << "Incorrect available count for level 0 and car" << std::endl;
+  ASSERT_EQ(counters.getAvailableAtLevel(component::MAX_PARKING_LEVELS), 0)
+      << "Levels beyond the limit must be empty" << std::endl;
+
+  counters.reset();
+  ASSERT_EQ(counters.getTotalOccupied(), 0)
+      << "Counters must be reset" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotBatchAPI) {
+  component::ParkingLot parkinglot("Batch", 2);
+  parkinglot.deleteParkingSlots();
+  std::vector<std::string> unique_ids = {"0_MV_A_0", "0_MV_A_1", "1_MV_A_0",
+                                         "0_MV_A_0"};
+  parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+
+  ASSERT_EQ(parkinglot.getTotalAvailableParking(), 3)
+      << "Duplicate slot must be skipped" << std::endl;
+  ASSERT_EQ(parkinglot.getAvailableParkingForVehicleTypeAtLevel(
+                0, component::VehicleType::MINIVAN),
+            2)
+      << "Incorrect available count for level 0 and minivan" << std::endl;
+
+  parkinglot.deleteParkingSlots(0);
+  ASSERT_EQ(parkinglot.getTotalAvailableParking(), 1)
+      << "Level 0 must be cleaned up" << std::endl;
+}
+
+TEST(ParkingIdParser, ParkingIdParseFields) {
+  auto parking_id = component::ParkingIdParser::parse("12_MC_AB_40");
+  ASSERT_EQ(parking_id.isOk(), true) << "Unable to parse" << std::endl;
+  ASSERT_EQ(parking_id.getData().level, 12)
+      << "Incorrect parking level" << std::endl;
+  ASSERT_EQ(parking_id.getData().vt, component::VehicleType::MOTORCYCLE)
+      << "Incorrect vehicle type" << std::endl;
+  ASSERT_EQ(parking_id.getData().zone, "AB")
+      << "Incorrect parking zone" << std::endl;
+  ASSERT_EQ(parking_id.getData().number, 40)
+      << "Incorrect parking number" << std::endl;
+
+  for (const auto *unique_id :
+       {"", "2_CA_A", "2_CA_A_3_4", "X_CA_A_3", "2_XX_A_3", "2_CA__3",
+        "2_CA_A_3X", "-2_CA_A_3", "2__A_3"}) {
+    ASSERT_EQ(component::ParkingIdParser::parse(unique_id).isOk(), false)
+        << unique_id << " must not be parsed" << std::endl;
+  }
+
+  component::ParkingLot parkinglot("Malformed", 1);
+  parkinglot.deleteParkingSlots();
+  parkinglot.addParking("0_XX_A_0");
+  ASSERT_EQ(parkinglot.getTotalAvailableParking(), 0)
+      << "Malformed slot must not be added" << std::endl;
+}
+
+TEST(SlotKey, SlotKeyAPI) {
+  auto key = component::SlotKey::parse("12_MC_AB3_40");
+  ASSERT_EQ(key.isOk(), true) << "Unable to parse" << std::endl;
+  ASSERT_EQ(key.getData().getParkingLevel(), 12)
+      << "Incorrect parking level" << std::endl;
+  ASSERT_EQ(key.getData().getVehicleType(), component::VehicleType::MOTORCYCLE)
+      << "Incorrect vehicle type" << std::endl;
+  ASSERT_EQ(key.getData().getZone(), "AB3")
+      << "Incorrect parking zone" << std::endl;
+  ASSERT_EQ(key.getData().getNumber(), 40)
+      << "Incorrect parking number" << std::endl;
+  ASSERT_EQ(key.getData().toString(), "12_MC_AB3_40")
+      << "Key must convert back to its unique_id" << std::endl;
+
+  ASSERT_EQ(component::SlotKey::parse("0_CA_A_1").getData() <
+                component::SlotKey::parse("0_CA_B_0").getData(),
+            true)
+      << "Keys of a zone must be contiguous" << std::endl;
+  ASSERT_EQ(component::SlotKey::parse("256_CA_A_1").isOk(), false)
+      << "Level must fit the key" << std::endl;
+  ASSERT_EQ(component::SlotKey::parse("0_CA_ABCDE_1").isOk(), false)
+      << "Zone must fit the key" << std::endl;
+  ASSERT_EQ(component::SlotKey::parse("0_CA_a_1").isOk(), false)
+      << "Zone must be made of digits and upper case letters" << std::endl;
+  ASSERT_EQ(component::SlotKey().isValid(), false)
+      << "Default key must be invalid" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotLegacyMigration) {
+  std::remove("Legacy.db");
+  sqlite3 *db = nullptr;
+  sqlite3_open("Legacy.db", &db);
+  sqlite3_exec(db,
+               "create table parking (parking_id varchar(20) primary key,"
+               "occupied_status binary, parking_level int,"
+               "vehicle_type varchar(20), occupied_at time);"
+               "insert into parking values('1_CA_B_0', 1, 1, 'CAR', 100);"
+               "insert into parking values('1_CA_B_1', 0, 1, 'CAR', 100);",
+               nullptr, nullptr, nullptr);
+  sqlite3_close(db);
+
+  component::ParkingLot parkinglot("Legacy", 2);
+  ASSERT_EQ(parkinglot.getAvailableParkingAtLevel(1), 1)
+      << "Available slot must be migrated" << std::endl;
+  auto slot = parkinglot.getParkingSlot("1_CA_B_0");
+  ASSERT_EQ(slot.isOk(), true) << "Occupied slot must be migrated" << std::endl;
+  ASSERT_EQ(slot.getData().getParkingTime().getData(), 100)
+      << "Parking time must be migrated" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotOccupancyFeed) {
+  component::ParkingLot parkinglot("Feed", 2);
+  parkinglot.deleteParkingSlots();
+  std::vector<std::string> unique_ids = {"0_CA_B_0", "0_CA_B_1", "1_MC_C_0"};
+  parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+
+  auto subscription = parkinglot.subscribeOccupancy();
+  auto slot = parkinglot.getParking(component::VehicleType::CAR);
+  ASSERT_EQ(slot.isOk(), true) << "Car slot must be allocated" << std::endl;
+  auto other = parkinglot.getParking(component::VehicleType::CAR);
+  ASSERT_EQ(other.isOk(), true) << "Car slot must be allocated" << std::endl;
+
+  auto updates = subscription->wait(std::chrono::milliseconds(0));
+  ASSERT_EQ(updates.size(), 1)
+      << "Updates of the same pair must be coalesced" << std::endl;
+  ASSERT_EQ(updates[0].level, 0) << "Incorrect level" << std::endl;
+  ASSERT_EQ(updates[0].vt, component::VehicleType::CAR)
+      << "Incorrect vehicle type" << std::endl;
+  ASSERT_EQ(updates[0].available, 0) << "Incorrect available" << std::endl;
+  ASSERT_EQ(updates[0].occupied, 2) << "Incorrect occupied" << std::endl;
+
+  ASSERT_EQ(parkinglot.returnParking(slot.getData()), true)
+      << "Occupied slot must be returned" << std::endl;
+  ASSERT_EQ(parkinglot.returnParking(slot.getData()), false)
+      << "Available slot must not be returned" << std::endl;
+  updates = subscription->wait(std::chrono::milliseconds(0));
+  ASSERT_EQ(updates.size(), 1) << "Return must be published" << std::endl;
+  ASSERT_EQ(updates[0].available, 1) << "Incorrect available" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotBatchAllocation) {
+  component::ParkingLot parkinglot("BatchAllocation", 2);
+  parkinglot.deleteParkingSlots();
+  std::vector<std::string> unique_ids = {"0_CA_B_0", "1_CA_B_0", "0_MC_C_0"};
+  parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+
+  std::vector<component::VehicleType> vehicle_types = {
+      component::VehicleType::CAR, component::VehicleType::MOTORCYCLE,
+      component::VehicleType::CAR, component::VehicleType::CAR,
+      component::VehicleType::TOTALVEHICLETYPE};
+  auto slots =
+      parkinglot.getParkings(vehicle_types.begin(), vehicle_types.end());
+  ASSERT_EQ(slots.size(), vehicle_types.size())
+      << "Every request must have a result" << std::endl;
+  ASSERT_EQ(slots[0].isOk() && slots[1].isOk() && slots[2].isOk(), true)
+      << "Available slots must be allocated" << std::endl;
+  ASSERT_EQ(slots[3].isOk(), false)
+      << "Third car must not find a slot" << std::endl;
+  ASSERT_EQ(slots[4].isOk(), false)
+      << "Unknown vehicle type must not find a slot" << std::endl;
+  ASSERT_EQ(slots[1].getData().getVehicleType(),
+            component::VehicleType::MOTORCYCLE)
+      << "Results must be in request order" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 3)
+      << "Incorrect occupied count" << std::endl;
+
+  std::vector<component::SlotKey> keys = {slots[0].getData().getSlotKey(),
+                                          slots[0].getData().getSlotKey(),
+                                          component::SlotKey()};
+  auto returned = parkinglot.returnParkings(keys.begin(), keys.end());
+  ASSERT_EQ(returned, std::vector<bool>({true, false, false}))
+      << "Only the occupied slot must be returned" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 2)
+      << "Incorrect occupied count" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotJournalRecovery) {
+  component::SlotKey key = component::SlotKey::parse("0_CA_B_1").getData();
+  {
+    component::ParkingLot parkinglot("Journaled", 1);
+    parkinglot.deleteParkingSlots();
+    std::vector<std::string> unique_ids = {"0_CA_B_0", "0_CA_B_1"};
+    parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+  }
+
+  // Events of a lot which went down before checkpointing them
+  {
+    component::Journal journal;
+    journal.setDurability(component::Durability::PER_EVENT);
+    journal.open("Journaled.journal");
+    journal.append(component::JournalRecord::Event::OCCUPY, key.getValue(),
+                   1000);
+    journal.append(component::JournalRecord::Event::RETURN, key.getValue(), 0);
+    journal.waitDurable(journal.append(component::JournalRecord::Event::OCCUPY,
+                                       key.getValue(), 2000));
+  }
+  {
+    std::ofstream torn("Journaled.journal", std::ios::binary | std::ios::app);
+    torn << "torn";
+  }
+  ASSERT_EQ(component::Journal::replay("Journaled.journal",
+                                       [](const component::JournalRecord &) {}),
+            3)
+      << "Torn tail must be skipped" << std::endl;
+
+  component::ParkingLot parkinglot("Journaled", 1);
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 1)
+      << "Journal must be replayed on open" << std::endl;
+  auto slot = parkinglot.getParkingSlot(key);
+  ASSERT_EQ(slot.isOk() && slot.getData().isOccupied(), true)
+      << "Journaled slot must be occupied" << std::endl;
+  ASSERT_EQ(slot.getData().getParkingTime().getData(), 2000)
+      << "Latest event must win" << std::endl;
+
+  parkinglot.setDurability(component::Durability::PERIODIC);
+  ASSERT_EQ(parkinglot.returnParking(slot.getData()), true)
+      << "Recovered slot must be returned" << std::endl;
+  parkinglot.checkpoint();
+  ASSERT_EQ(component::Journal::replay("Journaled.journal",
+                                       [](const component::JournalRecord &) {}),
+            0)
+      << "Checkpoint must empty the journal" << std::endl;
+}
+
+TEST(Snapshot, SnapshotAPI) {
+  component::OccupancyEngine engine;
+  for (unsigned number = 0; number < 100; number++) {
+    engine.addSlot(component::ParkingSlot(
+        component::SlotKey::parse("1_CA_B_" + std::to_string(number))
+            .getData()));
+  }
+  auto slot = engine.allocate(component::VehicleType::CAR, 1234);
+  ASSERT_EQ(component::Snapshot::write("Engine.snapshot", engine), true)
+      << "Snapshot must be written" << std::endl;
+
+  component::Snapshot snapshot("Engine.snapshot");
+  ASSERT_EQ(snapshot.isValid(), true) << "Snapshot must be mapped" << std::endl;
+  ASSERT_EQ(snapshot.getSlotCount(), 100) << "Incorrect slot count" << std::endl;
+  unsigned occupied = 0;
+  for (std::size_t index = 0; index < snapshot.getSlotCount(); index++) {
+    if (snapshot.isOccupied(index)) {
+      occupied++;
+      ASSERT_EQ(snapshot.getSlotKey(index), slot.getData().getSlotKey())
+          << "Incorrect occupied slot" << std::endl;
+      ASSERT_EQ(snapshot.getOccupiedAt(index), 1234)
+          << "Incorrect occupied_at" << std::endl;
+    }
+  }
+  ASSERT_EQ(occupied, 1) << "Incorrect occupancy bitmap" << std::endl;
+
+  component::OccupancyEngine loaded;
+  loaded.setSlotSelection(component::SlotSelection::ZONE_PACKING);
+  auto taken = component::SlotKey::parse("1_CA_B_7").getData();
+  std::vector<component::SlotView> changes = {
+      {slot.getData().getSlotKey(), component::SlotState::AVAILABLE, 0},
+      {taken, component::SlotState::OCCUPIED, 99}};
+  ASSERT_EQ(loaded.load(snapshot.getColumns(), changes), true)
+      << "Snapshot must be loaded" << std::endl;
+  ASSERT_EQ(loaded.getSlotCount(), 100) << "Incorrect slot count" << std::endl;
+  ASSERT_EQ(loaded.getCounters().getOccupied(1, component::VehicleType::CAR),
+            1)
+      << "Changes must override the snapshot" << std::endl;
+  ASSERT_EQ(loaded.getSlot(taken).getData().getParkingTime().getData(), 99)
+      << "Incorrect occupied_at" << std::endl;
+  auto next = loaded.allocate(component::VehicleType::CAR, 5);
+  ASSERT_EQ(next.isOk(), true) << "Loaded slot must be allocated" << std::endl;
+  ASSERT_EQ(next.getData().getSlotKey(), slot.getData().getSlotKey())
+      << "Released slot must be back in the heap" << std::endl;
+  ASSERT_EQ(loaded.load(snapshot.getColumns(), {}), false)
+      << "Only an empty engine can be loaded" << std::endl;
+
+  {
+    std::fstream file("Engine.snapshot",
+                      std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offsetof(component::SnapshotHeader, version));
+    file.put(static_cast<char>(component::Snapshot::VERSION + 1));
+  }
+  ASSERT_EQ(component::Snapshot("Engine.snapshot").isValid(), false)
+      << "Snapshot of another version must be ignored" << std::endl;
+  ASSERT_EQ(component::Snapshot("Missing.snapshot").isValid(), false)
+      << "Missing snapshot must be invalid" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotSnapshotBoot) {
+  {
+    component::ParkingLot parkinglot("Snapshotted", 2);
+    parkinglot.deleteParkingSlots();
+    std::vector<std::string> unique_ids = {"0_CA_B_0", "1_CA_B_0", "1_MV_A_0"};
+    parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+    auto slot = parkinglot.getParking(component::VehicleType::MINIVAN);
+    ASSERT_EQ(slot.isOk(), true) << "Minivan slot must be allocated"
+                                 << std::endl;
+    parkinglot.checkpoint(true);
+    // Set aside for the snapshot, not covered by it
+    auto other = parkinglot.getParking(component::VehicleType::CAR);
+    ASSERT_EQ(other.isOk(), true) << "Car slot must be allocated" << std::endl;
+    parkinglot.checkpoint();
+  }
+
+  // Rewrite the DB behind the back of the lot, a lot booting from the
+  // snapshot does not read the occupancy from the DB
+  sqlite3 *db = nullptr;
+  sqlite3_open("Snapshotted.db", &db);
+  sqlite3_exec(db, "update parking set occupied_status = false", nullptr,
+               nullptr, nullptr);
+  sqlite3_close(db);
+
+  component::ParkingLot parkinglot("Snapshotted", 2);
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 2)
+      << "Occupancy must be loaded from the snapshot" << std::endl;
+  ASSERT_EQ(parkinglot.getOccupiedParkingForVehicleType(
+                component::VehicleType::MINIVAN),
+            1)
+      << "Incorrect occupied minivans" << std::endl;
+
+  parkinglot.addParking("0_CY_D_0");
+  ASSERT_EQ(component::Snapshot("Snapshotted.snapshot").isValid(), false)
+      << "Adding slots must drop the snapshot" << std::endl;
+}
+
+TEST(OccupancyEngine, OccupancyReconfigure) {
+  component::OccupancyEngine engine;
+  engine.setSlotSelection(component::SlotSelection::ZONE_PACKING);
+  auto car = component::VehicleType::CAR;
+  auto keys = [car](unsigned count) {
+    std::vector<component::SlotKey> keys;
+    for (unsigned number = 0; number < count; number++) {
+      keys.push_back(component::SlotKey::make(0, car, "B", number).getData());
+    }
+    return keys;
+  };
+  ASSERT_EQ(engine.reconfigure(0, car, keys(4)).added.size(), 4)
+      << "Missing slots must be added" << std::endl;
+  auto first = engine.allocate(car, 10);
+  auto second = engine.allocate(car, 10);
+  ASSERT_EQ(first.isOk() && second.isOk(), true)
+      << "Unable to allocate the slots" << std::endl;
+
+  auto changes = engine.reconfigure(0, car, keys(1));
+  ASSERT_EQ(changes.retired.size(), 2)
+      << "Available slots must retire right away" << std::endl;
+  ASSERT_EQ(changes.draining, std::vector<component::SlotKey>{
+                                  second.getData().getSlotKey()})
+      << "Occupied slots must drain" << std::endl;
+  ASSERT_EQ(engine.getCounters().getOccupied(0, car), 2)
+      << "Draining slots stay occupied" << std::endl;
+  ASSERT_EQ(engine.allocate(car, 10).isOk(), false)
+      << "Retired slots must not be allocated" << std::endl;
+
+  ASSERT_EQ(engine.release(second.getData().getSlotKey()), true)
+      << "Unable to release a draining slot" << std::endl;
+  ASSERT_EQ(engine.getSlot(second.getData().getSlotKey()).isOk(), false)
+      << "Released draining slot must retire" << std::endl;
+  ASSERT_EQ(engine.getCounters().getAvailable(0, car), 0)
+      << "Retired slot must not be available" << std::endl;
+  ASSERT_EQ(engine.countOccupied(0, car), 1)
+      << "Bitmap must agree with the counters" << std::endl;
+  ASSERT_EQ(engine.takeDrained(), std::vector<component::SlotKey>{
+                                      second.getData().getSlotKey()})
+      << "Drained slot must be reported" << std::endl;
+
+  changes = engine.reconfigure(0, car, keys(3));
+  ASSERT_EQ(changes.revived.size(), 2)
+      << "Retired slots must be revived" << std::endl;
+  ASSERT_EQ(changes.added.size(), 0) << "No row must be added" << std::endl;
+  ASSERT_EQ(engine.allocate(car, 10).getData().getSlotKey(),
+            second.getData().getSlotKey())
+      << "Revived slot must be allocated again" << std::endl;
+
+  ASSERT_EQ(engine.drainSlot(first.getData().getSlotKey()), true)
+      << "Unable to drain a slot" << std::endl;
+  ASSERT_EQ(engine.reconfigure(0, car, keys(3)).kept.size(), 1)
+      << "Draining slot must be kept" << std::endl;
+  ASSERT_EQ(engine.isDraining(first.getData().getSlotKey()), false)
+      << "Kept slot must not drain anymore" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotReconfigureLevel) {
+  auto car = component::VehicleType::CAR;
+  auto draining = component::SlotKey::parse("0_CA_B_1").getData();
+  {
+    component::ParkingLot parkinglot("Reconfigured", 1);
+    parkinglot.deleteParkingSlots();
+    auto changes = parkinglot.reconfigureLevel(0, {0, 3, 0, 0});
+    ASSERT_EQ(changes.isOk() && changes.getData().added == 3, true)
+        << "Unable to add the car slots" << std::endl;
+    ASSERT_EQ(parkinglot.getParking(car).isOk(), true)
+        << "Unable to fetch a slot" << std::endl;
+    ASSERT_EQ(parkinglot.getParking(car).isOk(), true)
+        << "Unable to fetch a slot" << std::endl;
+
+    changes = parkinglot.reconfigureLevel(0, {1, 1, 0, 0});
+    ASSERT_EQ(changes.getData().added, 1) << "Incorrect added slots"
+                                          << std::endl;
+    ASSERT_EQ(changes.getData().retired, 1) << "Incorrect retired slots"
+                                            << std::endl;
+    ASSERT_EQ(changes.getData().draining, 1) << "Incorrect draining slots"
+                                             << std::endl;
+    ASSERT_EQ(parkinglot.getOccupiedParkingForVehicleType(car), 2)
+        << "Cars must not be evicted" << std::endl;
+    ASSERT_EQ(parkinglot.reconfigureLevel(1, {0, 0, 0, 2}).isOk(), true)
+        << "Unable to add a level" << std::endl;
+    ASSERT_EQ(parkinglot.getParkingLevelCount(), 2)
+        << "Incorrect level count" << std::endl;
+    ASSERT_EQ(parkinglot.reconfigureLevel(component::MAX_PARKING_LEVELS,
+                                          {0, 0, 0, 0})
+                  .isOk(),
+              false)
+        << "Level beyond the limit must be rejected" << std::endl;
+    ASSERT_EQ(parkinglot
+                  .reconfigureLevel(0, {0, component::max_level_capacity, 0, 0})
+                  .isOk(),
+              false)
+        << "Capacity beyond the limit must be rejected" << std::endl;
+  }
+
+  {
+    component::ParkingLot parkinglot("Reconfigured", 2);
+    ASSERT_EQ(parkinglot.isDraining(draining), true)
+        << "Draining slots must be loaded from the DB" << std::endl;
+    ASSERT_EQ(parkinglot.getOccupiedParkingForVehicleType(car), 2)
+        << "Incorrect occupied cars" << std::endl;
+    ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(car), 0)
+        << "Retired slots must stay retired" << std::endl;
+    ASSERT_EQ(parkinglot.returnParking(draining), true)
+        << "Unable to return a draining slot" << std::endl;
+    ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(car), 0)
+        << "Returned draining slot must retire" << std::endl;
+  }
+
+  component::ParkingLot parkinglot("Reconfigured", 2);
+  ASSERT_EQ(parkinglot.getParkingSlot(draining).isOk(), false)
+      << "Drained slot must be deleted" << std::endl;
+  ASSERT_EQ(parkinglot.getOccupiedParkingForVehicleType(car), 1)
+      << "Incorrect occupied cars" << std::endl;
+  ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(
+                component::VehicleType::CYCLE),
+            2)
+      << "Slots of the added level must be loaded" << std::endl;
+}
+
+TEST(SlotExporter, SlotExporterAPI) {
+  component::OccupancyEngine engine;
+  engine.setSlotSelection(component::SlotSelection::ZONE_PACKING);
+  auto car = component::VehicleType::CAR;
+  std::vector<component::SlotKey> keys;
+  for (unsigned number = 0; number < 4; number++) {
+    keys.push_back(component::SlotKey::make(0, car, "B", number).getData());
+  }
+  (void)engine.reconfigure(0, car, keys);
+  ASSERT_EQ(engine.allocate(car, 1700000000).isOk(), true)
+      << "Unable to allocate a slot" << std::endl;
+  ASSERT_EQ(engine.hold(car, 7).isOk(), true)
+      << "Unable to hold a slot" << std::endl;
+  keys.pop_back();
+  (void)engine.reconfigure(0, car, keys);
+
+  std::string text;
+  std::size_t chunks = 0;
+  auto sink = [&text, &chunks](std::string_view chunk) {
+    text += chunk;
+    chunks++;
+    return true;
+  };
+  component::SlotExporter csv(component::ExportFormat::CSV, sink);
+  ASSERT_EQ(csv.write("Exported", 1, engine), 3)
+      << "Retired slots must not be exported" << std::endl;
+  ASSERT_EQ(text, "id,level,vehicle_type,state,occupied_at\n"
+                  "0_CA_B_0,0,CAR,OCCUPIED,1700000000\n"
+                  "0_CA_B_1,0,CAR,HELD,\n"
+                  "0_CA_B_2,0,CAR,AVAILABLE,\n")
+      << "Incorrect CSV export" << std::endl;
+  ASSERT_EQ(chunks, 1) << "Small export must be a single chunk" << std::endl;
+
+  text.clear();
+  component::SlotExporter json(component::ExportFormat::JSON, sink);
+  ASSERT_EQ(json.write("Ex\"ported", 1, engine), 3)
+      << "Incorrect exported slots" << std::endl;
+  ASSERT_EQ(text,
+            "{\"name\":\"Ex\\\"ported\",\"levels\":1,\"available\":1,"
+            "\"occupied\":1,\"held\":1,\"slots\":["
+            "{\"id\":\"0_CA_B_0\",\"level\":0,\"vehicle_type\":\"CAR\","
+            "\"state\":\"OCCUPIED\",\"occupied_at\":1700000000},"
+            "{\"id\":\"0_CA_B_1\",\"level\":0,\"vehicle_type\":\"CAR\","
+            "\"state\":\"HELD\",\"occupied_at\":null},"
+            "{\"id\":\"0_CA_B_2\",\"level\":0,\"vehicle_type\":\"CAR\","
+            "\"state\":\"AVAILABLE\",\"occupied_at\":null}]}\n")
+      << "Incorrect JSON export" << std::endl;
+
+  chunks = 0;
+  component::SlotExporter chunked(component::ExportFormat::CSV, sink, 1);
+  ASSERT_EQ(chunked.write("Exported", 1, engine), 3)
+      << "Incorrect exported slots" << std::endl;
+  ASSERT_EQ(chunks, 3) << "Every full chunk must be flushed" << std::endl;
+
+  auto stop = [&chunks](std::string_view) {
+    chunks++;
+    return false;
+  };
+  chunks = 0;
+  component::SlotExporter stopped(component::ExportFormat::CSV, stop, 1);
+  ASSERT_EQ(stopped.write("Exported", 1, engine), 1)
+      << "Sink must be able to stop the export" << std::endl;
+  ASSERT_EQ(chunks, 1) << "No chunk after the sink stopped" << std::endl;
+
+  std::ostringstream slot;
+  slot << component::ParkingSlot(keys.front());
+  ASSERT_EQ(slot.str(), "{\"id\":\"0_CA_B_0\",\"level\":0,\"vehicle_type\":"
+                        "\"CAR\",\"occupied\":false,\"occupied_at\":null}")
+      << "Incorrect slot dump" << std::endl;
+}
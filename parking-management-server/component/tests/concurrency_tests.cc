@@ -0,0 +1,115 @@
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/parking.hh"
+#include "gtest/gtest.h"
+
+namespace {
+constexpr unsigned thread_count = 8;
+constexpr unsigned levels = 4;
+constexpr unsigned slots_per_vehicle = 16;
+
+/// Provisions every level with slots_per_vehicle slots for each VehicleType
+void provision(component::ParkingLot &parkinglot) {
+  parkinglot.deleteParkingSlots();
+  std::vector<std::string> unique_ids;
+  for (unsigned level = 0; level < levels; level++) {
+    for (const auto *vt : {"MV", "CA", "MC", "CY"}) {
+      for (unsigned i = 0; i < slots_per_vehicle; i++) {
+        unique_ids.push_back(std::to_string(level) + "_" + vt + "_A_" +
+                             std::to_string(i));
+      }
+    }
+  }
+  parkinglot.addParkingBatch(unique_ids.begin(), unique_ids.end());
+}
+} // namespace
+
+TEST(ParkingLot, ParkingLotConcurrentGetReturn) {
+  component::ParkingLot parkinglot("Concurrent", levels);
+  provision(parkinglot);
+
+  // Every slot has a holder count which must never exceed one
+  std::map<uint64_t, std::atomic<unsigned>> holders;
+  for (unsigned level = 0; level < levels; level++) {
+    for (const auto *vt : {"MV", "CA", "MC", "CY"}) {
+      for (unsigned i = 0; i < slots_per_vehicle; i++) {
+        auto key = component::SlotKey::parse(std::to_string(level) + "_" + vt +
+                                             "_A_" + std::to_string(i));
+        holders[key.getData().getValue()] = 0;
+      }
+    }
+  }
+
+  std::atomic<bool> double_allocation{false};
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < thread_count; t++) {
+    threads.emplace_back([&, t]() {
+      for (unsigned i = 0; i < 100; i++) {
+        auto vt = static_cast<component::VehicleType>(
+            (t + i) % component::VehicleType::TOTALVEHICLETYPE);
+        auto slot = parkinglot.getParking(vt);
+        if (!slot.isOk()) {
+          continue;
+        }
+        auto &holder = holders.at(slot.getData().getSlotKey().getValue());
+        if (holder.fetch_add(1) != 0) {
+          double_allocation = true;
+        }
+        holder.fetch_sub(1);
+        parkinglot.returnParking(slot.getData());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(double_allocation, false)
+      << "A slot was handed out twice" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalOccupiedParking(), 0)
+      << "All the slots must be returned" << std::endl;
+  ASSERT_EQ(parkinglot.getTotalAvailableParking(),
+            levels * slots_per_vehicle * component::TOTALVEHICLETYPE)
+      << "Incorrect available count" << std::endl;
+}
+
+TEST(ParkingLot, ParkingLotConcurrentExhaustion) {
+  component::ParkingLot parkinglot("Concurrent", levels);
+  provision(parkinglot);
+
+  std::vector<std::vector<uint64_t>> allocated(thread_count);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < thread_count; t++) {
+    threads.emplace_back([&, t]() {
+      while (true) {
+        auto slot = parkinglot.getParking(component::VehicleType::CAR);
+        if (!slot.isOk()) {
+          break;
+        }
+        allocated[t].push_back(slot.getData().getSlotKey().getValue());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::set<uint64_t> keys;
+  std::size_t total = 0;
+  for (const auto &thread_keys : allocated) {
+    keys.insert(thread_keys.begin(), thread_keys.end());
+    total += thread_keys.size();
+  }
+  ASSERT_EQ(total, levels * slots_per_vehicle)
+      << "Every car slot must be allocated" << std::endl;
+  ASSERT_EQ(keys.size(), total) << "A slot was handed out twice" << std::endl;
+  ASSERT_EQ(parkinglot.getAvailableParkingForVehicleType(
+                component::VehicleType::CAR),
+            0)
+      << "Incorrect available count" << std::endl;
+}
@@ -0,0 +1,148 @@
+#include "../include/thread_pool.hh"
+
+#include <algorithm>
+#include <atomic>
+
+#include "../include/metrics.hh"
+
+namespace component {
+ThreadPool::ThreadPool(unsigned threads) {
+  threads = std::max(threads, 1U);
+  m_workers.reserve(threads);
+  for (unsigned i = 0; i < threads; i++) {
+    m_workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+  Metrics::add(Gauge::POOL_QUEUE_DEPTH, 1);
+  m_work_cv.notify_one();
+}
+
+auto ThreadPool::scheduleEvery(Clock::duration interval,
+                               std::function<void()> task) -> TaskId {
+  TaskId id = INVALID_TASK;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    id = ++m_next_task;
+    m_periodic.emplace(id, PeriodicTask{interval, std::move(task)});
+    m_due.emplace(Clock::now() + interval, id);
+  }
+  // The due time of the new task may come before the one a worker waits for
+  m_work_cv.notify_all();
+  return id;
+}
+
+void ThreadPool::cancel(TaskId id) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_periodic.find(id);
+  if (it == m_periodic.end()) {
+    return;
+  }
+  // Tasks scheduled meanwhile may rehash m_periodic, which moves no entry
+  // but invalidates the iterator
+  PeriodicTask &task = it->second;
+  task.cancelled = true;
+  m_idle_cv.wait(lock, [&task]() { return !task.running; });
+  // Its entry in m_due is skipped once due
+  m_periodic.erase(id);
+}
+
+void ThreadPool::work() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    if (!m_tasks.empty()) {
+      auto task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+      lock.unlock();
+      Metrics::add(Gauge::POOL_QUEUE_DEPTH, -1);
+      task();
+      lock.lock();
+      continue;
+    }
+    if (m_stop) {
+      return;
+    }
+    if (m_due.empty()) {
+      m_work_cv.wait(lock);
+      continue;
+    }
+
+    auto [due, id] = m_due.top();
+    if (Clock::now() < due) {
+      m_work_cv.wait_until(lock, due);
+      continue;
+    }
+    m_due.pop();
+    auto it = m_periodic.find(id);
+    if (it == m_periodic.end() || it->second.cancelled) {
+      continue;
+    }
+    // The entry stays put while running, cancel() waits for the run
+    PeriodicTask &task = it->second;
+    task.running = true;
+    lock.unlock();
+    task.fn();
+    lock.lock();
+    task.running = false;
+    if (!task.cancelled) {
+      m_due.emplace(Clock::now() + task.interval, id);
+    }
+    m_idle_cv.notify_all();
+  }
+}
+
+void ThreadPool::parallelFor(std::size_t count,
+                             const std::function<void(std::size_t)> &fn) {
+  /// Shared with the helpers, which may only start once the loop is over
+  struct Loop {
+    std::atomic<std::size_t> next{0};
+    std::size_t count{0};
+    const std::function<void(std::size_t)> *fn{nullptr};
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    std::size_t done{0};
+  };
+  auto loop = std::make_shared<Loop>();
+  loop->count = count;
+  loop->fn = &fn;
+  auto run = [](Loop &loop) {
+    for (std::size_t i = loop.next++; i < loop.count; i = loop.next++) {
+      (*loop.fn)(i);
+      std::lock_guard<std::mutex> lock(loop.mutex);
+      if (++loop.done == loop.count) {
+        loop.done_cv.notify_all();
+      }
+    }
+  };
+
+  std::size_t helpers = std::min(size(), count > 0 ? count - 1 : 0);
+  for (std::size_t i = 0; i < helpers; i++) {
+    submit([loop, run]() { run(*loop); });
+  }
+  run(*loop);
+  std::unique_lock<std::mutex> lock(loop->mutex);
+  loop->done_cv.wait(lock, [&loop]() { return loop->done == loop->count; });
+}
+
+[[nodiscard]] auto ThreadPool::getShared() -> std::shared_ptr<ThreadPool> {
+  static auto shared = std::make_shared<ThreadPool>(
+      std::max(std::thread::hardware_concurrency(), 2U));
+  return shared;
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_work_cv.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+} // namespace component
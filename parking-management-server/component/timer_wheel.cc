@@ -0,0 +1,83 @@
+#include "../include/timer_wheel.hh"
+
+#include <algorithm>
+
+namespace component {
+TimerWheel::TimerWheel(uint64_t now) : m_now(now) { m_buckets.fill(NIL); }
+
+auto TimerWheel::schedule(uint64_t deadline, uint64_t payload) -> TimerId {
+  TimerId id = 0;
+  if (m_free_timers.empty()) {
+    id = static_cast<TimerId>(m_timers.size());
+    m_timers.emplace_back();
+  } else {
+    id = m_free_timers.back();
+    m_free_timers.pop_back();
+  }
+  m_timers[id].deadline = std::max(deadline, m_now + 1);
+  m_timers[id].payload = payload;
+  file(id);
+  m_size++;
+  return id;
+}
+
+auto TimerWheel::cancel(TimerId id) -> bool {
+  if (id >= m_timers.size() || m_timers[id].bucket == NIL) {
+    return false;
+  }
+  unlink(id);
+  m_timers[id].bucket = NIL;
+  m_free_timers.push_back(id);
+  m_size--;
+  return true;
+}
+
+void TimerWheel::file(TimerId id) {
+  Timer &timer = m_timers[id];
+  uint64_t deadline = timer.deadline;
+
+  // The level is given by the highest group of SLOT_BITS in which the
+  // deadline differs from the current tick. A deadline reached by a cascade
+  // lands in the level 0 bucket of the current tick, which fires after the
+  // cascades.
+  uint64_t diff = deadline ^ m_now;
+  uint32_t bucket = 0;
+  if ((diff >> (LEVELS * SLOT_BITS)) != 0) {
+    // Beyond the top level, file it in the first top bucket, reached when
+    // the wheel wraps around
+    bucket = (LEVELS - 1) * SLOTS;
+  } else {
+    unsigned level = 0;
+    while (level + 1 < LEVELS && (diff >> ((level + 1) * SLOT_BITS)) != 0) {
+      level++;
+    }
+    bucket = level * SLOTS + ((deadline >> (level * SLOT_BITS)) & (SLOTS - 1));
+  }
+
+  timer.bucket = bucket;
+  timer.prev = NIL;
+  timer.next = m_buckets[bucket];
+  if (timer.next != NIL) {
+    m_timers[timer.next].prev = id;
+  }
+  m_buckets[bucket] = id;
+}
+
+void TimerWheel::unlink(TimerId id) {
+  Timer &timer = m_timers[id];
+  if (timer.prev != NIL) {
+    m_timers[timer.prev].next = timer.next;
+  } else {
+    m_buckets[timer.bucket] = timer.next;
+  }
+  if (timer.next != NIL) {
+    m_timers[timer.next].prev = timer.prev;
+  }
+}
+
+auto TimerWheel::takeBucket(uint32_t bucket) -> uint32_t {
+  uint32_t head = m_buckets[bucket];
+  m_buckets[bucket] = NIL;
+  return head;
+}
+} // namespace component
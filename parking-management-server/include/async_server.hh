@@ -0,0 +1,186 @@
+#ifndef ASYNC_SERVER_HH
+#define ASYNC_SERVER_HH
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parking_management.grpc.pb.h"
+#include "parking_management.pb.h"
+#include "parking_manager.hh"
+#include <grpcpp/server.h>
+#include <grpcpp/server_builder.h>
+
+namespace services {
+/// A call in flight on a completion queue. The call is its own tag, it is
+/// advanced every time the completion queue hands it back.
+class AsyncCall {
+public:
+  /// Advances the call. ok is false once the completion queue shuts down.
+  virtual void proceed(bool ok) = 0;
+  virtual ~AsyncCall() = default;
+};
+
+/// Describes how to request and serve a unary RPC on the async service
+template <typename Request, typename Response> struct UnaryMethod {
+  using Responder = ::grpc::ServerAsyncResponseWriter<Response>;
+  std::function<void(::grpc::ServerContext *, Request *, Responder *,
+                     ::grpc::ServerCompletionQueue *, void *)>
+      request;
+  std::function<::grpc::Status(::grpc::ServerContext *, const Request *,
+                               Response *)>
+      handle;
+};
+
+/// A unary RPC served on a completion queue. Once a request arrives, the
+/// call arms a fresh call for the next request, serves the request and
+/// finishes, after which it deletes itself.
+template <typename Request, typename Response>
+class UnaryCall : public AsyncCall {
+private:
+  enum State { PROCESS, FINISH };
+
+  const UnaryMethod<Request, Response> &m_method;
+  ::grpc::ServerCompletionQueue *m_cq;
+  ::grpc::ServerContext m_context;
+  Request m_request;
+  Response m_response;
+  typename UnaryMethod<Request, Response>::Responder m_responder;
+  State m_state{State::PROCESS};
+
+public:
+  UnaryCall(const UnaryMethod<Request, Response> &method,
+            ::grpc::ServerCompletionQueue *cq)
+      : m_method(method), m_cq(cq), m_responder(&m_context) {
+    m_method.request(&m_context, &m_request, &m_responder, m_cq, this);
+  }
+
+  void proceed(bool ok) override {
+    if (!ok || m_state == State::FINISH) {
+      delete this;
+      return;
+    }
+
+    new UnaryCall(m_method, m_cq);
+    ::grpc::Status status =
+        m_method.handle(&m_context, &m_request, &m_response);
+    m_state = State::FINISH;
+    m_responder.Finish(m_response, status, this);
+  }
+};
+
+/// Provisioning RPC served on completion queues
+using AsyncProvisioningService =
+    ParkingManager::WithAsyncMethod_ReconfigureLevel<ParkingManager::Service>;
+
+/// Metrics RPC served on completion queues, on top of the provisioning one
+using AsyncMetricsService =
+    ParkingManager::WithAsyncMethod_GetMetrics<AsyncProvisioningService>;
+
+/// Billing RPCs served on completion queues, on top of the metrics one
+using AsyncBillingService = ParkingManager::WithAsyncMethod_Pay<
+    ParkingManager::WithAsyncMethod_SetTariff<
+        ParkingManager::WithAsyncMethod_SettleSessions<AsyncMetricsService>>>;
+
+/// Reservation RPCs served on completion queues, on top of the billing ones
+using AsyncReservationService = ParkingManager::WithAsyncMethod_ReserveSlot<
+    ParkingManager::WithAsyncMethod_ConfirmReservation<
+        ParkingManager::WithAsyncMethod_CancelReservation<
+            AsyncBillingService>>>;
+
+/// The unary RPCs of ParkingManager are served on completion queues. The
+/// WatchOccupancy and ExportSessions streams are long lived and block between
+/// their writes, so they stay on the synchronous thread pool of the server.
+class HybridService
+    : public ParkingManager::WithAsyncMethod_CreateParkingLot<
+          ParkingManager::WithAsyncMethod_AllocateSlot<
+              ParkingManager::WithAsyncMethod_ReleaseSlot<
+                  ParkingManager::WithAsyncMethod_GetStats<
+                      ParkingManager::WithAsyncMethod_BatchAllocate<
+                          ParkingManager::WithAsyncMethod_BatchRelease<
+                              AsyncReservationService>>>>>> {
+private:
+  ParkingManagerImpl &m_impl;
+
+public:
+  explicit HybridService(ParkingManagerImpl &impl) : m_impl(impl) {}
+  ::grpc::Status
+  WatchOccupancy(::grpc::ServerContext *context,
+                 const ::WatchRequest *request,
+                 ::grpc::ServerWriter<::OccupancyCount> *writer) override {
+    return m_impl.WatchOccupancy(context, request, writer);
+  }
+  ::grpc::Status
+  ExportSessions(::grpc::ServerContext *context,
+                 const ::ExportRequest *request,
+                 ::grpc::ServerWriter<::SessionBatch> *writer) override {
+    return m_impl.ExportSessions(context, request, writer);
+  }
+};
+
+/// Serves the ParkingManager service on completion queues, each drained by
+/// its own thread. The requests are handed over to ParkingManagerImpl, which
+/// owns the parking lot.
+class AsyncServer {
+private:
+  ParkingManagerImpl &m_impl;
+  unsigned m_cq_threads;
+  HybridService m_service;
+  std::unique_ptr<::grpc::Server> m_server;
+  std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>> m_cqs;
+  std::vector<std::thread> m_threads;
+  UnaryMethod<ParkingLotDetails, Status> m_create_parking_lot;
+  UnaryMethod<AllocateRequest, Slot> m_allocate_slot;
+  UnaryMethod<ReleaseRequest, Status> m_release_slot;
+  UnaryMethod<StatsRequest, Stats> m_get_stats;
+  UnaryMethod<BatchAllocateRequest, BatchAllocateResponse> m_batch_allocate;
+  UnaryMethod<BatchReleaseRequest, BatchReleaseResponse> m_batch_release;
+  UnaryMethod<ReserveRequest, Reservation> m_reserve_slot;
+  UnaryMethod<ReservationRequest, Slot> m_confirm_reservation;
+  UnaryMethod<ReservationRequest, Status> m_cancel_reservation;
+  UnaryMethod<PayRequest, Receipt> m_pay;
+  UnaryMethod<TariffTable, Status> m_set_tariff;
+  UnaryMethod<SettleRequest, Settlement> m_settle_sessions;
+  UnaryMethod<MetricsRequest, MetricsReport> m_get_metrics;
+  UnaryMethod<ReconfigureRequest, LevelChanges> m_reconfigure_level;
+
+  /// Binds a unary method to its request function on the service and to its
+  /// handler on ParkingManagerImpl
+  template <typename Request, typename Response, typename RequestFn,
+            typename HandleFn>
+  void bindMethod(UnaryMethod<Request, Response> &method, RequestFn request_fn,
+                  HandleFn handle_fn) {
+    method.request = [this, request_fn](auto *context, auto *request,
+                                        auto *responder, auto *cq, void *tag) {
+      (m_service.*request_fn)(context, request, responder, cq, cq, tag);
+    };
+    method.handle = [this, handle_fn](auto *context, const auto *request,
+                                      auto *response) {
+      return (m_impl.*handle_fn)(context, request, response);
+    };
+  }
+
+  /// Arms the first call of every RPC on a completion queue
+  void armCalls(::grpc::ServerCompletionQueue *cq);
+
+  /// Drains a completion queue until it shuts down
+  static void drain(::grpc::ServerCompletionQueue *cq);
+
+public:
+  AsyncServer(ParkingManagerImpl &impl, unsigned cq_threads);
+  AsyncServer(const AsyncServer &) = delete;
+  auto operator=(const AsyncServer &) -> AsyncServer & = delete;
+
+  /// Starts listening on the address and serves until the server shuts down
+  void run(const std::string &server_address);
+
+  /// Stops the server and its completion queues
+  void shutdown();
+
+  virtual ~AsyncServer();
+};
+} // namespace services
+
+#endif // ASYNC_SERVER_HH
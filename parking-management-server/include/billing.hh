@@ -0,0 +1,100 @@
+#ifndef BILLING_HH
+#define BILLING_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include "slot_key.hh"
+#include "thread_pool.hh"
+#include "utils.hh"
+#include "vehicle.hh"
+
+namespace component {
+/// Minutes in a tariff day
+constexpr unsigned MINUTES_PER_DAY = 24 * 60;
+
+/// Hourly rate charged from start_minute up to end_minute of the day
+struct TariffBand {
+  unsigned start_minute{0};
+  unsigned end_minute{MINUTES_PER_DAY};
+  uint32_t cents_per_hour{0};
+};
+
+/// Tariff of a VehicleType as configured. Bands may overlap, the later one
+/// wins. Minutes which no band covers are free.
+struct VehicleTariff {
+  std::vector<TariffBand> bands;
+  /// Most a session pays for a single day, zero for no cap
+  uint64_t daily_cap_cents{0};
+};
+
+/// Tariff tables of a lot as configured
+struct TariffConfig {
+  std::array<VehicleTariff, TOTALVEHICLETYPE> vehicles;
+  /// Offset of the local time of the lot from UTC, days start at local
+  /// midnight
+  int32_t utc_offset_seconds{0};
+};
+
+/// Parking session of a slot, from the moment it was occupied to the moment
+/// it was returned
+struct Session {
+  SlotKey key;
+  std::time_t occupied_at{0};
+  std::time_t released_at{0};
+  uint64_t fee_cents{0};
+};
+
+/// Number of sessions settled together and the sum of their fees
+struct SettledSessions {
+  std::size_t count{0};
+  uint64_t total_cents{0};
+};
+
+/// Tariff compiled into flat tables: for every VehicleType the running cost
+/// of the day minute by minute, so pricing a session is a handful of lookups
+/// whatever its length and the number of bands, without allocating. Every
+/// started minute is charged, and every day of a session is capped on its
+/// own. The default Tariff is free.
+class Tariff {
+private:
+  /// Cost of the minutes of the day before the index, in cents * minutes per
+  /// hour so that the sum stays exact
+  std::array<std::array<uint64_t, MINUTES_PER_DAY + 1>, TOTALVEHICLETYPE>
+      m_running_cost{};
+  std::array<uint64_t, TOTALVEHICLETYPE> m_daily_cap{};
+  int64_t m_utc_offset{0};
+
+  /// Cost of the minutes [from, to) of a day, capped
+  [[nodiscard]] auto priceDay(const VehicleType &vt, unsigned from,
+                              unsigned to) const -> uint64_t;
+
+public:
+  Tariff() = default;
+
+  /// Compiles the configured tables. Returns UNAVAILABLE status if a band is
+  /// empty or does not fit in a day.
+  [[nodiscard]] static auto compile(const TariffConfig &config)
+      -> utils::StatusOr<Tariff>;
+
+  /// Fee of a session of the VehicleType, zero if it did not last
+  [[nodiscard]] auto price(const VehicleType &vt, std::time_t occupied_at,
+                           std::time_t released_at) const -> uint64_t;
+
+  /// Fills in the fee of the session
+  inline void price(Session &session) const {
+    session.fee_cents = price(session.key.getVehicleType(),
+                              session.occupied_at, session.released_at);
+  }
+
+  /// Prices every session in place, split across the workers of the pool.
+  /// Returns the sum of the fees.
+  auto settle(std::vector<Session> &sessions, ThreadPool &pool) const
+      -> uint64_t;
+};
+} // namespace component
+
+#endif // BILLING_HH
@@ -0,0 +1,81 @@
+#ifndef BITMAP_HH
+#define BITMAP_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace component {
+/// Growable packed bitset of slot occupancy, one bit per slot. Counting and
+/// searching run over whole words with the kernel selected for the CPU at
+/// startup: AVX2 where available and a portable scalar one otherwise.
+class OccupancyBitmap {
+public:
+  enum Kernel { SCALAR, AVX2, TOTAL_KERNEL };
+
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+private:
+  static constexpr std::size_t WORD_BITS = 64;
+
+  /// Bits past m_size are always clear
+  std::vector<uint64_t> m_words;
+  std::size_t m_size{0};
+
+public:
+  OccupancyBitmap() = default;
+
+  [[nodiscard]] inline auto size() const -> std::size_t { return m_size; }
+
+  /// Appends a bit
+  inline void push_back(bool value) {
+    if (m_size % WORD_BITS == 0) {
+      m_words.push_back(0);
+    }
+    if (value) {
+      m_words.back() |= 1ULL << (m_size % WORD_BITS);
+    }
+    m_size++;
+  }
+
+  [[nodiscard]] inline auto test(std::size_t index) const -> bool {
+    return (m_words[index / WORD_BITS] >> (index % WORD_BITS)) & 1U;
+  }
+
+  inline void set(std::size_t index) {
+    m_words[index / WORD_BITS] |= 1ULL << (index % WORD_BITS);
+  }
+
+  inline void reset(std::size_t index) {
+    m_words[index / WORD_BITS] &= ~(1ULL << (index % WORD_BITS));
+  }
+
+  /// Drops all the bits
+  inline void clear() {
+    m_words.clear();
+    m_size = 0;
+  }
+
+  inline void reserve(std::size_t bits) {
+    m_words.reserve((bits + WORD_BITS - 1) / WORD_BITS);
+  }
+
+  /// Number of set bits
+  [[nodiscard]] auto count() const -> std::size_t;
+
+  /// Index of the first clear bit at or after from, npos if there is none
+  [[nodiscard]] auto findFirstZero(std::size_t from = 0) const -> std::size_t;
+
+  /// Kernel used by count and findFirstZero
+  [[nodiscard]] static auto getKernel() -> Kernel;
+
+  /// Switches the kernel, returns false if the CPU does not support it
+  static auto setKernel(Kernel kernel) -> bool;
+
+  /// Returns if the CPU supports the kernel
+  [[nodiscard]] static auto isSupported(Kernel kernel) -> bool;
+};
+} // namespace component
+
+#endif // BITMAP_HH
@@ -0,0 +1,94 @@
+#ifndef EXPORTER_HH
+#define EXPORTER_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "occupancy.hh"
+#include "slot_key.hh"
+#include "slot_table.hh"
+
+namespace component {
+/// Text formats of an export
+enum ExportFormat { JSON, CSV, TOTAL_EXPORT_FORMAT };
+
+inline constexpr std::array<std::string_view, TOTAL_EXPORT_FORMAT>
+    export_format_names = {"json", "csv"};
+
+/// Receives the text of an export chunk by chunk, in order. Returns false to
+/// stop the export.
+using ExportSink = std::function<bool(std::string_view chunk)>;
+
+/// Streams the slots of a lot as JSON or CSV into an ExportSink. The text is
+/// built in a buffer which is handed to the sink every chunk_bytes, so the
+/// sink sees a few large writes. Numbers are formatted with std::to_chars and
+/// timestamps are seconds since the epoch: no locale, no time zone and no
+/// allocation per slot. An exporter shares no state with the others, any
+/// number of exports can run at once.
+///
+/// JSON is a single object:
+///
+///     {"name":"Downtown","levels":1,"available":1,"occupied":1,"held":0,
+///      "slots":[{"id":"0_CA_B_0","level":0,"vehicle_type":"CAR",
+///      "state":"OCCUPIED","occupied_at":1700000000},...]}
+///
+/// CSV has a header line followed by a line per slot:
+///
+///     id,level,vehicle_type,state,occupied_at
+///     0_CA_B_0,0,CAR,OCCUPIED,1700000000
+///
+/// occupied_at is null, or empty, for the slots which are not occupied.
+/// Retired slots are left out.
+class SlotExporter {
+private:
+  ExportFormat m_format;
+  ExportSink m_sink;
+  std::size_t m_chunk_bytes;
+  std::string m_buffer;
+  /// Whether the sink still takes chunks
+  bool m_open{true};
+  /// Key bits above the slot number of the last slot written, and the
+  /// unique_id prefix they format to. Slots of a zone share it.
+  uint64_t m_prefix_bits{~uint64_t{0}};
+  std::string m_prefix;
+
+  /// Appends the decimal digits of the value
+  void appendNumber(int64_t value);
+
+  /// Appends the string as a JSON string literal
+  void appendJsonString(std::string_view text);
+
+  /// Appends the unique_id of the slot
+  void appendSlotId(const SlotKey &key);
+
+  void appendSlot(const SlotKey &key, SlotState state,
+                  std::time_t occupied_at, bool first);
+
+  /// Hands the buffer to the sink once it holds a chunk, or whatever it holds
+  /// if asked to
+  void flush(bool force = false);
+
+public:
+  static constexpr std::size_t default_chunk_bytes = 64 * 1024;
+
+  SlotExporter(ExportFormat format, ExportSink sink,
+               std::size_t chunk_bytes = default_chunk_bytes);
+  SlotExporter(const SlotExporter &) = delete;
+  auto operator=(const SlotExporter &) -> SlotExporter & = delete;
+
+  /// Writes the lot of the name and the number of parking levels with the
+  /// slots of the engine. The slots are copied out under the engine lock, so
+  /// they are seen at a single point in time, and formatted once it is let
+  /// go. Returns the number of slots written, fewer if the sink stopped the
+  /// export.
+  auto write(std::string_view name, unsigned levels,
+             const OccupancyEngine &engine) -> std::size_t;
+};
+} // namespace component
+
+#endif // EXPORTER_HH
@@ -0,0 +1,129 @@
+#ifndef JOURNAL_HH
+#define JOURNAL_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "record_file.hh"
+
+namespace component {
+/// When an event appended to the Journal reaches the disk
+enum Durability {
+  /// Every call syncs its events itself before returning, without waiting on
+  /// the background writer
+  PER_EVENT,
+  /// Events are synced by a background writer, callers wait for the sync
+  /// covering their event. Events appended while a sync is in flight share
+  /// the next one.
+  GROUP,
+  /// Events are synced by a background writer at a fixed interval, callers
+  /// never wait. A crash loses at most one interval of events.
+  PERIODIC
+};
+
+/// A slot state change as stored in the Journal
+struct JournalRecord {
+  enum Event : uint32_t { OCCUPY, RETURN };
+
+  uint64_t slot_key{0};
+  int64_t occupied_at{0};
+  Event event{Event::OCCUPY};
+  uint32_t checksum{0};
+};
+static_assert(sizeof(JournalRecord) == 24, "Journal records are 24 bytes");
+
+/// Append-only log of slot state changes. Records are buffered in memory and
+/// written out and synced in groups by a background writer; the Durability
+/// decides who waits for the sync. The log is rotated out to be checkpointed
+/// and read back with replay().
+class Journal {
+private:
+  std::atomic<Durability> m_durability{Durability::GROUP};
+  /// Taken before m_mutex, serializes the writes to the file
+  std::mutex m_file_mutex;
+  std::mutex m_mutex;
+  std::condition_variable m_pending_cv;
+  std::condition_variable m_durable_cv;
+  /// Its writes are guarded by m_file_mutex and its queue by m_mutex
+  RecordFile<JournalRecord> m_file;
+  uint64_t m_appended_seq{0};
+  uint64_t m_durable_seq{0};
+  bool m_stop{false};
+  std::thread m_writer;
+
+  /// Writes out and syncs the pending records
+  void flush();
+
+  /// Background writer loop
+  void writeBehind();
+
+public:
+  /// Interval between the syncs of the PERIODIC durability
+  static constexpr std::chrono::milliseconds periodic_interval{100};
+  /// Records both buffers have room for up front
+  static constexpr std::size_t buffer_capacity =
+      RecordFile<JournalRecord>::buffer_capacity;
+
+  Journal() = default;
+  Journal(const Journal &) = delete;
+  auto operator=(const Journal &) -> Journal & = delete;
+
+  /// Opens the journal at the path, appending to the records already there,
+  /// and starts the background writer
+  void open(std::string path);
+
+  /// Returns if the journal has been opened
+  [[nodiscard]] inline auto isOpen() const -> bool { return m_file.isOpen(); }
+
+  /// Sets when the appended events reach the disk
+  inline void setDurability(Durability durability) {
+    m_durability.store(durability, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] inline auto getDurability() const -> Durability {
+    return m_durability.load(std::memory_order_relaxed);
+  }
+
+  /// Queues an event and returns its sequence number. Cheap enough to be
+  /// called under the locks of the OccupancyEngine, which keeps the events of
+  /// a slot in order.
+  auto append(JournalRecord::Event event, uint64_t slot_key,
+              std::time_t occupied_at) -> uint64_t;
+
+  /// Blocks until the event of the sequence number is as durable as the
+  /// Durability asks for. Must not be called under the OccupancyEngine locks.
+  void waitDurable(uint64_t seq);
+
+  /// Syncs the journal and moves its records to the path, the journal starts
+  /// over empty. Returns false, without moving anything, if the journal holds
+  /// no records.
+  auto rotate(const std::string &rotated_path) -> bool;
+
+  /// Syncs the pending records and stops the background writer
+  void close();
+
+  /// Calls fn on every intact record of the journal file at the path, in
+  /// order. Reading stops at the first torn or corrupt record. Returns the
+  /// number of records read.
+  static auto replay(const std::string &path,
+                     const std::function<void(const JournalRecord &)> &fn)
+      -> std::size_t;
+
+  /// Appends the intact records of the journal file at the path to the one at
+  /// to_path and syncs it. Returns false if the copy could not be synced.
+  static auto concatenate(const std::string &path, const std::string &to_path)
+      -> bool;
+
+  virtual ~Journal();
+};
+} // namespace component
+
+#endif // JOURNAL_HH
@@ -0,0 +1,71 @@
+#ifndef LOT_REGISTRY_HH
+#define LOT_REGISTRY_HH
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "journal.hh"
+#include "occupancy.hh"
+#include "parking.hh"
+#include "thread_pool.hh"
+
+namespace component {
+/// Parking lots hosted by a process, keyed by their name. Every lot keeps its
+/// own OccupancyEngine and storage files, named after the lot, while their
+/// background work runs on a single ThreadPool. Lots are handed out as
+/// shared pointers, so a lot closed while in use lives on until its last
+/// user lets go.
+class LotRegistry {
+private:
+  std::shared_ptr<ThreadPool> m_pool;
+  Durability m_durability;
+  SlotSelection m_selection;
+  /// Serializes the opening of lots, so that the files of a lot are only
+  /// ever opened once. Taken before m_mutex.
+  std::mutex m_open_mutex;
+  mutable std::shared_mutex m_mutex;
+  std::unordered_map<std::string, std::shared_ptr<ParkingLot>> m_lots;
+
+public:
+  explicit LotRegistry(
+      std::shared_ptr<ThreadPool> pool = ThreadPool::getShared(),
+      Durability durability = Durability::GROUP,
+      SlotSelection selection = SlotSelection::LOWEST_LEVEL);
+  LotRegistry(const LotRegistry &) = delete;
+  auto operator=(const LotRegistry &) -> LotRegistry & = delete;
+
+  /// Returns if the name can be used for a lot: the name prefixes the paths
+  /// of the files of the lot, so it must be a plain file name
+  [[nodiscard]] static auto isValidName(std::string_view name) -> bool;
+
+  /// Provides the lot of the name, opening it from its storage or creating
+  /// it if it is not hosted yet. Returns nullptr if the name is not valid.
+  auto open(const std::string &name, unsigned parking_levels)
+      -> std::shared_ptr<ParkingLot>;
+
+  /// Provides the lot of the name, nullptr if it is not hosted
+  [[nodiscard]] auto find(const std::string &name) const
+      -> std::shared_ptr<ParkingLot>;
+
+  /// Stops hosting the lot of the name. Returns false if it was not hosted.
+  auto close(const std::string &name) -> bool;
+
+  /// Names of the hosted lots
+  [[nodiscard]] auto getNames() const -> std::vector<std::string>;
+
+  [[nodiscard]] inline auto getThreadPool() const
+      -> const std::shared_ptr<ThreadPool> & {
+    return m_pool;
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t;
+};
+} // namespace component
+
+#endif // LOT_REGISTRY_HH
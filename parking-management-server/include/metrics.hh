@@ -0,0 +1,209 @@
+#ifndef METRICS_HH
+#define METRICS_HH
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace component {
+/// Events counted across the process
+enum Counter {
+  ALLOCATIONS,
+  ALLOCATION_FAILURES,
+  RETURNS,
+  RETURN_FAILURES,
+  SQL_ERRORS,
+  COUNTER_COUNT
+};
+
+/// Levels, kept as the sum of the changes every thread made to them
+enum Gauge { POOL_QUEUE_DEPTH, RPCS_IN_FLIGHT, GAUGE_COUNT };
+
+/// Operations whose latency is recorded
+enum Histogram {
+  LOT_GET_PARKING,
+  LOT_GET_PARKINGS,
+  LOT_RETURN_PARKING,
+  LOT_RETURN_PARKINGS,
+  LOT_RESERVE,
+  LOT_CONFIRM,
+  LOT_CANCEL,
+  LOT_ADD_PARKING,
+  LOT_ADD_PARKING_BATCH,
+  LOT_CHECKPOINT,
+  LOT_SETTLE,
+  LOT_RECONFIGURE_LEVEL,
+  LOT_EXPORT_SLOTS,
+  SQL_STEP,
+  RPC_CREATE_PARKING_LOT,
+  RPC_ALLOCATE_SLOT,
+  RPC_RELEASE_SLOT,
+  RPC_GET_STATS,
+  RPC_BATCH_ALLOCATE,
+  RPC_BATCH_RELEASE,
+  RPC_RESERVE_SLOT,
+  RPC_CONFIRM_RESERVATION,
+  RPC_CANCEL_RESERVATION,
+  RPC_PAY,
+  RPC_SET_TARIFF,
+  RPC_SETTLE_SESSIONS,
+  RPC_EXPORT_SESSIONS,
+  RPC_GET_METRICS,
+  RPC_RECONFIGURE_LEVEL,
+  HISTOGRAM_COUNT
+};
+
+inline constexpr std::array<const char *, COUNTER_COUNT> counter_names = {
+    "allocations_total",    "allocation_failures_total",
+    "returns_total",        "return_failures_total",
+    "sql_errors_total",
+};
+
+inline constexpr std::array<const char *, GAUGE_COUNT> gauge_names = {
+    "pool_queue_depth",
+    "rpcs_in_flight",
+};
+
+inline constexpr std::array<const char *, HISTOGRAM_COUNT> histogram_names = {
+    "lot_get_parking",
+    "lot_get_parkings",
+    "lot_return_parking",
+    "lot_return_parkings",
+    "lot_reserve",
+    "lot_confirm",
+    "lot_cancel",
+    "lot_add_parking",
+    "lot_add_parking_batch",
+    "lot_checkpoint",
+    "lot_settle",
+    "lot_reconfigure_level",
+    "lot_export_slots",
+    "sql_step",
+    "rpc_create_parking_lot",
+    "rpc_allocate_slot",
+    "rpc_release_slot",
+    "rpc_get_stats",
+    "rpc_batch_allocate",
+    "rpc_batch_release",
+    "rpc_reserve_slot",
+    "rpc_confirm_reservation",
+    "rpc_cancel_reservation",
+    "rpc_pay",
+    "rpc_set_tariff",
+    "rpc_settle_sessions",
+    "rpc_export_sessions",
+    "rpc_get_metrics",
+    "rpc_reconfigure_level",
+};
+
+/// Latencies in nanoseconds, bucketed the way HDR histograms do it: values
+/// below SUB_BUCKETS have a bucket each, larger ones share a bucket with the
+/// values within 1/SUB_BUCKETS of their power of two. Quantiles are off by at
+/// most 6.25%. Values of 2^MAX_BITS ns and more, above a minute, all land in
+/// the last bucket.
+class LatencyHistogram {
+public:
+  static constexpr unsigned SUB_BUCKET_BITS = 4;
+  static constexpr unsigned SUB_BUCKETS = 1U << SUB_BUCKET_BITS;
+  static constexpr unsigned MAX_BITS = 36;
+  static constexpr unsigned BUCKETS =
+      SUB_BUCKETS + (MAX_BITS - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+private:
+  std::array<uint64_t, BUCKETS> m_buckets{};
+  uint64_t m_count{0};
+  uint64_t m_sum{0};
+  uint64_t m_max{0};
+
+public:
+  /// Bucket of the value
+  [[nodiscard]] static inline auto getBucket(uint64_t ns) -> unsigned {
+    if (ns < SUB_BUCKETS) {
+      return static_cast<unsigned>(ns);
+    }
+    auto msb = static_cast<unsigned>(63 - __builtin_clzll(ns));
+    if (msb >= MAX_BITS) {
+      return BUCKETS - 1;
+    }
+    unsigned shift = msb - SUB_BUCKET_BITS;
+    return SUB_BUCKETS + shift * SUB_BUCKETS +
+           static_cast<unsigned>((ns >> shift) - SUB_BUCKETS);
+  }
+
+  /// Highest value of the bucket
+  [[nodiscard]] static auto getBucketMax(unsigned bucket) -> uint64_t;
+
+  /// Adds count values of the bucket, which sum up to sum
+  void add(unsigned bucket, uint64_t count, uint64_t sum, uint64_t max);
+
+  inline void record(uint64_t ns) { add(getBucket(ns), 1, ns, ns); }
+
+  void merge(const LatencyHistogram &other);
+
+  [[nodiscard]] inline auto getCount() const -> uint64_t { return m_count; }
+
+  [[nodiscard]] inline auto getSum() const -> uint64_t { return m_sum; }
+
+  [[nodiscard]] inline auto getMax() const -> uint64_t { return m_max; }
+
+  /// Smallest value at least the fraction q of the values are at or below,
+  /// rounded up to its bucket. Zero if there are no values.
+  [[nodiscard]] auto getQuantile(double q) const -> uint64_t;
+};
+
+/// Values of every metric at one point in time
+struct MetricsSnapshot {
+  std::array<uint64_t, COUNTER_COUNT> counters{};
+  std::array<int64_t, GAUGE_COUNT> gauges{};
+  std::array<LatencyHistogram, HISTOGRAM_COUNT> histograms{};
+
+  /// Writes the metrics in the Prometheus text format. Histograms are
+  /// summaries in seconds with their 0.5, 0.9, 0.99 and 0.999 quantiles.
+  void writePrometheus(std::ostream &os) const;
+};
+
+/// Metrics of the process. Every thread records into its own block, which it
+/// alone writes, so recording is a few plain loads and stores: no lock and no
+/// locked instruction. A thread registers its block on its first record, and
+/// the values of a thread are folded into the totals when it exits.
+class Metrics {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static void add(Counter counter, uint64_t count = 1);
+
+  static void add(Gauge gauge, int64_t delta);
+
+  static void record(Histogram histogram, Clock::duration latency);
+
+  /// Sums the blocks of all the threads. Records made meanwhile may or may
+  /// not be part of it.
+  [[nodiscard]] static auto snapshot() -> std::unique_ptr<MetricsSnapshot>;
+
+  /// Writes a snapshot to the file in the Prometheus text format, replacing
+  /// it at once. Returns false if it cannot be written.
+  static auto writePrometheusFile(const std::string &path) -> bool;
+};
+
+/// Records the time from its construction to its destruction
+class ScopedLatency {
+private:
+  Histogram m_histogram;
+  Metrics::Clock::time_point m_start{Metrics::Clock::now()};
+
+public:
+  explicit ScopedLatency(Histogram histogram) : m_histogram(histogram) {}
+  ScopedLatency(const ScopedLatency &) = delete;
+  auto operator=(const ScopedLatency &) -> ScopedLatency & = delete;
+
+  ~ScopedLatency() {
+    Metrics::record(m_histogram, Metrics::Clock::now() - m_start);
+  }
+};
+} // namespace component
+
+#endif // METRICS_HH
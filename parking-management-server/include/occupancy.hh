@@ -0,0 +1,546 @@
+#ifndef OCCUPANCY_HH
+#define OCCUPANCY_HH
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bitmap.hh"
+#include "parking_slot.hh"
+#include "slot_key.hh"
+#include "slot_table.hh"
+#include "utils.hh"
+#include "vehicle.hh"
+
+namespace component {
+/// Highest number of parking levels a lot can hold
+constexpr unsigned MAX_PARKING_LEVELS = 256;
+static_assert(MAX_PARKING_LEVELS <= (1U << SlotKey::LEVEL_BITS),
+              "Every parking level must fit a SlotKey");
+
+/// Matrix of available, occupied and held slot counts for every (parking level,
+/// VehicleType) pair along with its per level, per VehicleType and lot wide
+/// totals. Every update adjusts all the aggregates, so each query is a single
+/// atomic load. Counters are updated one at a time, a reader racing with an
+/// update may observe the slot in neither or in both of the states.
+class OccupancyCounters {
+private:
+  struct Counter {
+    std::atomic<unsigned> available{0};
+    std::atomic<unsigned> occupied{0};
+    std::atomic<unsigned> held{0};
+  };
+
+  /// Moves a slot between two of the states of the counter
+  template <std::atomic<unsigned> Counter::*From,
+            std::atomic<unsigned> Counter::*To>
+  inline void transfer(unsigned level, const VehicleType &vt) {
+    update(level, vt, [](Counter &counter) {
+      (counter.*From).fetch_sub(1, std::memory_order_relaxed);
+      (counter.*To).fetch_add(1, std::memory_order_relaxed);
+    });
+  }
+
+  std::array<std::array<Counter, TOTALVEHICLETYPE>, MAX_PARKING_LEVELS>
+      m_level_vehicle;
+  std::array<Counter, MAX_PARKING_LEVELS> m_level;
+  std::array<Counter, TOTALVEHICLETYPE> m_vehicle;
+  Counter m_total;
+
+  /// Applies the update to the cell and all the aggregates it contributes to
+  template <typename Fn>
+  inline void update(unsigned level, const VehicleType &vt, Fn fn) {
+    fn(m_level_vehicle[level][vt]);
+    fn(m_level[level]);
+    fn(m_vehicle[vt]);
+    fn(m_total);
+  }
+
+public:
+  OccupancyCounters() = default;
+
+  /// Accounts for a new slot
+  inline void add(unsigned level, const VehicleType &vt, bool occupied) {
+    add(level, vt, occupied ? SlotState::OCCUPIED : SlotState::AVAILABLE);
+  }
+
+  /// Accounts for count new slots in the given state
+  inline void add(unsigned level, const VehicleType &vt, SlotState state,
+                  unsigned count = 1) {
+    update(level, vt, [state, count](Counter &counter) {
+      (state == SlotState::OCCUPIED ? counter.occupied
+       : state == SlotState::HELD   ? counter.held
+                                    : counter.available)
+          .fetch_add(count, std::memory_order_relaxed);
+    });
+  }
+
+  /// Accounts for a slot taken out of the lot in the given state
+  inline void remove(unsigned level, const VehicleType &vt, SlotState state) {
+    update(level, vt, [state](Counter &counter) {
+      (state == SlotState::OCCUPIED ? counter.occupied
+       : state == SlotState::HELD   ? counter.held
+                                    : counter.available)
+          .fetch_sub(1, std::memory_order_relaxed);
+    });
+  }
+
+  /// Moves a slot from available to occupied
+  inline void occupy(unsigned level, const VehicleType &vt) {
+    transfer<&Counter::available, &Counter::occupied>(level, vt);
+  }
+
+  /// Moves a slot from occupied to available
+  inline void release(unsigned level, const VehicleType &vt) {
+    transfer<&Counter::occupied, &Counter::available>(level, vt);
+  }
+
+  /// Moves a slot from available to held
+  inline void hold(unsigned level, const VehicleType &vt) {
+    transfer<&Counter::available, &Counter::held>(level, vt);
+  }
+
+  /// Moves a slot from held to occupied
+  inline void confirmHold(unsigned level, const VehicleType &vt) {
+    transfer<&Counter::held, &Counter::occupied>(level, vt);
+  }
+
+  /// Moves a slot from held to available
+  inline void cancelHold(unsigned level, const VehicleType &vt) {
+    transfer<&Counter::held, &Counter::available>(level, vt);
+  }
+
+  /// Zeroes all the counters
+  void reset();
+
+  [[nodiscard]] inline auto getTotalAvailable() const -> unsigned {
+    return m_total.available.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] inline auto getTotalOccupied() const -> unsigned {
+    return m_total.occupied.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] inline auto getTotalHeld() const -> unsigned {
+    return m_total.held.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] inline auto getAvailableAtLevel(unsigned level) const
+      -> unsigned {
+    return level < MAX_PARKING_LEVELS
+               ? m_level[level].available.load(std::memory_order_relaxed)
+               : 0;
+  }
+
+  [[nodiscard]] inline auto getOccupiedAtLevel(unsigned level) const
+      -> unsigned {
+    return level < MAX_PARKING_LEVELS
+               ? m_level[level].occupied.load(std::memory_order_relaxed)
+               : 0;
+  }
+
+  [[nodiscard]] inline auto
+  getAvailableForVehicleType(const VehicleType &vt) const -> unsigned {
+    return m_vehicle[vt].available.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] inline auto
+  getOccupiedForVehicleType(const VehicleType &vt) const -> unsigned {
+    return m_vehicle[vt].occupied.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] inline auto getAvailable(unsigned level,
+                                         const VehicleType &vt) const
+      -> unsigned {
+    return level < MAX_PARKING_LEVELS
+               ? m_level_vehicle[level][vt].available.load(
+                     std::memory_order_relaxed)
+               : 0;
+  }
+
+  [[nodiscard]] inline auto getOccupied(unsigned level,
+                                        const VehicleType &vt) const
+      -> unsigned {
+    return level < MAX_PARKING_LEVELS
+               ? m_level_vehicle[level][vt].occupied.load(
+                     std::memory_order_relaxed)
+               : 0;
+  }
+
+  [[nodiscard]] inline auto getHeld(unsigned level, const VehicleType &vt) const
+      -> unsigned {
+    return level < MAX_PARKING_LEVELS
+               ? m_level_vehicle[level][vt].held.load(std::memory_order_relaxed)
+               : 0;
+  }
+};
+
+/// How the OccupancyEngine picks the slot handed out by an allocation
+enum SlotSelection {
+  /// First available slot of the lowest parking level, in insertion order
+  LOWEST_LEVEL,
+  /// First available slot of the parking level with the smallest share of
+  /// occupied slots for the VehicleType
+  LEAST_LOADED_LEVEL,
+  /// Available slot with the lowest SlotKey, so that a parking zone fills up
+  /// before the next one is opened
+  ZONE_PACKING,
+  /// Available slot with the smallest distance to the entrance
+  NEAREST_ENTRANCE,
+  TOTAL_SLOT_SELECTION
+};
+
+/// Distance of a slot to the entrance, used by NEAREST_ENTRANCE
+using SlotDistance = std::function<uint64_t(const SlotKey &)>;
+
+/// Slots of a (parking level, VehicleType) pair changed by
+/// OccupancyEngine::reconfigure
+struct SlotChanges {
+  /// Slots which were not registered
+  std::vector<SlotKey> added;
+  /// Retired slots registered again, available
+  std::vector<SlotKey> revived;
+  /// Draining slots which are kept after all
+  std::vector<SlotKey> kept;
+  /// Available slots retired right away
+  std::vector<SlotKey> retired;
+  /// Occupied or held slots which retire once released
+  std::vector<SlotKey> draining;
+};
+
+/// Slots laid out column by column as a Snapshot stores them, handed to
+/// OccupancyEngine::load
+struct SlotColumns {
+  std::size_t count{0};
+  /// SlotKey value of every slot
+  const uint64_t *keys{nullptr};
+  /// One bit per slot in 64 bit words, set for the occupied ones
+  const uint64_t *occupancy{nullptr};
+  /// Time every slot was occupied at
+  const int64_t *occupied_at{nullptr};
+};
+
+/// Default SlotDistance, the entrance being at the ground level next to the
+/// lowest slot numbers of every zone
+[[nodiscard]] auto entranceDistance(const SlotKey &key) -> uint64_t;
+
+/// In-memory view of the occupancy of a parking lot. Slots are kept in a
+/// SlotTable and every (parking level, VehicleType) pair owns an occupancy
+/// bitmap over its slots, so allocation, return and counting never touch the
+/// DB.
+///
+/// The SlotSelection picks the parking level out of the counters of the
+/// levels, at most MAX_PARKING_LEVELS loads. Within the level, LOWEST_LEVEL
+/// and LEAST_LOADED_LEVEL take the first available slot with a word wide scan
+/// of the bitmap. ZONE_PACKING and NEAREST_ENTRANCE rank every slot and keep
+/// the available slots of each pair in a min heap on the rank, so that an
+/// allocation or a return is O(log n) in the slots of the pair.
+///
+/// Slots are retired rather than removed: the row of a retired slot stays in
+/// the SlotTable with its bit set, so it is never handed out, and it is
+/// revived if the slot is added back. An occupied or held slot being retired
+/// drains: it serves its car and retires when it is released.
+///
+/// The engine is thread safe. Adding and clearing slots takes the engine lock
+/// exclusively. Allocation, return and lookups share it and lock only the
+/// shard of the (parking level, VehicleType) pair they touch, so requests for
+/// different levels and VehicleTypes proceed in parallel. Observers passed to
+/// allocate and release run under the shard lock, which orders the changes of
+/// a slot as seen by the observers. Slots are handed out as SlotViews, copies
+/// of their row at the time of the call.
+class OccupancyEngine {
+public:
+  using SlotObserver = std::function<void(const SlotView &)>;
+
+private:
+  static constexpr uint64_t NO_RANK = std::numeric_limits<uint64_t>::max();
+
+  struct RankedPosition {
+    uint64_t rank;
+    uint32_t position;
+
+    /// Orders the heap on the lowest rank, then on the lowest position
+    inline auto operator>(const RankedPosition &other) const -> bool {
+      return rank != other.rank ? rank > other.rank
+                                : position > other.position;
+    }
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    /// Row in m_table of every slot of the shard, by position
+    std::vector<uint32_t> slots;
+    /// Bit set for every occupied or held position
+    OccupancyBitmap occupied;
+    /// Every position before it is occupied
+    std::size_t first_free{0};
+    /// Available positions by rank, only kept for the ranked SlotSelections
+    std::vector<RankedPosition> free_heap;
+    /// Rank on top of free_heap, for picking a level without locking it
+    std::atomic<uint64_t> best_rank{NO_RANK};
+    /// Hold id of every held position
+    std::unordered_map<uint32_t, uint64_t> holds;
+    /// Positions which retire once released
+    std::unordered_set<uint32_t> draining;
+    /// Number of retired positions, their bits are set
+    std::size_t retired{0};
+  };
+
+  SlotTable m_table;
+  /// Position of every slot in its shard, by row of m_table
+  std::vector<uint32_t> m_shard_position;
+  /// Rank of every slot by row of m_table, only kept for the ranked
+  /// SlotSelections
+  std::vector<uint64_t> m_rank;
+  SlotSelection m_selection{SlotSelection::LOWEST_LEVEL};
+  SlotDistance m_distance{entranceDistance};
+  std::unordered_map<uint64_t, std::size_t> m_slot_index;
+  std::array<std::array<Shard, TOTALVEHICLETYPE>, MAX_PARKING_LEVELS> m_shards;
+  std::atomic<unsigned> m_level_count{0};
+  OccupancyCounters m_counters;
+  mutable std::shared_mutex m_mutex;
+  /// Guards m_drained, taken after the shard locks
+  std::mutex m_drained_mutex;
+  /// Slots retired since the last takeDrained, outside of reconfigure
+  std::vector<SlotKey> m_drained;
+
+  [[nodiscard]] inline auto getShard(unsigned level, const VehicleType &vt)
+      -> Shard & {
+    return m_shards[level][vt];
+  }
+
+  [[nodiscard]] inline auto getShard(unsigned level,
+                                     const VehicleType &vt) const
+      -> const Shard & {
+    return m_shards[level][vt];
+  }
+
+  /// Registers a slot in the given state, or revives it if it is retired.
+  /// hold_id is only used for HELD. The engine lock must be held exclusively.
+  auto insertSlot(const SlotKey &key, SlotState state, std::time_t occupied_at,
+                  uint64_t hold_id = 0) -> bool;
+
+  /// Retires the row of an available, occupied or held slot, leaving its
+  /// bit set. The shard lock or the exclusive engine lock must be held.
+  void retireRow(Shard &shard, std::size_t row, std::size_t position);
+
+  /// Retires the slot of a draining position once it is released, the shard
+  /// lock must be held. Returns false if the position is not draining.
+  auto retireDrained(Shard &shard, std::size_t row, std::size_t position)
+      -> bool;
+
+  /// Drops the retired positions off the heap of the shard, the engine lock
+  /// must be held exclusively
+  void pruneHeap(Shard &shard);
+
+  /// Returns if the SlotSelection keeps the available slots in heaps
+  [[nodiscard]] inline auto isRanked() const -> bool {
+    return m_selection == SlotSelection::ZONE_PACKING ||
+           m_selection == SlotSelection::NEAREST_ENTRANCE;
+  }
+
+  /// Rank of the slot under the SlotSelection, lowest first
+  [[nodiscard]] auto rankSlot(const SlotKey &key) const -> uint64_t;
+
+  /// Rebuilds the ranks and the heaps, the engine lock must be held
+  /// exclusively
+  void rebuildRanks();
+
+  /// Picks the parking level to allocate from, skipping the levels already
+  /// tried. Returns MAX_PARKING_LEVELS if there is none left.
+  [[nodiscard]] auto
+  selectLevel(const VehicleType &vt,
+              const std::bitset<MAX_PARKING_LEVELS> &tried) const -> unsigned;
+
+  /// Takes the position handed out by the SlotSelection off the shard, the
+  /// shard lock must be held. Returns OccupancyBitmap::npos if it is full.
+  [[nodiscard]] auto takePosition(Shard &shard) -> std::size_t;
+
+  /// Puts a released position back into the shard, the shard lock must be
+  /// held
+  void putPosition(Shard &shard, std::size_t row, std::size_t position);
+
+  /// Occupies or holds a slot for the VehicleType, the engine lock must be
+  /// held. hold_id is only used for HELD.
+  [[nodiscard]] auto acquireLocked(const VehicleType &vt, SlotState state,
+                                   std::time_t occupied_at, uint64_t hold_id,
+                                   const SlotObserver &on_acquire)
+      -> utils::StatusOr<SlotView>;
+
+  /// Occupies a slot for the VehicleType, the engine lock must be held
+  [[nodiscard]] inline auto allocateLocked(const VehicleType &vt,
+                                           std::time_t occupied_at,
+                                           const SlotObserver &on_allocate)
+      -> utils::StatusOr<SlotView> {
+    return acquireLocked(vt, SlotState::OCCUPIED, occupied_at, 0, on_allocate);
+  }
+
+  /// Ends the hold of the slot of the key, occupying the slot or making it
+  /// available again. Returns UNAVAILABLE status if the slot is not held
+  /// under the hold id.
+  auto endHold(const SlotKey &key, uint64_t hold_id, SlotState state,
+               std::time_t occupied_at, const SlotObserver &on_end)
+      -> utils::StatusOr<SlotView>;
+
+  /// Releases the slot of the key, the engine lock must be held
+  auto releaseLocked(const SlotKey &key, const SlotObserver &on_release)
+      -> bool;
+
+public:
+  OccupancyEngine() = default;
+
+  /// Registers a slot. Returns false if a slot with the same key is present,
+  /// if its level is beyond MAX_PARKING_LEVELS or if it has no valid key
+  auto addSlot(const ParkingSlot &slot) -> bool;
+
+  /// Registers a slot out of its fields, occupied_at is ignored for the
+  /// slots which are not occupied
+  auto addSlot(const SlotKey &key, bool occupied, std::time_t occupied_at)
+      -> bool;
+
+  /// Makes room for the given number of slots
+  void reserve(std::size_t slot_count);
+
+  /// Registers all the slots of the columns at once, then overrides the
+  /// state and occupied_at of the slots of the changes, in order. It is the
+  /// way a lot boots from a Snapshot: the bitmaps, counters and heaps are
+  /// built in a single pass under a single acquisition of the engine lock.
+  /// Rows which addSlot would reject are skipped, changes of unknown slots
+  /// are ignored. Returns false if the engine is not empty.
+  auto load(const SlotColumns &columns, const std::vector<SlotView> &changes)
+      -> bool;
+
+  /// Switches the way slots are picked. The distance is used by
+  /// NEAREST_ENTRANCE, entranceDistance if none is given. Ranking the slots
+  /// takes O(n) under the exclusive engine lock.
+  void setSlotSelection(SlotSelection selection,
+                        SlotDistance distance = nullptr);
+
+  [[nodiscard]] auto getSlotSelection() const -> SlotSelection;
+
+  /// Occupies an available slot for the VehicleType, picked by the
+  /// SlotSelection. A slot is handed out to a single caller until it is
+  /// released.
+  [[nodiscard]] auto allocate(const VehicleType &vt, std::time_t occupied_at,
+                              const SlotObserver &on_allocate = nullptr)
+      -> utils::StatusOr<SlotView>;
+
+  /// Occupies a slot for every VehicleType of the range under a single
+  /// acquisition of the engine lock. The result of every request is written
+  /// to out, in order.
+  template <typename ForwardIt, typename OutputIt>
+  void allocateBatch(ForwardIt first, ForwardIt last, std::time_t occupied_at,
+                     OutputIt out, const SlotObserver &on_allocate = nullptr) {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    for (; first != last; ++first, ++out) {
+      *out = allocateLocked(*first, occupied_at, on_allocate);
+    }
+  }
+
+  /// Holds an available slot for the VehicleType, picked by the
+  /// SlotSelection, under the hold id. A held slot is neither allocated nor
+  /// released until the hold is confirmed or cancelled.
+  [[nodiscard]] auto hold(const VehicleType &vt, uint64_t hold_id,
+                          const SlotObserver &on_hold = nullptr)
+      -> utils::StatusOr<SlotView>;
+
+  /// Occupies the slot held under the hold id. Returns UNAVAILABLE status if
+  /// the slot is not held under it.
+  [[nodiscard]] auto confirmHold(const SlotKey &key, uint64_t hold_id,
+                                 std::time_t occupied_at,
+                                 const SlotObserver &on_confirm = nullptr)
+      -> utils::StatusOr<SlotView>;
+
+  /// Makes the slot held under the hold id available again. Returns false if
+  /// the slot is not held under it.
+  auto cancelHold(const SlotKey &key, uint64_t hold_id,
+                  const SlotObserver &on_cancel = nullptr) -> bool;
+
+  /// Makes an occupied slot available again. Returns false if the slot is
+  /// unknown or not occupied. on_release is given the slot as it was
+  /// occupied, its parking time included.
+  auto release(const SlotKey &key, const SlotObserver &on_release = nullptr)
+      -> bool;
+
+  /// Releases the slot of every key of the range under a single acquisition
+  /// of the engine lock. Whether every slot was released is written to out,
+  /// in order.
+  template <typename ForwardIt, typename OutputIt>
+  void releaseBatch(ForwardIt first, ForwardIt last, OutputIt out,
+                    const SlotObserver &on_release = nullptr) {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    for (; first != last; ++first, ++out) {
+      *out = releaseLocked(*first, on_release);
+    }
+  }
+
+  /// Counts the occupied and held slots of the (parking level, VehicleType)
+  /// pair from its bitmap, less the retired ones. The counters give the same
+  /// figure without a scan, this is the ground truth they are checked
+  /// against.
+  [[nodiscard]] auto countOccupied(unsigned level, const VehicleType &vt) const
+      -> std::size_t;
+
+  /// Provides the slot registered against the key
+  [[nodiscard]] auto getSlot(const SlotKey &key) const
+      -> utils::StatusOr<SlotView>;
+
+  /// Calls fn with the SlotTable under the exclusive engine lock, so that the
+  /// slots are seen at a single point in time. fn should copy the columns it
+  /// needs and leave, allocations wait for it.
+  template <typename Fn> void readTable(Fn fn) const {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    fn(m_table);
+  }
+
+  /// Makes the slots of the (parking level, VehicleType) pair the wanted
+  /// ones, keys of other pairs are ignored. Missing slots are added or
+  /// revived, the others are retired or drain. Occupancy is left alone.
+  auto reconfigure(unsigned level, const VehicleType &vt,
+                   const std::vector<SlotKey> &wanted) -> SlotChanges;
+
+  /// Retires the slot, right away if it is available or else once it is
+  /// released. Returns false if it is unknown, retired or draining already.
+  auto drainSlot(const SlotKey &key) -> bool;
+
+  /// Returns if the slot retires once it is released
+  [[nodiscard]] auto isDraining(const SlotKey &key) const -> bool;
+
+  /// Provides the slots retired by drainSlot or by a release since the last
+  /// call. Some may have been revived meanwhile.
+  [[nodiscard]] auto takeDrained() -> std::vector<SlotKey>;
+
+  /// Drops all the slots of a certain level or of all the levels. The slots
+  /// of the other levels keep their state and their holds. Returns the ids of
+  /// the holds dropped along with their slots.
+  auto clear(int level = -1) -> std::vector<uint64_t>;
+
+  /// Number of slots registered
+  [[nodiscard]] inline auto getSlotCount() const -> std::size_t {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_table.size();
+  }
+
+  /// One more than the highest parking level having a slot registered
+  [[nodiscard]] inline auto getLevelCount() const -> unsigned {
+    return m_level_count.load(std::memory_order_acquire);
+  }
+
+  /// Occupancy counts of the lot
+  [[nodiscard]] inline auto getCounters() const -> const OccupancyCounters & {
+    return m_counters;
+  }
+};
+} // namespace component
+
+#endif // OCCUPANCY_HH
@@ -0,0 +1,86 @@
+#ifndef OCCUPANCY_FEED_HH
+#define OCCUPANCY_FEED_HH
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "vehicle.hh"
+
+namespace component {
+/// Occupancy of a (parking level, VehicleType) pair right after it changed
+struct OccupancyUpdate {
+  unsigned level{0};
+  VehicleType vt{VehicleType::TOTALVEHICLETYPE};
+  unsigned available{0};
+  unsigned occupied{0};
+  unsigned held{0};
+};
+
+/// Fans occupancy changes of a lot out to its subscribers. Every subscriber
+/// has its own queue which keeps only the latest update of every (parking
+/// level, VehicleType) pair, so a slow subscriber never holds the publisher
+/// back and never falls behind by more than one update per pair.
+class OccupancyFeed {
+public:
+  class Subscription {
+  private:
+    friend class OccupancyFeed;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<OccupancyUpdate> m_pending;
+    std::unordered_map<unsigned, std::size_t> m_pending_index;
+    bool m_closed{false};
+
+    /// Queues the update, replacing a pending one for the same pair
+    void push(const OccupancyUpdate &update);
+
+    /// Wakes up the subscriber for good
+    void close();
+
+  public:
+    Subscription() = default;
+    Subscription(const Subscription &) = delete;
+    auto operator=(const Subscription &) -> Subscription & = delete;
+
+    /// Waits up to the timeout for updates and takes all the pending ones.
+    /// Returns an empty batch on timeout or once the feed is gone.
+    [[nodiscard]] auto wait(std::chrono::milliseconds timeout)
+        -> std::vector<OccupancyUpdate>;
+
+    /// Returns if the feed has been shut down
+    [[nodiscard]] auto isClosed() -> bool;
+  };
+
+private:
+  std::mutex m_mutex;
+  std::vector<std::weak_ptr<Subscription>> m_subscriptions;
+  std::atomic<unsigned> m_subscriber_count{0};
+
+public:
+  OccupancyFeed() = default;
+  OccupancyFeed(const OccupancyFeed &) = delete;
+  auto operator=(const OccupancyFeed &) -> OccupancyFeed & = delete;
+
+  /// Registers a new subscriber. It stays subscribed as long as the returned
+  /// subscription is alive.
+  [[nodiscard]] auto subscribe() -> std::shared_ptr<Subscription>;
+
+  /// Returns if anyone listens to the feed, publishing is skipped otherwise
+  [[nodiscard]] inline auto hasSubscribers() const -> bool {
+    return m_subscriber_count.load(std::memory_order_relaxed) != 0;
+  }
+
+  /// Hands the update over to all the live subscribers
+  void publish(const OccupancyUpdate &update);
+
+  virtual ~OccupancyFeed();
+};
+} // namespace component
+
+#endif // OCCUPANCY_FEED_HH
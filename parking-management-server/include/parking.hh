@@ -3,96 +3,308 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <ctime>
 #include <functional>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "billing.hh"
+#include "exporter.hh"
+#include "journal.hh"
+#include "metrics.hh"
+#include "occupancy.hh"
+#include "occupancy_feed.hh"
+#include "parking_slot.hh"
+#include "session_log.hh"
+#include "slot_key.hh"
+#include "slot_table.hh"
+#include "snapshot.hh"
+#include "thread_pool.hh"
+#include "timer_wheel.hh"
 #include "utils.hh"
 #include "vehicle.hh"
 
 namespace component {
-class ParkingSlot {
+/// ParkingSlot creator function from unique_id. A malformed unique_id yields
+/// a slot with no parking level and no VehicleType.
+[[nodiscard]] auto makeParkingSlot(std::string unique_id) -> ParkingSlot;
+
+/// Parking zone the slots of every VehicleType of a level are numbered in,
+/// from 0, by CreateParkingLot and reconfigureLevel
+inline constexpr std::array<std::string_view, TOTALVEHICLETYPE> level_zones = {
+    "A", "B", "C", "D"};
+
+/// Number of slots of every VehicleType on a parking level
+using LevelCapacity = std::array<unsigned, TOTALVEHICLETYPE>;
+
+/// Slots of a VehicleType a level can hold, as many as a zone numbers
+inline constexpr unsigned max_level_capacity = 1U << SlotKey::NUMBER_BITS;
+
+/// Slots of a parking level changed by reconfigureLevel
+struct LevelChanges {
+  /// Slots added, or kept back from retirement
+  unsigned added{0};
+  /// Available slots retired right away
+  unsigned retired{0};
+  /// Occupied or held slots which retire once released
+  unsigned draining{0};
+};
+
+/// A slot held for a reservation until the car shows up or the hold expires
+struct Hold {
+  uint64_t id{0};
+  SlotView slot;
+  std::time_t expires_at{0};
+};
+
+/// A parking lot backed by a sqlite DB. All the methods can be called from
+/// several threads concurrently, allocations for different parking levels and
+/// VehicleTypes only contend on the Journal append.
+///
+/// Allocations and returns are appended to the Journal of the lot and applied
+/// to the DB by a background checkpoint. Opening the lot replays whatever the
+/// Journal holds into the DB, so the occupancy survives a crash up to the
+/// Durability of the lot.
+///
+/// Every snapshot_interval the checkpoint also writes a Snapshot of the
+/// occupancy. The journal events checkpointed since are kept aside, so that
+/// opening the lot maps the Snapshot and replays them on top of it instead of
+/// reading the whole DB. Adding or deleting slots drops the Snapshot until the
+/// next one is written.
+///
+/// Reservations hold a slot until they are confirmed, cancelled or expire.
+/// Holds are kept in memory only, a lot opens with none.
+///
+/// Every return is priced and appended to the SessionLog of the lot, which
+/// the checkpoint writes out.
+///
+/// reconfigureLevel retires slots without evicting their cars. The slots
+/// still in use are listed in the retired_slots table until they are
+/// released, then the checkpoint deletes them.
+class ParkingLot {
 private:
-  int m_parking_level{-1};
-  std::string m_parking_slot_id;
-  VehicleType m_vt{VehicleType::TOTALVEHICLETYPE};
-  bool m_occupied{false};
-  std::time_t m_occupied_at;
+  /// SQL statements issued by the lot. They are compiled once in openDB() and
+  /// reset and rebound on every call. Reads are served by the OccupancyEngine,
+  /// the DB only sees writes.
+  enum Statement {
+    OCCUPY,
+    RETURN,
+    INSERT,
+    DELETE,
+    RETIRE,
+    KEEP,
+    BEGIN,
+    COMMIT,
+    TOTAL_STATEMENT
+  };
 
-public:
-  ParkingSlot() = default;
-  ParkingSlot(int level, std::string parking, const VehicleType &vt)
-      : m_parking_level(level), m_parking_slot_id(std::move(parking)),
-        m_vt(vt) {}
+  sqlite3 *m_db{nullptr};
+  std::string m_db_name;
+  std::string m_parking_name;
+  unsigned m_parking_level_count{0};
+  std::array<sqlite3_stmt *, Statement::TOTAL_STATEMENT> m_statements{};
+  OccupancyEngine m_occupancy;
+  OccupancyFeed m_feed;
+  /// Serializes the use of the DB handle and of the cached statements. It is
+  /// always taken after the locks of the OccupancyEngine.
+  std::mutex m_db_mutex;
+  /// Number of batches sharing the open transaction. Transactions are only
+  /// opened under m_provision_mutex, so they are shared within a thread.
+  unsigned m_transaction_depth{0};
+  Journal m_journal;
+  SessionLog m_sessions;
+  /// Runs the background checkpoint and the expiry of the holds
+  std::shared_ptr<ThreadPool> m_pool{ThreadPool::getShared()};
+  ThreadPool::TaskId m_checkpoint_task{ThreadPool::INVALID_TASK};
+  ThreadPool::TaskId m_hold_task{ThreadPool::INVALID_TASK};
+  /// Serializes the checkpoints, taken before the DB lock
+  std::mutex m_checkpoint_mutex;
+  /// Whether the Snapshot lags behind the occupancy
+  std::atomic<bool> m_snapshot_dirty{false};
+  /// When the last Snapshot was written, guarded by m_checkpoint_mutex
+  std::chrono::steady_clock::time_point m_snapshot_time;
+  /// Held while slots are added or deleted and while the Snapshot is taken,
+  /// so that a Snapshot never sees a half provisioned lot. Taken after
+  /// m_checkpoint_mutex and before the OccupancyEngine locks.
+  std::mutex m_provision_mutex;
+
+  /// Hold waiting for its car
+  struct PendingHold {
+    SlotKey key;
+    TimerWheel::TimerId timer;
+  };
 
-  /// Return parking level for the parking spot
-  [[nodiscard]] inline auto getParkingLevel() const -> int {
-    return m_parking_level;
+  /// Guards the pending holds and their expiry, never held along with
+  /// another lock
+  std::mutex m_hold_mutex;
+  /// Holds expired by the last tick, only touched by the expiry task
+  std::vector<std::pair<uint64_t, SlotKey>> m_expired_holds;
+  /// Expiry of the pending holds in ticks of hold_tick since m_hold_epoch
+  TimerWheel m_hold_wheel;
+  std::chrono::steady_clock::time_point m_hold_epoch{
+      std::chrono::steady_clock::now()};
+  std::unordered_map<uint64_t, PendingHold> m_holds;
+  std::atomic<uint64_t> m_next_hold_id{0};
+
+  /// Tariff pricing the returns, swapped as a whole with std::atomic_load and
+  /// std::atomic_store so that pricing never waits for a reconfiguration
+  std::shared_ptr<const Tariff> m_tariff{std::make_shared<const Tariff>()};
+
+  /// Compiles all the statements of the lot against the opened DB
+  void prepareStatements();
+
+  /// Returns if the DB still keys the parking table by unique_id strings
+  [[nodiscard]] auto hasLegacySchema() const -> bool;
+
+  /// Moves the slots of a parking table keyed by unique_id strings over to the
+  /// SlotKey keyed table and loads them into the OccupancyEngine
+  void migrateLegacySlots();
+
+  /// Loads the slots stored in the DB into the OccupancyEngine
+  void loadOccupancy();
+
+  /// Drains the slots listed in the retired_slots table
+  void loadRetiredSlots();
+
+  /// Deletes the slots the OccupancyEngine retired since the last call from
+  /// the DB, the provisioning lock must be held
+  void deleteDrainedSlots();
+
+  /// Path of the Journal of the lot
+  [[nodiscard]] inline auto getJournalPath() const -> std::string {
+    return m_parking_name + ".journal";
   }
 
-  /// Sets parking level for the parking spot
-  inline void setParkingLevel(int level) { m_parking_level = level; }
+  /// Path the Journal is rotated to while it is being checkpointed
+  [[nodiscard]] inline auto getCheckpointPath() const -> std::string {
+    return m_parking_name + ".journal.checkpoint";
+  }
 
-  /// Returns an unique ID for the parking slot
-  [[nodiscard]] inline auto getParkingSlotId() const -> std::string {
-    return m_parking_slot_id;
+  /// Path of the SessionLog of the lot
+  [[nodiscard]] inline auto getSessionLogPath() const -> std::string {
+    return m_parking_name + ".sessions";
   }
 
-  /// Sets an unique ID for the parking slot
-  inline void setParkingSlotId(std::string id) {
-    m_parking_slot_id = std::move(id);
+  /// Path of the Snapshot of the lot
+  [[nodiscard]] inline auto getSnapshotPath() const -> std::string {
+    return m_parking_name + ".snapshot";
   }
 
-  /// Returns the type of Vehicle that the parking spot can park
-  [[nodiscard]] inline auto getVehicleType() const -> VehicleType {
-    return m_vt;
+  /// Path of the checkpointed journal events the Snapshot does not cover yet
+  [[nodiscard]] inline auto getAppliedJournalPath() const -> std::string {
+    return m_parking_name + ".journal.applied";
   }
 
-  /// Sets the type of Vehicle that the parking spot can park
-  inline void setVehicleType(const VehicleType &vt) { m_vt = vt; }
+  /// Applies the events of a journal file to the DB in a single transaction,
+  /// sets them aside for the next Snapshot and removes the file once they are
+  /// committed. The provisioning lock must be held, so that the transaction
+  /// is not shared with a batch.
+  void applyJournal(const std::string &path);
 
-  /// Returns if the parking spot is occupied
-  [[nodiscard]] inline auto isOccupied() const -> bool { return m_occupied; }
+  /// Moves the Journal out and applies it, the provisioning lock must be held
+  void checkpointJournal();
 
-  /// Marks the parking spot available or occupied
-  inline void setOccupied(bool occupied) { m_occupied = occupied; }
+  /// Loads the OccupancyEngine from the Snapshot and the journal events set
+  /// aside since. Returns false if there is no usable Snapshot.
+  auto loadSnapshot() -> bool;
 
-  /// Returns the time at which parking spot was occupied. If the parking spot
-  /// is not occupied, it retuns UNAVAILABLE status
-  [[nodiscard]] inline auto getParkingTime() const
-      -> utils::StatusOr<std::time_t> {
-    if (m_occupied) {
-      return utils::StatusOr<std::time_t>(m_occupied_at);
-    } else {
-      return utils::StatusOr<std::time_t>(utils::Status::UNAVAILABLE);
-    }
-  }
+  /// Writes a Snapshot of the occupancy, the lock of the checkpoints must be
+  /// held
+  void writeSnapshot();
 
-  /// Sets the parking time
-  inline void setParkingTime(const std::time_t &occupied_at) {
-    assert(m_occupied == false);
-    m_occupied = true;
-    m_occupied_at = occupied_at;
-  }
+  /// Drops the Snapshot ahead of adding or deleting slots, the provisioning
+  /// lock must be held
+  void invalidateSnapshot();
 
-  friend auto operator<<(std::ostream &os, const ParkingSlot &obj)
-      -> std::ostream &;
-};
+  /// Stops the background checkpoint
+  void stopCheckpoint();
 
-class ParkingLot {
-private:
-  sqlite3 *m_db{nullptr};
-  std::string m_db_name;
-  std::string m_parking_name;
-  unsigned m_parking_level_count{0};
+  /// Tick of the hold wheel reached at the time point, rounded up
+  [[nodiscard]] auto getHoldTick(std::chrono::steady_clock::time_point time)
+      const -> uint64_t;
+
+  /// Drops the expired holds, run every hold_tick
+  void expireHolds();
+
+  /// Stops the expiry of the holds
+  void stopHoldExpiry();
+
+  /// Takes the pending hold off the wheel. Returns false if it is unknown or
+  /// already expired.
+  auto takeHold(uint64_t hold_id, SlotKey &key) -> bool;
+
+  /// Releases all the compiled statements
+  void finalizeStatements();
+
+  /// Provides the compiled statement, ready to be bound
+  [[nodiscard]] auto getStatement(Statement statement) const -> sqlite3_stmt *;
+
+  /// Runs a statement which takes no parameters, the DB lock must be held.
+  /// Returns false if it failed.
+  auto execute(Statement statement) -> bool;
+
+  /// Opens a transaction, or joins the one already opened by an enclosing
+  /// batch. The provisioning lock must be held.
+  void beginTransaction();
+
+  /// Commits the transaction once the last batch sharing it is done. Returns
+  /// true only if this call committed it.
+  auto commitTransaction() -> bool;
+
+  /// Journals an allocated slot and publishes the change. Returns the
+  /// sequence number of the Journal event.
+  auto recordOccupied(const SlotView &slot) -> uint64_t;
+
+  /// Journals a returned slot, prices its session and publishes the change.
+  /// The session is logged by the caller once the engine locks are released.
+  /// Returns the sequence number of the Journal event.
+  auto recordReturned(const SlotView &occupied, Session &session) -> uint64_t;
+
+  /// Registers the slot with the OccupancyEngine and inserts it into the DB
+  void insertParking(ParkingSlot slot);
+
+  /// Inserts the row of a slot into the DB, replacing the one it may have
+  void insertRow(const SlotKey &key, bool occupied, std::time_t occupied_at);
+
+  /// Runs a statement which takes the key of a slot
+  void executeForSlot(Statement statement, const SlotKey &key);
+
+  /// Tells the subscribers about the occupancy of the (parking level,
+  /// VehicleType) pair of the slot
+  inline void publishOccupancy(const SlotKey &key) {
+    publishOccupancy(key.getParkingLevel(), key.getVehicleType());
+  }
+
+  void publishOccupancy(unsigned level, const VehicleType &vt);
 
 public:
+  /// Interval between two checkpoints of the Journal into the DB
+  static constexpr std::chrono::seconds checkpoint_interval{1};
+  /// Shortest interval between two Snapshots
+  static constexpr std::chrono::seconds snapshot_interval{30};
+  /// Resolution of the expiry of the holds
+  static constexpr std::chrono::milliseconds hold_tick{100};
+  /// Sessions read and priced at a time by settle()
+  static constexpr std::size_t settle_chunk_rows = 1 << 16;
+
   ParkingLot() = default;
   explicit ParkingLot(std::string name, unsigned parking_levels);
+  /// Lot running its background work on the pool
+  ParkingLot(std::string name, unsigned parking_levels,
+             std::shared_ptr<ThreadPool> pool);
+  ParkingLot(const ParkingLot &) = delete;
+  auto operator=(const ParkingLot &) -> ParkingLot & = delete;
 
   /// Opens up a DB if already not opened.
   void openDB();
@@ -118,6 +330,31 @@ public:
   /// Adds another parking level to the lot
   inline void addParkingLevel() { m_parking_level_count++; }
 
+  /// Sets when allocations and returns reach the disk, GROUP by default
+  inline void setDurability(Durability durability) {
+    m_journal.setDurability(durability);
+  }
+
+  [[nodiscard]] inline auto getDurability() const -> Durability {
+    return m_journal.getDurability();
+  }
+
+  /// Sets how getParking picks the slot out of the available ones,
+  /// LOWEST_LEVEL by default. The distance is used by NEAREST_ENTRANCE.
+  inline void setSlotSelection(SlotSelection selection,
+                               SlotDistance distance = nullptr) {
+    m_occupancy.setSlotSelection(selection, std::move(distance));
+  }
+
+  [[nodiscard]] inline auto getSlotSelection() const -> SlotSelection {
+    return m_occupancy.getSlotSelection();
+  }
+
+  /// Applies the Journal to the DB right away instead of waiting for the
+  /// background checkpoint. A Snapshot is written as well when it is due or
+  /// when asked for.
+  void checkpoint(bool snapshot = false);
+
   /// Iterates over all the parking levels and computes available parking slot
   [[nodiscard]] auto getTotalAvailableParking() const -> unsigned;
 
@@ -149,10 +386,122 @@ public:
   /// Tries to get an available parking slot, returns status and slot if able to
   /// allocate
   [[nodiscard]] auto getParking(const VehicleType &vt)
-      -> utils::StatusOr<ParkingSlot>;
+      -> utils::StatusOr<SlotView>;
+
+  /// Tries to get a parking slot for every VehicleType of the range. All the
+  /// requests are resolved under a single acquisition of the OccupancyEngine
+  /// lock and wait for a single Journal sync. The result of every request is
+  /// returned in order.
+  template <typename ForwardIt>
+  [[nodiscard]] auto getParkings(ForwardIt first, ForwardIt last)
+      -> std::vector<utils::StatusOr<SlotView>> {
+    ScopedLatency latency(Histogram::LOT_GET_PARKINGS);
+    std::vector<utils::StatusOr<SlotView>> slots;
+    slots.reserve(std::distance(first, last));
+    uint64_t seq = 0;
+    m_occupancy.allocateBatch(first, last, std::time(nullptr),
+                              std::back_inserter(slots),
+                              [this, &seq](const SlotView &slot) {
+                                seq = recordOccupied(slot);
+                              });
+    m_journal.waitDurable(seq);
+    Metrics::add(Counter::ALLOCATION_FAILURES,
+                 std::count_if(slots.begin(), slots.end(),
+                               [](const auto &slot) { return !slot.isOk(); }));
+    return slots;
+  }
+
+  /// Returns occupied slot to specific parking level and prices the session
+  /// with the current Tariff. Returns UNAVAILABLE status if the slot is
+  /// unknown or not occupied.
+  [[nodiscard]] auto checkout(const SlotKey &key) -> utils::StatusOr<Session>;
+
+  /// Returns occupied slot to specific parking level. Returns false if the
+  /// slot is unknown or not occupied
+  inline auto returnParking(const SlotKey &key) -> bool {
+    return checkout(key).isOk();
+  }
 
-  /// Returns occupied slot to specific parking level
-  void returnParking(const ParkingSlot &vt);
+  /// Returns the slot handed out by getParking
+  inline auto returnParking(const SlotView &slot) -> bool {
+    return returnParking(slot.getSlotKey());
+  }
+
+  /// Returns the slot of every SlotKey of the range, the batch counterpart of
+  /// getParkings. Whether every slot was returned is provided in order.
+  template <typename ForwardIt>
+  auto returnParkings(ForwardIt first, ForwardIt last) -> std::vector<bool> {
+    ScopedLatency latency(Histogram::LOT_RETURN_PARKINGS);
+    std::vector<bool> returned;
+    returned.reserve(std::distance(first, last));
+    std::vector<Session> sessions;
+    sessions.reserve(returned.capacity());
+    uint64_t seq = 0;
+    m_occupancy.releaseBatch(first, last, std::back_inserter(returned),
+                             [this, &seq, &sessions](const SlotView &occupied) {
+                               seq = recordReturned(occupied,
+                                                    sessions.emplace_back());
+                             });
+    for (const auto &session : sessions) {
+      m_sessions.append(session);
+    }
+    m_journal.waitDurable(seq);
+    Metrics::add(Counter::RETURN_FAILURES,
+                 std::count(returned.begin(), returned.end(), false));
+    return returned;
+  }
+
+  /// Holds a slot for the VehicleType until confirm is called with the id of
+  /// the Hold. The slot is made available again if the Hold is cancelled or
+  /// not confirmed within hold_for.
+  [[nodiscard]] auto reserve(const VehicleType &vt,
+                             std::chrono::seconds hold_for)
+      -> utils::StatusOr<Hold>;
+
+  /// Occupies the slot of the Hold, as getParking would. Returns UNAVAILABLE
+  /// status if the Hold is unknown, cancelled or expired.
+  [[nodiscard]] auto confirm(uint64_t hold_id) -> utils::StatusOr<SlotView>;
+
+  /// Drops the Hold and makes its slot available again. Returns false if the
+  /// Hold is unknown, confirmed or expired.
+  auto cancel(uint64_t hold_id) -> bool;
+
+  /// Replaces the Tariff pricing the sessions
+  void setTariff(Tariff tariff);
+
+  [[nodiscard]] auto getTariff() const -> std::shared_ptr<const Tariff>;
+
+  /// Prices the sessions of the SessionLog returned within [from, to) with the
+  /// current Tariff. The log is read chunk_rows sessions at a time and every
+  /// chunk is priced in parallel.
+  auto settle(std::time_t from, std::time_t to,
+              std::size_t chunk_rows = settle_chunk_rows) -> SettledSessions;
+
+  /// Reads the sessions returned within [from, to) out of the SessionLog, at
+  /// most chunk_rows at a time, and calls fn on every chunk. Returns the
+  /// number of sessions read.
+  auto exportSessions(std::time_t from, std::time_t to, std::size_t chunk_rows,
+                      const std::function<void(const SessionChunk &)> &fn)
+      -> std::size_t;
+
+  /// Streams every slot of the lot as JSON or CSV into the sink, in chunks of
+  /// about chunk_bytes. See SlotExporter. Returns the number of slots
+  /// written.
+  auto exportSlots(ExportFormat format, const ExportSink &sink,
+                   std::size_t chunk_bytes = SlotExporter::default_chunk_bytes)
+      -> std::size_t;
+
+  /// Gets held parking at certain level for a specific VehicleType
+  [[nodiscard]] auto getHeldParkingForVehicleTypeAtLevel(
+      unsigned level, const VehicleType &vt) const -> unsigned;
+
+  /// Number of slots held across all levels
+  [[nodiscard]] auto getTotalHeldParking() const -> unsigned;
+
+  /// Subscribes to the occupancy changes caused by getParking and
+  /// returnParking
+  [[nodiscard]] auto subscribeOccupancy()
+      -> std::shared_ptr<OccupancyFeed::Subscription>;
 
   /// Adds a parking slot to the destined parking level given the unique
   /// identifier for the slot. The unique_id is always of the format
@@ -164,10 +513,44 @@ public:
   /// Parking Slot - 3
   void addParking(std::string unique_id);
 
-  /// Given an unique_id of the Parking lot, it provides the specific
-  /// ParkingSlot
-  [[nodiscard]] auto getParkingSlot(std::string unique_id)
-      -> utils::StatusOr<ParkingSlot>;
+  /// Adds all the parking slots of the range of unique_ids in a single
+  /// transaction. Prefer it over addParking when provisioning a lot.
+  template <typename ForwardIt>
+  void addParkingBatch(ForwardIt first, ForwardIt last) {
+    ScopedLatency latency(Histogram::LOT_ADD_PARKING_BATCH);
+    std::lock_guard<std::mutex> lock(m_provision_mutex);
+    invalidateSnapshot();
+    m_occupancy.reserve(m_occupancy.getSlotCount() +
+                        std::distance(first, last));
+    beginTransaction();
+    for (; first != last; ++first) {
+      insertParking(makeParkingSlot(*first));
+    }
+    deleteDrainedSlots();
+    commitTransaction();
+  }
+
+  /// Brings the slots of the parking level to the capacity, numbered in the
+  /// level_zones, in a single transaction. Only the difference is applied:
+  /// the missing slots are added and the others retired, the occupied and
+  /// held ones once they are released. Returns UNAVAILABLE status if the
+  /// level is beyond MAX_PARKING_LEVELS or a capacity reaches
+  /// max_level_capacity.
+  auto reconfigureLevel(unsigned level, const LevelCapacity &capacity)
+      -> utils::StatusOr<LevelChanges>;
+
+  /// Returns if the slot retires once it is released
+  [[nodiscard]] inline auto isDraining(const SlotKey &key) const -> bool {
+    return m_occupancy.isDraining(key);
+  }
+
+  /// Given an unique_id of the Parking lot, it provides a view of the slot
+  [[nodiscard]] auto getParkingSlot(std::string_view unique_id)
+      -> utils::StatusOr<SlotView>;
+
+  /// Given the key of a slot, it provides a view of the slot
+  [[nodiscard]] auto getParkingSlot(const SlotKey &key)
+      -> utils::StatusOr<SlotView>;
 
   // Cleans up all the records without deleting the table for a certain level or
   // all the table.
@@ -175,40 +558,6 @@ public:
 
   virtual ~ParkingLot();
 };
-
-class ParkingIdParser {
-private:
-  enum States { PARKING_ID, PARKING_LEVEL, VEHICLE_TYPE, TOTAL_STATE };
-  inline static ParkingSlot m_parking_slot;
-  const inline static std::array<std::function<void(std::string)>,
-                                 States::TOTAL_STATE>
-      m_state_fptr = {
-          [](std::string unique_id) {
-            m_parking_slot.setParkingSlotId(std::move(unique_id));
-          },
-          [](const std::string &level) {
-            m_parking_slot.setParkingLevel(std::stoi(level));
-          },
-          [](const std::string &vehicle_type) {
-            assert(m_vtstr_vt_map.find(vehicle_type) != m_vtstr_vt_map.end());
-            m_parking_slot.setVehicleType(
-                m_vtstr_vt_map.find(vehicle_type)->second);
-          },
-  };
-
-public:
-  ParkingIdParser() = delete;
-
-  /// Provided with a unique_id string, it creates an available ParkingSlot
-  [[nodiscard]] static auto parse(std::string unique_id) -> ParkingSlot;
-};
-
-/// ParkingSlot creator function from unique_id
-[[nodiscard]] auto makeParkingSlot(std::string unique_id) -> ParkingSlot;
-
-/// Dump routines for component::ParkingSlot
-auto operator<<(std::ostream &os, const component::ParkingSlot &obj)
-    -> std::ostream &;
 } // namespace component
 
 #endif // PARKING_HH
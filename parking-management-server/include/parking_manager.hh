@@ -1,27 +1,133 @@
 #ifndef PARKING_MANAGER_HH
 #define PARKING_MANAGER_HH
 
+#include <chrono>
+#include <string_view>
 #include <vector>
 
+#include "lot_registry.hh"
+#include "metrics.hh"
 #include "parking.hh"
 #include "parking_management.grpc.pb.h"
 #include "parking_management.pb.h"
 
 namespace services {
+/// Records the latency of an RPC handler and counts the RPC in flight
+/// meanwhile
+class RpcMetrics {
+private:
+  component::ScopedLatency m_latency;
+
+public:
+  explicit RpcMetrics(component::Histogram histogram) : m_latency(histogram) {
+    component::Metrics::add(component::Gauge::RPCS_IN_FLIGHT, 1);
+  }
+  RpcMetrics(const RpcMetrics &) = delete;
+  auto operator=(const RpcMetrics &) -> RpcMetrics & = delete;
+
+  ~RpcMetrics() {
+    component::Metrics::add(component::Gauge::RPCS_IN_FLIGHT, -1);
+  }
+};
+
+/// Serves the lots of a LotRegistry, every request naming its lot by lot_id
 class ParkingManagerImpl : public ParkingManager::Service {
 private:
-  component::ParkingLot m_parking_lot;
+  component::LotRegistry m_lots;
 
-  void addParkingSlot(unsigned level, const std::string &vt,
-                      const std::string &zone, unsigned id);
-  void addParkingSlotsForVehicle(unsigned level, const std::string &vt,
-                                 const std::string &zone, unsigned capacity);
+  /// How long WatchOccupancy waits for updates before checking whether the
+  /// client went away
+  static constexpr std::chrono::milliseconds watch_poll_interval{500};
+  /// Sessions per SessionBatch of ExportSessions, by default and at most
+  static constexpr int export_chunk_rows = 4096;
+  static constexpr int max_export_chunk_rows = 65536;
+
+  void addParkingSlotsForVehicle(std::vector<std::string> &unique_ids,
+                                 unsigned level, const std::string &vt,
+                                 std::string_view zone, unsigned capacity);
+
+  /// Fills the Slot message of an allocated or held slot
+  static void fillSlot(::Slot *response, const component::SlotView &slot);
+
+  /// Fills the OccupancyCount of a (parking level, VehicleType) pair
+  static void fillOccupancyCount(::OccupancyCount *count,
+                                 const component::ParkingLot &lot,
+                                 unsigned level,
+                                 const component::VehicleType &vt);
+
+  /// Returns if a VehicleType off the wire names a known vehicle type
+  static inline auto isKnownVehicleType(int vt) -> bool {
+    return vt >= 0 && vt < component::VehicleType::TOTALVEHICLETYPE;
+  }
+
+  /// Status of the requests naming a lot which is not hosted
+  static inline auto unknownLot() -> ::grpc::Status {
+    return {::grpc::StatusCode::NOT_FOUND, "Unknown parking lot"};
+  }
 
 public:
   ParkingManagerImpl() = default;
+  explicit ParkingManagerImpl(
+      component::Durability durability,
+      component::SlotSelection selection =
+          component::SlotSelection::LOWEST_LEVEL,
+      std::shared_ptr<component::ThreadPool> pool =
+          component::ThreadPool::getShared())
+      : m_lots(std::move(pool), durability, selection) {}
+
+  [[nodiscard]] inline auto getLots() -> component::LotRegistry & {
+    return m_lots;
+  }
   ::grpc::Status CreateParkingLot(::grpc::ServerContext *context,
                                   const ::ParkingLotDetails *request,
                                   ::Status *response) override;
+  ::grpc::Status AllocateSlot(::grpc::ServerContext *context,
+                              const ::AllocateRequest *request,
+                              ::Slot *response) override;
+  ::grpc::Status ReleaseSlot(::grpc::ServerContext *context,
+                             const ::ReleaseRequest *request,
+                             ::Status *response) override;
+  ::grpc::Status GetStats(::grpc::ServerContext *context,
+                          const ::StatsRequest *request,
+                          ::Stats *response) override;
+  ::grpc::Status BatchAllocate(::grpc::ServerContext *context,
+                               const ::BatchAllocateRequest *request,
+                               ::BatchAllocateResponse *response) override;
+  ::grpc::Status BatchRelease(::grpc::ServerContext *context,
+                              const ::BatchReleaseRequest *request,
+                              ::BatchReleaseResponse *response) override;
+  ::grpc::Status ReserveSlot(::grpc::ServerContext *context,
+                             const ::ReserveRequest *request,
+                             ::Reservation *response) override;
+  ::grpc::Status ConfirmReservation(::grpc::ServerContext *context,
+                                    const ::ReservationRequest *request,
+                                    ::Slot *response) override;
+  ::grpc::Status CancelReservation(::grpc::ServerContext *context,
+                                   const ::ReservationRequest *request,
+                                   ::Status *response) override;
+  ::grpc::Status Pay(::grpc::ServerContext *context,
+                     const ::PayRequest *request,
+                     ::Receipt *response) override;
+  ::grpc::Status SetTariff(::grpc::ServerContext *context,
+                           const ::TariffTable *request,
+                           ::Status *response) override;
+  ::grpc::Status SettleSessions(::grpc::ServerContext *context,
+                                const ::SettleRequest *request,
+                                ::Settlement *response) override;
+  ::grpc::Status
+  WatchOccupancy(::grpc::ServerContext *context,
+                 const ::WatchRequest *request,
+                 ::grpc::ServerWriter<::OccupancyCount> *writer) override;
+  ::grpc::Status
+  ExportSessions(::grpc::ServerContext *context,
+                 const ::ExportRequest *request,
+                 ::grpc::ServerWriter<::SessionBatch> *writer) override;
+  ::grpc::Status GetMetrics(::grpc::ServerContext *context,
+                            const ::MetricsRequest *request,
+                            ::MetricsReport *response) override;
+  ::grpc::Status ReconfigureLevel(::grpc::ServerContext *context,
+                                  const ::ReconfigureRequest *request,
+                                  ::LevelChanges *response) override;
   virtual ~ParkingManagerImpl() {}
 };
 } // namespace services
@@ -0,0 +1,108 @@
+#ifndef PARKING_SLOT_HH
+#define PARKING_SLOT_HH
+
+#include <cassert>
+#include <ctime>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "slot_key.hh"
+#include "utils.hh"
+#include "vehicle.hh"
+
+namespace component {
+class ParkingSlot {
+private:
+  int m_parking_level{-1};
+  std::string m_parking_slot_id;
+  SlotKey m_slot_key;
+  VehicleType m_vt{VehicleType::TOTALVEHICLETYPE};
+  bool m_occupied{false};
+  std::time_t m_occupied_at;
+
+  /// Derives the slot key from the unique ID
+  inline void setSlotKey(std::string_view id) {
+    auto key = SlotKey::parse(id);
+    m_slot_key = key.isOk() ? key.getData() : SlotKey();
+  }
+
+public:
+  ParkingSlot() = default;
+  ParkingSlot(int level, std::string parking, const VehicleType &vt)
+      : m_parking_level(level), m_parking_slot_id(std::move(parking)),
+        m_vt(vt) {
+    setSlotKey(m_parking_slot_id);
+  }
+
+  /// Creates an available slot out of its key
+  explicit ParkingSlot(const SlotKey &key)
+      : m_parking_level(static_cast<int>(key.getParkingLevel())),
+        m_parking_slot_id(key.toString()), m_slot_key(key),
+        m_vt(key.getVehicleType()) {}
+
+  /// Return parking level for the parking spot
+  [[nodiscard]] inline auto getParkingLevel() const -> int {
+    return m_parking_level;
+  }
+
+  /// Sets parking level for the parking spot
+  inline void setParkingLevel(int level) { m_parking_level = level; }
+
+  /// Returns an unique ID for the parking slot, valid as long as the slot is
+  [[nodiscard]] inline auto getParkingSlotId() const -> std::string_view {
+    return m_parking_slot_id;
+  }
+
+  /// Sets an unique ID for the parking slot
+  inline void setParkingSlotId(std::string id) {
+    m_parking_slot_id = std::move(id);
+    setSlotKey(m_parking_slot_id);
+  }
+
+  /// Returns the packed key of the slot. It is invalid if the unique ID does
+  /// not follow the unique_id format.
+  [[nodiscard]] inline auto getSlotKey() const -> SlotKey { return m_slot_key; }
+
+  /// Returns the type of Vehicle that the parking spot can park
+  [[nodiscard]] inline auto getVehicleType() const -> VehicleType {
+    return m_vt;
+  }
+
+  /// Sets the type of Vehicle that the parking spot can park
+  inline void setVehicleType(const VehicleType &vt) { m_vt = vt; }
+
+  /// Returns if the parking spot is occupied
+  [[nodiscard]] inline auto isOccupied() const -> bool { return m_occupied; }
+
+  /// Marks the parking spot available or occupied
+  inline void setOccupied(bool occupied) { m_occupied = occupied; }
+
+  /// Returns the time at which parking spot was occupied. If the parking spot
+  /// is not occupied, it retuns UNAVAILABLE status
+  [[nodiscard]] inline auto getParkingTime() const
+      -> utils::StatusOr<std::time_t> {
+    if (m_occupied) {
+      return utils::StatusOr<std::time_t>(m_occupied_at);
+    } else {
+      return utils::StatusOr<std::time_t>(utils::Status::UNAVAILABLE);
+    }
+  }
+
+  /// Sets the parking time
+  inline void setParkingTime(const std::time_t &occupied_at) {
+    assert(m_occupied == false);
+    m_occupied = true;
+    m_occupied_at = occupied_at;
+  }
+
+  friend auto operator<<(std::ostream &os, const ParkingSlot &obj)
+      -> std::ostream &;
+};
+
+/// Writes component::ParkingSlot as a single line JSON object
+auto operator<<(std::ostream &os, const component::ParkingSlot &obj)
+    -> std::ostream &;
+} // namespace component
+
+#endif // PARKING_SLOT_HH
@@ -0,0 +1,186 @@
+#ifndef RECORD_FILE_HH
+#define RECORD_FILE_HH
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "utils.hh"
+
+namespace component {
+/// Append-only file of fixed size records, the storage of the Journal and of
+/// the SessionLog. Records are queued in memory and written out together: the
+/// owner moves the queue to the write buffer with takePending() under the
+/// lock guarding the queue, then writes it out with writeTaken() under the
+/// lock serializing the writes only, so that appends never wait on the disk.
+/// RecordFile takes no lock itself.
+template <typename Record> class RecordFile {
+  static_assert(std::is_trivially_copyable_v<Record>,
+                "Records are written out as they are laid out in memory");
+
+private:
+  std::string m_path;
+  int m_fd{-1};
+  /// Records queued since the last takePending()
+  std::vector<Record> m_pending;
+  /// Records being written out, swapped with m_pending so that the queue
+  /// reuses its capacity
+  std::vector<Record> m_writing;
+  /// Records in the file
+  std::size_t m_record_count{0};
+
+public:
+  /// Records both buffers have room for up front
+  static constexpr std::size_t buffer_capacity = 4096;
+
+  RecordFile() {
+    m_pending.reserve(buffer_capacity);
+    m_writing.reserve(buffer_capacity);
+  }
+  RecordFile(const RecordFile &) = delete;
+  auto operator=(const RecordFile &) -> RecordFile & = delete;
+
+  /// Opens the file at the path for appending, keeping its first
+  /// intact_records records. A torn tail is dropped so that new records are
+  /// not appended behind it. The lock serializing the writes must be held.
+  void open(std::string path, std::size_t intact_records) {
+    m_path = std::move(path);
+    m_record_count = intact_records;
+    m_fd = utils::sys_call_and_check(
+        __FILE__, __LINE__,
+        ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+               0644));
+    if (m_fd != -1) {
+      utils::sys_call_and_check(
+          __FILE__, __LINE__,
+          ::ftruncate(m_fd,
+                      static_cast<off_t>(intact_records * sizeof(Record))));
+    }
+  }
+
+  [[nodiscard]] inline auto isOpen() const -> bool { return m_fd != -1; }
+
+  /// Number of records written out to the file
+  [[nodiscard]] inline auto getRecordCount() const -> std::size_t {
+    return m_record_count;
+  }
+
+  /// Queues a record, the lock guarding the queue must be held
+  inline void push(const Record &record) { m_pending.push_back(record); }
+
+  /// Returns if records are queued, the lock guarding the queue must be held
+  [[nodiscard]] inline auto hasPending() const -> bool {
+    return !m_pending.empty();
+  }
+
+  /// Number of records queued, the lock guarding the queue must be held
+  [[nodiscard]] inline auto getPendingCount() const -> std::size_t {
+    return m_pending.size();
+  }
+
+  /// Takes the queued records to be written out by writeTaken(). Both the
+  /// lock guarding the queue and the one serializing the writes must be held.
+  inline void takePending() { m_writing.swap(m_pending); }
+
+  /// Writes out and syncs the records taken by takePending(), the lock
+  /// serializing the writes must be held. Returns the number of records
+  /// written.
+  auto writeTaken() -> std::size_t {
+    std::size_t written = m_writing.size();
+    if (written != 0 && m_fd != -1) {
+      utils::writeAll(m_fd, reinterpret_cast<const char *>(m_writing.data()),
+                      written * sizeof(Record));
+      utils::sys_call_and_check(__FILE__, __LINE__, ::fdatasync(m_fd));
+      m_record_count += written;
+    }
+    // Kept with its capacity for the next write
+    m_writing.clear();
+    return written;
+  }
+
+  /// Moves the file to the path and starts over with an empty one. Returns
+  /// false, without moving anything, if the file holds no records. The lock
+  /// serializing the writes must be held.
+  auto rotate(const std::string &rotated_path) -> bool {
+    if (m_fd == -1 || m_record_count == 0 ||
+        utils::sys_call_and_check(
+            __FILE__, __LINE__,
+            std::rename(m_path.c_str(), rotated_path.c_str())) == -1) {
+      return false;
+    }
+    close();
+    open(m_path, 0);
+    return true;
+  }
+
+  /// Closes the file, the lock serializing the writes must be held
+  void close() {
+    if (m_fd != -1) {
+      utils::sys_call_and_check(__FILE__, __LINE__, ::close(m_fd));
+      m_fd = -1;
+    }
+  }
+
+  /// Number of complete records of the file at the path
+  static auto countRecords(const std::string &path) -> std::size_t {
+    struct stat status {};
+    if (::stat(path.c_str(), &status) == -1) {
+      return 0;
+    }
+    return static_cast<std::size_t>(status.st_size) / sizeof(Record);
+  }
+
+  /// Reads the file at the path chunk_records at a time and calls
+  /// fn(const Record *records, std::size_t count) on the complete records of
+  /// every read, in order, until it returns false. Only a chunk is held in
+  /// memory whatever the size of the file, a torn tail is left behind.
+  template <typename Fn>
+  static void read(const std::string &path, std::size_t chunk_records,
+                   Fn fn) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      return;
+    }
+
+    std::vector<Record> records(chunk_records == 0 ? 1 : chunk_records);
+    std::size_t buffered = 0;
+    while (true) {
+      ssize_t bytes =
+          ::read(fd, reinterpret_cast<char *>(records.data()) + buffered,
+                 records.size() * sizeof(Record) - buffered);
+      if (bytes == -1 && errno == EINTR) {
+        continue;
+      }
+      if (bytes <= 0) {
+        break;
+      }
+      buffered += bytes;
+      std::size_t complete = buffered / sizeof(Record);
+      if (complete != 0 && !fn(records.data(), complete)) {
+        break;
+      }
+      // Keep a partially read record for the next read
+      std::size_t remainder = buffered % sizeof(Record);
+      std::memmove(records.data(),
+                   reinterpret_cast<char *>(records.data()) +
+                       complete * sizeof(Record),
+                   remainder);
+      buffered = remainder;
+    }
+    ::close(fd);
+  }
+
+  virtual ~RecordFile() { close(); }
+};
+} // namespace component
+
+#endif // RECORD_FILE_HH
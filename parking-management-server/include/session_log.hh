@@ -0,0 +1,95 @@
+#ifndef SESSION_LOG_HH
+#define SESSION_LOG_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "billing.hh"
+#include "record_file.hh"
+
+namespace component {
+/// A completed Session as stored in the SessionLog. The parking level and
+/// the VehicleType are part of the slot key.
+struct SessionRecord {
+  uint64_t slot_key{0};
+  int64_t occupied_at{0};
+  int64_t released_at{0};
+  uint64_t fee_cents{0};
+};
+static_assert(sizeof(SessionRecord) == 32, "Session records are 32 bytes");
+
+/// Sessions of a read of the SessionLog, column by column. Every column holds
+/// one entry per session, in the order they were logged.
+struct SessionChunk {
+  std::vector<uint64_t> slot_keys;
+  std::vector<uint8_t> parking_levels;
+  std::vector<uint8_t> vehicle_types;
+  std::vector<int64_t> occupied_at;
+  std::vector<int64_t> released_at;
+  std::vector<uint64_t> fees_cents;
+
+  [[nodiscard]] inline auto size() const -> std::size_t {
+    return slot_keys.size();
+  }
+
+  void clear();
+
+  void reserve(std::size_t rows);
+
+  void push_back(const SessionRecord &record);
+};
+
+/// Append-only log of the completed sessions of a lot, kept for dwell time
+/// and revenue analysis. Sessions are buffered in memory and written out on
+/// flush(), which the checkpoint calls every second, or once the buffer is
+/// full; a crash loses the sessions which were not written out yet.
+class SessionLog {
+private:
+  /// Taken before m_mutex, serializes the writes to the file
+  std::mutex m_file_mutex;
+  std::mutex m_mutex;
+  /// Its writes are guarded by m_file_mutex and its queue by m_mutex
+  RecordFile<SessionRecord> m_file;
+
+public:
+  SessionLog() = default;
+  SessionLog(const SessionLog &) = delete;
+  auto operator=(const SessionLog &) -> SessionLog & = delete;
+
+  /// Opens the log at the path, appending to the sessions already there
+  void open(std::string path);
+
+  [[nodiscard]] inline auto isOpen() const -> bool { return m_file.isOpen(); }
+
+  /// Queues a session until the next flush(). The caller writes out the
+  /// queue once it holds RecordFile::buffer_capacity sessions, so it must not
+  /// hold the locks of the OccupancyEngine.
+  void append(const Session &session);
+
+  /// Writes out and syncs the queued sessions
+  void flush();
+
+  /// Flushes the log and closes it
+  void close();
+
+  /// Reads the sessions of the log at the path released within [from, to),
+  /// at most chunk_rows at a time, and calls fn on every chunk. Only a chunk
+  /// is held in memory whatever the size of the log. Returns the number of
+  /// sessions read.
+  static auto read(const std::string &path, std::size_t chunk_rows,
+                   const std::function<void(const SessionChunk &)> &fn,
+                   std::time_t from = std::numeric_limits<std::time_t>::min(),
+                   std::time_t to = std::numeric_limits<std::time_t>::max())
+      -> std::size_t;
+
+  virtual ~SessionLog();
+};
+} // namespace component
+
+#endif // SESSION_LOG_HH
@@ -0,0 +1,135 @@
+#ifndef SLOT_KEY_HH
+#define SLOT_KEY_HH
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "utils.hh"
+#include "vehicle.hh"
+
+namespace component {
+/// Fields of a parking slot unique_id. The zone refers to the characters of
+/// the parsed unique_id.
+struct ParkingId {
+  unsigned level{0};
+  VehicleType vt{VehicleType::TOTALVEHICLETYPE};
+  std::string_view zone;
+  unsigned number{0};
+};
+
+class ParkingIdParser {
+private:
+  enum States {
+    PARKING_LEVEL,
+    VEHICLE_TYPE,
+    PARKING_ZONE,
+    PARKING_NUMBER,
+    TOTAL_STATE
+  };
+
+  /// Parses a field made only of decimal digits
+  [[nodiscard]] static auto parseNumber(std::string_view field,
+                                        unsigned &number) -> bool;
+
+public:
+  ParkingIdParser() = delete;
+
+  /// Splits a unique_id of the format
+  /// {Parking_Level}_{Vehicle_type}_{Parking_Zone}_{Number} in a single pass
+  /// without allocating. Returns UNAVAILABLE status for malformed ids.
+  [[nodiscard]] static auto parse(std::string_view unique_id)
+      -> utils::StatusOr<ParkingId>;
+};
+
+/// Packed 64 bit key of a parking slot. From the most significant bit it
+/// holds a reserved bit, the parking level, the VehicleType, the parking zone
+/// and the slot number, so keys of a level, VehicleType and zone are
+/// contiguous. Zones are made of up to four digits or upper case letters. The
+/// conversion to and from unique_ids is lossless for unique_ids written
+/// without leading zeros.
+class SlotKey {
+public:
+  static constexpr unsigned NUMBER_BITS = 27;
+  static constexpr unsigned ZONE_BITS = 24;
+  static constexpr unsigned VEHICLE_TYPE_BITS = 4;
+  static constexpr unsigned LEVEL_BITS = 8;
+  static constexpr unsigned MAX_ZONE_LENGTH = 4;
+
+private:
+  static constexpr unsigned ZONE_SHIFT = NUMBER_BITS;
+  static constexpr unsigned VEHICLE_TYPE_SHIFT = ZONE_SHIFT + ZONE_BITS;
+  static constexpr unsigned LEVEL_SHIFT =
+      VEHICLE_TYPE_SHIFT + VEHICLE_TYPE_BITS;
+  static_assert(LEVEL_SHIFT + LEVEL_BITS < 64,
+                "The sign bit must stay clear to fit a sqlite integer");
+
+  /// Zone characters are encoded in base 37, 0 being the padding
+  static constexpr unsigned ZONE_RADIX = 37;
+
+  /// Keys have the reserved bit clear, so this never collides with a slot
+  static constexpr uint64_t INVALID_KEY = ~uint64_t{0};
+
+  uint64_t m_key{INVALID_KEY};
+
+  [[nodiscard]] constexpr auto field(unsigned shift, unsigned bits) const
+      -> unsigned {
+    return static_cast<unsigned>((m_key >> shift) & ((uint64_t{1} << bits) - 1));
+  }
+
+public:
+  constexpr SlotKey() = default;
+  constexpr explicit SlotKey(uint64_t key) : m_key(key) {}
+
+  /// Packs the fields of a slot. Returns UNAVAILABLE status if any of the
+  /// fields does not fit the key.
+  [[nodiscard]] static auto make(unsigned level, const VehicleType &vt,
+                                 std::string_view zone, unsigned number)
+      -> utils::StatusOr<SlotKey>;
+
+  /// Parses a unique_id into its key
+  [[nodiscard]] static auto parse(std::string_view unique_id)
+      -> utils::StatusOr<SlotKey>;
+
+  /// Returns if the key refers to a slot
+  [[nodiscard]] constexpr auto isValid() const -> bool {
+    return m_key != INVALID_KEY;
+  }
+
+  /// Returns the packed value of the key
+  [[nodiscard]] constexpr auto getValue() const -> uint64_t { return m_key; }
+
+  [[nodiscard]] constexpr auto getParkingLevel() const -> unsigned {
+    return field(LEVEL_SHIFT, LEVEL_BITS);
+  }
+
+  [[nodiscard]] constexpr auto getVehicleType() const -> VehicleType {
+    return static_cast<VehicleType>(
+        field(VEHICLE_TYPE_SHIFT, VEHICLE_TYPE_BITS));
+  }
+
+  [[nodiscard]] constexpr auto getNumber() const -> unsigned {
+    return field(0, NUMBER_BITS);
+  }
+
+  /// Returns the parking zone
+  [[nodiscard]] auto getZone() const -> std::string;
+
+  /// Returns the unique_id of the slot, 2_CA_A_3 for instance
+  [[nodiscard]] auto toString() const -> std::string;
+
+  constexpr auto operator==(const SlotKey &other) const -> bool {
+    return m_key == other.m_key;
+  }
+
+  constexpr auto operator!=(const SlotKey &other) const -> bool {
+    return m_key != other.m_key;
+  }
+
+  constexpr auto operator<(const SlotKey &other) const -> bool {
+    return m_key < other.m_key;
+  }
+};
+} // namespace component
+
+#endif // SLOT_KEY_HH
@@ -0,0 +1,189 @@
+#ifndef SLOT_TABLE_HH
+#define SLOT_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "slot_key.hh"
+#include "utils.hh"
+#include "vehicle.hh"
+
+namespace component {
+/// State of a slot. A held slot is kept for a reservation, it is neither
+/// available nor occupied until the reservation is confirmed or dropped. A
+/// retired slot was taken out of the lot, its row is kept until the slot is
+/// added back.
+enum SlotState : uint8_t {
+  AVAILABLE,
+  OCCUPIED,
+  HELD,
+  RETIRED,
+  TOTAL_SLOT_STATE
+};
+
+/// Copy of a row of the SlotTable. It is trivially copyable and holds no
+/// string, the unique_id is formatted out of the key only when asked for.
+class SlotView {
+private:
+  SlotKey m_slot_key;
+  SlotState m_state{SlotState::AVAILABLE};
+  std::time_t m_occupied_at{0};
+
+public:
+  SlotView() = default;
+  SlotView(const SlotKey &key, SlotState state, std::time_t occupied_at)
+      : m_slot_key(key), m_state(state), m_occupied_at(occupied_at) {}
+
+  [[nodiscard]] inline auto getSlotKey() const -> SlotKey { return m_slot_key; }
+
+  [[nodiscard]] inline auto getParkingLevel() const -> int {
+    return static_cast<int>(m_slot_key.getParkingLevel());
+  }
+
+  [[nodiscard]] inline auto getVehicleType() const -> VehicleType {
+    return m_slot_key.getVehicleType();
+  }
+
+  /// Returns the unique_id of the slot, 2_CA_A_3 for instance
+  [[nodiscard]] inline auto getParkingSlotId() const -> std::string {
+    return m_slot_key.toString();
+  }
+
+  [[nodiscard]] inline auto getState() const -> SlotState { return m_state; }
+
+  [[nodiscard]] inline auto isOccupied() const -> bool {
+    return m_state == SlotState::OCCUPIED;
+  }
+
+  [[nodiscard]] inline auto isHeld() const -> bool {
+    return m_state == SlotState::HELD;
+  }
+
+  /// Returns the time at which the slot was occupied, UNAVAILABLE status if
+  /// it is not occupied
+  [[nodiscard]] inline auto getParkingTime() const
+      -> utils::StatusOr<std::time_t> {
+    if (isOccupied()) {
+      return utils::StatusOr<std::time_t>(m_occupied_at);
+    }
+    return utils::StatusOr<std::time_t>(utils::Status::UNAVAILABLE);
+  }
+};
+
+/// Slots stored column by column: every field lives in its own contiguous
+/// array indexed by the row of the slot, so a pass over the slots only loads
+/// the columns it reads. Rows are only ever appended, the table is not
+/// thread safe.
+class SlotTable {
+private:
+  std::vector<uint64_t> m_keys;
+  std::vector<uint8_t> m_levels;
+  std::vector<uint8_t> m_vehicle_types;
+  std::vector<SlotState> m_states;
+  /// Zero for the rows which are not occupied
+  std::vector<std::time_t> m_occupied_at;
+
+public:
+  SlotTable() = default;
+
+  [[nodiscard]] inline auto size() const -> std::size_t {
+    return m_keys.size();
+  }
+
+  /// Makes room for the given number of rows
+  void reserve(std::size_t rows);
+
+  /// Drops all the rows
+  void clear();
+
+  /// Appends a row, returns its index
+  auto append(const SlotKey &key, bool occupied, std::time_t occupied_at)
+      -> std::size_t;
+
+  /// Marks the row occupied since the given time
+  inline void occupy(std::size_t row, std::time_t occupied_at) {
+    m_states[row] = SlotState::OCCUPIED;
+    m_occupied_at[row] = occupied_at;
+  }
+
+  /// Marks the row held for a reservation
+  inline void hold(std::size_t row) {
+    m_states[row] = SlotState::HELD;
+    m_occupied_at[row] = 0;
+  }
+
+  /// Marks the row available
+  inline void release(std::size_t row) {
+    m_states[row] = SlotState::AVAILABLE;
+    m_occupied_at[row] = 0;
+  }
+
+  /// Marks the row retired
+  inline void retire(std::size_t row) {
+    m_states[row] = SlotState::RETIRED;
+    m_occupied_at[row] = 0;
+  }
+
+  [[nodiscard]] inline auto getSlotKey(std::size_t row) const -> SlotKey {
+    return SlotKey(m_keys[row]);
+  }
+
+  [[nodiscard]] inline auto getParkingLevel(std::size_t row) const
+      -> unsigned {
+    return m_levels[row];
+  }
+
+  [[nodiscard]] inline auto getVehicleType(std::size_t row) const
+      -> VehicleType {
+    return static_cast<VehicleType>(m_vehicle_types[row]);
+  }
+
+  [[nodiscard]] inline auto getState(std::size_t row) const -> SlotState {
+    return m_states[row];
+  }
+
+  [[nodiscard]] inline auto isOccupied(std::size_t row) const -> bool {
+    return m_states[row] == SlotState::OCCUPIED;
+  }
+
+  [[nodiscard]] inline auto getOccupiedAt(std::size_t row) const
+      -> std::time_t {
+    return m_occupied_at[row];
+  }
+
+  /// Copies the row out
+  [[nodiscard]] inline auto getView(std::size_t row) const -> SlotView {
+    return SlotView(getSlotKey(row), getState(row), getOccupiedAt(row));
+  }
+
+  /// Whole columns, for the passes over all the slots
+  [[nodiscard]] inline auto getKeys() const -> const std::vector<uint64_t> & {
+    return m_keys;
+  }
+
+  [[nodiscard]] inline auto getParkingLevels() const
+      -> const std::vector<uint8_t> & {
+    return m_levels;
+  }
+
+  [[nodiscard]] inline auto getVehicleTypes() const
+      -> const std::vector<uint8_t> & {
+    return m_vehicle_types;
+  }
+
+  [[nodiscard]] inline auto getStates() const
+      -> const std::vector<SlotState> & {
+    return m_states;
+  }
+
+  [[nodiscard]] inline auto getOccupiedAt() const
+      -> const std::vector<std::time_t> & {
+    return m_occupied_at;
+  }
+};
+} // namespace component
+
+#endif // SLOT_TABLE_HH
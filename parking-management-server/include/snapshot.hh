@@ -0,0 +1,90 @@
+#ifndef SNAPSHOT_HH
+#define SNAPSHOT_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+#include "occupancy.hh"
+
+namespace component {
+/// Header of a snapshot file. It is followed by three sections, each 8 byte
+/// aligned and located by its offset from the start of the file:
+///  - the SlotKey value of every slot, uint64_t each
+///  - the occupancy bitmap, one bit per slot in uint64_t words
+///  - the occupied_at timestamp of every slot, int64_t each
+/// All the values are stored in the byte order of the host.
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t slot_count;
+  uint64_t keys_offset;
+  uint64_t occupancy_offset;
+  uint64_t occupied_at_offset;
+  uint64_t file_size;
+};
+
+/// Read only view of a snapshot of the OccupancyEngine, mapped in memory. The
+/// sections are used in place, nothing is parsed or copied.
+class Snapshot {
+private:
+  const char *m_data{nullptr};
+  std::size_t m_size{0};
+  const SnapshotHeader *m_header{nullptr};
+  const uint64_t *m_keys{nullptr};
+  const uint64_t *m_occupancy{nullptr};
+  const int64_t *m_occupied_at{nullptr};
+
+  /// Checks the header against the mapped size, the view is valid only then
+  [[nodiscard]] auto validate() const -> bool;
+
+public:
+  static constexpr char MAGIC[8] = {'P', 'K', 'S', 'N', 'A', 'P', '\0', '\0'};
+  /// Bumped on every change of the layout, older snapshots are ignored
+  static constexpr uint32_t VERSION = 1;
+
+  /// Maps the snapshot at the path. The view is invalid if the file is
+  /// missing, truncated or of another version.
+  explicit Snapshot(const std::string &path);
+  Snapshot(const Snapshot &) = delete;
+  auto operator=(const Snapshot &) -> Snapshot & = delete;
+
+  [[nodiscard]] inline auto isValid() const -> bool {
+    return m_header != nullptr;
+  }
+
+  [[nodiscard]] inline auto getSlotCount() const -> std::size_t {
+    return m_header->slot_count;
+  }
+
+  [[nodiscard]] inline auto getSlotKey(std::size_t index) const -> SlotKey {
+    return SlotKey(m_keys[index]);
+  }
+
+  [[nodiscard]] inline auto isOccupied(std::size_t index) const -> bool {
+    return (m_occupancy[index / 64] >> (index % 64)) & 1U;
+  }
+
+  [[nodiscard]] inline auto getOccupiedAt(std::size_t index) const
+      -> std::time_t {
+    return m_occupied_at[index];
+  }
+
+  /// Mapped sections, for OccupancyEngine::load
+  [[nodiscard]] inline auto getColumns() const -> SlotColumns {
+    return SlotColumns{getSlotCount(), m_keys, m_occupancy, m_occupied_at};
+  }
+
+  /// Writes a snapshot of all the slots of the engine to the path. The file
+  /// is written aside, synced and renamed over the path, so the path holds
+  /// either the previous or the new snapshot. Returns false on failure.
+  static auto write(const std::string &path, const OccupancyEngine &engine)
+      -> bool;
+
+  virtual ~Snapshot();
+};
+} // namespace component
+
+#endif // SNAPSHOT_HH
@@ -0,0 +1,91 @@
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace component {
+/// Fixed set of worker threads shared by the parking lots of a process. It
+/// runs one-off tasks, periodic tasks such as the checkpoints of the lots,
+/// and parallel loops. A periodic task never overlaps itself, its next run is
+/// due one interval after the previous one finished.
+class ThreadPool {
+public:
+  using TaskId = uint64_t;
+  static constexpr TaskId INVALID_TASK = 0;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct PeriodicTask {
+    Clock::duration interval;
+    std::function<void()> fn;
+    bool running{false};
+    bool cancelled{false};
+  };
+
+  /// Next run of a periodic task, ordered soonest first
+  using Due = std::pair<Clock::time_point, TaskId>;
+
+  std::mutex m_mutex;
+  std::condition_variable m_work_cv;
+  /// Signalled whenever a periodic task finishes a run
+  std::condition_variable m_idle_cv;
+  std::deque<std::function<void()>> m_tasks;
+  std::unordered_map<TaskId, PeriodicTask> m_periodic;
+  std::priority_queue<Due, std::vector<Due>, std::greater<>> m_due;
+  TaskId m_next_task{INVALID_TASK};
+  bool m_stop{false};
+  std::vector<std::thread> m_workers;
+
+  /// Worker loop
+  void work();
+
+public:
+  /// Starts the workers, at least one
+  explicit ThreadPool(unsigned threads);
+  ThreadPool(const ThreadPool &) = delete;
+  auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+
+  [[nodiscard]] inline auto size() const -> std::size_t {
+    return m_workers.size();
+  }
+
+  /// Queues a task
+  void submit(std::function<void()> task);
+
+  /// Runs the task every interval, the first time one interval from now
+  auto scheduleEvery(Clock::duration interval, std::function<void()> task)
+      -> TaskId;
+
+  /// Stops a periodic task, waiting for the run in progress if any. Must not
+  /// be called from the task itself.
+  void cancel(TaskId id);
+
+  /// Calls fn with every index of [0, count) on the workers and the calling
+  /// thread, returns once all the calls returned. The calling thread takes
+  /// part, so it completes even when every worker is busy.
+  void parallelFor(std::size_t count,
+                   const std::function<void(std::size_t)> &fn);
+
+  /// Pool shared by the lots which are not given one, with a worker per core
+  /// and at least two
+  [[nodiscard]] static auto getShared() -> std::shared_ptr<ThreadPool>;
+
+  /// Stops the workers once the queued tasks ran, periodic tasks are dropped
+  virtual ~ThreadPool();
+};
+} // namespace component
+
+#endif // THREAD_POOL_HH
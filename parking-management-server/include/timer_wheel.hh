@@ -0,0 +1,109 @@
+#ifndef TIMER_WHEEL_HH
+#define TIMER_WHEEL_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace component {
+/// Hierarchical timer wheel over an abstract tick count. Each of the LEVELS
+/// wheels has SLOTS buckets, a bucket of level L spanning SLOTS^L ticks. A
+/// timer is filed in the lowest level whose span covers its deadline and
+/// cascades one level down every time the wheel reaches its bucket, so
+/// scheduling and cancelling are O(1) and every tick only looks at the
+/// buckets it reaches. Deadlines beyond the span of the top level wait in the
+/// top bucket reached when the wheel wraps around and are filed again there.
+///
+/// The wheel is not thread safe.
+class TimerWheel {
+public:
+  using TimerId = uint32_t;
+  static constexpr TimerId INVALID_TIMER = std::numeric_limits<TimerId>::max();
+
+private:
+  static constexpr unsigned SLOT_BITS = 6;
+  static constexpr unsigned SLOTS = 1U << SLOT_BITS;
+  static constexpr unsigned LEVELS = 4;
+  static constexpr uint32_t NIL = INVALID_TIMER;
+
+  /// Timers live in a pool and are linked into their bucket by index
+  struct Timer {
+    uint64_t deadline{0};
+    uint64_t payload{0};
+    uint32_t prev{NIL};
+    uint32_t next{NIL};
+    /// Bucket the timer is linked into, level * SLOTS + slot
+    uint32_t bucket{NIL};
+  };
+
+  std::vector<Timer> m_timers;
+  std::vector<TimerId> m_free_timers;
+  std::array<uint32_t, LEVELS * SLOTS> m_buckets{};
+  uint64_t m_now{0};
+  std::size_t m_size{0};
+
+  /// Links the timer into the bucket of its deadline
+  void file(TimerId id);
+
+  /// Unlinks the timer from its bucket
+  void unlink(TimerId id);
+
+  /// Detaches the whole bucket, returns its first timer
+  auto takeBucket(uint32_t bucket) -> uint32_t;
+
+public:
+  explicit TimerWheel(uint64_t now = 0);
+
+  /// Current tick
+  [[nodiscard]] inline auto getNow() const -> uint64_t { return m_now; }
+
+  /// Number of scheduled timers
+  [[nodiscard]] inline auto size() const -> std::size_t { return m_size; }
+
+  /// Schedules a timer carrying the payload. A deadline which is not ahead of
+  /// the current tick fires on the next one.
+  auto schedule(uint64_t deadline, uint64_t payload) -> TimerId;
+
+  /// Cancels a scheduled timer. Returns false if it already fired. The id of
+  /// a timer is reused once it fired or was cancelled.
+  auto cancel(TimerId id) -> bool;
+
+  /// Moves the wheel up to the tick, calling fn with the payload of every
+  /// timer due on the way, in tick order. fn must not use the wheel.
+  template <typename Fn> void advance(uint64_t now, Fn fn) {
+    while (m_now < now) {
+      m_now++;
+      // Cascade the buckets reached on the upper levels, highest first so
+      // that their timers go on cascading down
+      for (unsigned level = LEVELS - 1; level > 0; level--) {
+        if ((m_now & ((uint64_t{1} << (level * SLOT_BITS)) - 1)) != 0) {
+          continue;
+        }
+        uint32_t bucket = level * SLOTS + ((m_now >> (level * SLOT_BITS)) &
+                                           (SLOTS - 1));
+        for (uint32_t id = takeBucket(bucket); id != NIL;) {
+          uint32_t next = m_timers[id].next;
+          file(id);
+          id = next;
+        }
+      }
+
+      // Every timer of the level 0 bucket of the tick is due
+      for (uint32_t id = takeBucket(m_now & (SLOTS - 1)); id != NIL;) {
+        Timer &timer = m_timers[id];
+        uint32_t next = timer.next;
+        uint64_t payload = timer.payload;
+        timer.bucket = NIL;
+        m_free_timers.push_back(id);
+        m_size--;
+        fn(payload);
+        id = next;
+      }
+    }
+  }
+};
+} // namespace component
+
+#endif // TIMER_WHEEL_HH
@@ -1,95 +1,98 @@
 #ifndef UTILS_HH
 #define UTILS_HH
 
+#include <unistd.h>
+
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <string_view>
+#include <utility>
 
-#define PRINT_CONTAINER_START()                                                \
-  utils::Dumper::printTabs();                                                  \
-  os << "{" << std::endl;                                                      \
-  utils::Dumper::addTabSpaces(1)
-
-#define PRINT_FIELD(fieldprint, field)                                         \
-  utils::Dumper::printTabs();                                                  \
-  os << (fieldprint) << (field) << "," << std::endl
-
-#define PRINT_CONTAINER_END()                                                  \
-  utils::Dumper::subTabSpaces(1);                                              \
-  utils::Dumper::printTabs();                                                  \
-  os << "}"
-
-#define PRINT_CONTAINER_ENDL()                                                 \
-  utils::Dumper::subTabSpaces(1);                                              \
-  utils::Dumper::printTabs();                                                  \
-  os << "}," << std::endl
 namespace utils {
 enum Status { UNAVAILABLE, OK, STATUS_COUNT };
 
+/// Reports a failed system call along with its errno, passes the result on
+inline auto sys_call_and_check = [](std::string_view filename, int lineno,
+                                    auto result) {
+  if (result == -1) {
+    std::cerr << filename.data() << "@" << lineno << " : " << errno << "="
+              << std::strerror(errno) << std::endl;
+  }
+  return result;
+};
+
+/// Writes the whole buffer to the file descriptor, retrying on partial writes
+inline void writeAll(int fd, const char *data, std::size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written == -1 && errno == EINTR) {
+      continue;
+    }
+    if (sys_call_and_check(__FILE__, __LINE__, written) == -1) {
+      return;
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+/// Either a value or the Status telling why there is none. The value is
+/// moved in and out rather than copied whenever the caller allows it.
 template <typename T> class StatusOr {
 private:
   Status m_status{Status::UNAVAILABLE};
-  T m_data;
+  T m_data{};
 
 public:
   StatusOr() = default;
   explicit StatusOr(Status status) : m_status(status) {}
   explicit StatusOr(const T &data) : m_status(Status::OK), m_data(data) {}
+  explicit StatusOr(T &&data) : m_status(Status::OK), m_data(std::move(data)) {}
+
   [[nodiscard]] inline auto isOk() const -> bool {
     return m_status == Status::OK;
   }
-  [[nodiscard]] inline auto getData() const -> T {
+
+  [[nodiscard]] inline auto getStatus() const -> Status { return m_status; }
+
+  [[nodiscard]] inline auto getData() const & -> const T & {
     assert(isOk());
     return m_data;
   }
-  void setData(const T &data) {
-    m_status = Status::OK;
-    m_data = data;
-  }
-};
 
-class Dumper {
-private:
-  inline static unsigned m_tab_space{0};
-  inline static int m_dumper_count{0};
-  std::streambuf *m_backup{nullptr};
-
-public:
-  Dumper() = default;
-  explicit Dumper(const std::ios &stream = std::cout) {
-    assert(m_dumper_count == 0);
-    m_backup = std::cout.rdbuf();
-    std::cout.rdbuf(stream.rdbuf());
-    m_dumper_count++;
+  [[nodiscard]] inline auto getData() & -> T & {
+    assert(isOk());
+    return m_data;
   }
 
-  /// Adds tab spaces
-  static inline void addTabSpaces(unsigned tabs = 1) {
-    assert(m_tab_space >= 0);
-    m_tab_space += tabs;
+  /// Moves the value out of a temporary
+  [[nodiscard]] inline auto getData() && -> T {
+    assert(isOk());
+    return std::move(m_data);
   }
 
-  /// Subtracts tab spaces
-  static inline void subTabSpaces(unsigned tabs = 1) {
-    m_tab_space -= tabs;
-    assert(m_tab_space >= 0);
+  /// Provides the value, or the fallback if there is none
+  template <typename U>
+  [[nodiscard]] inline auto valueOr(U &&fallback) const & -> T {
+    return isOk() ? m_data : static_cast<T>(std::forward<U>(fallback));
   }
 
-  /// Get Tab Spaces
-  [[nodiscard]] static auto getTabSpaces(void) -> unsigned {
-    return m_tab_space;
+  template <typename U>
+  [[nodiscard]] inline auto valueOr(U &&fallback) && -> T {
+    return isOk() ? std::move(m_data)
+                  : static_cast<T>(std::forward<U>(fallback));
   }
 
-  /// Print tabs to the desired out stream
-  static void printTabs() {
-    for (unsigned i = 0; i < m_tab_space; i++) {
-      std::cout << "\t";
-    }
+  void setData(const T &data) {
+    m_status = Status::OK;
+    m_data = data;
   }
 
-  virtual ~Dumper() {
-    m_dumper_count--;
-    m_tab_space = 0;
-    std::cout.rdbuf(m_backup);
+  void setData(T &&data) {
+    m_status = Status::OK;
+    m_data = std::move(data);
   }
 };
 } // namespace utils
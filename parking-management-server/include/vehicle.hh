@@ -4,11 +4,35 @@
 #include <array>
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 namespace component {
 enum VehicleType { MINIVAN, CAR, MOTORCYCLE, CYCLE, TOTALVEHICLETYPE };
 extern std::array<std::string, TOTALVEHICLETYPE> m_vt_vtstr;
 
 extern std::map<std::string, VehicleType> m_vtstr_vt_map;
+
+/// Vehicle codes and names along with the VehicleType they stand for
+constexpr std::array<std::pair<std::string_view, VehicleType>, 8>
+    vehicle_codes = {{{"MV", VehicleType::MINIVAN},
+                      {"CA", VehicleType::CAR},
+                      {"MC", VehicleType::MOTORCYCLE},
+                      {"CY", VehicleType::CYCLE},
+                      {"MINIVAN", VehicleType::MINIVAN},
+                      {"CAR", VehicleType::CAR},
+                      {"MOTORCYCLE", VehicleType::MOTORCYCLE},
+                      {"CYCLE", VehicleType::CYCLE}}};
+
+/// Provides the VehicleType for a vehicle code or name. Unknown codes map to
+/// TOTALVEHICLETYPE
+constexpr auto toVehicleType(std::string_view code) -> VehicleType {
+  for (const auto &vehicle_code : vehicle_codes) {
+    if (vehicle_code.first == code) {
+      return vehicle_code.second;
+    }
+  }
+  return VehicleType::TOTALVEHICLETYPE;
+}
 } // namespace component
 
 #endif // VEHICLE_HH
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "parking_management.grpc.pb.h"
+#include "parking_management.pb.h"
+#include <grpcpp/channel.h>
+#include <grpcpp/client_context.h>
+#include <grpcpp/create_channel.h>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+/// Load generator options read from the command line
+struct LoadOptions {
+  std::string server_address{"localhost:50051"};
+  std::string lot_id{"LoadGenerator"};
+  /// Clients, each with a single request in flight
+  unsigned clients{8};
+  /// Channels the clients are spread over, every channel is a connection
+  unsigned channels{1};
+  /// Car slots the lot is provisioned with
+  unsigned slots{10000};
+  /// Cycles between two GetStats of a client, zero for none
+  unsigned stats_every{0};
+  std::chrono::seconds warmup{1};
+  std::chrono::seconds duration{10};
+};
+
+/// RPCs the clients measure
+enum Operation { ALLOCATE, RELEASE, STATS, OPERATION_COUNT };
+
+const std::array<const char *, OPERATION_COUNT> operation_names = {
+    "AllocateSlot", "ReleaseSlot", "GetStats"};
+
+/// Latencies, in nanoseconds, and failures of the RPCs of a client
+struct ClientResults {
+  std::array<std::vector<uint64_t>, OPERATION_COUNT> latencies;
+  std::array<uint64_t, OPERATION_COUNT> failures{};
+};
+
+void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--address=HOST:PORT] [--lot=NAME] [--clients=N]"
+               " [--channels=N] [--slots=N] [--stats-every=N]"
+               " [--warmup=SECONDS] [--duration=SECONDS]"
+            << std::endl;
+}
+
+/// Parses the unsigned value of a flag, returns false if it is malformed or
+/// below the minimum
+auto parseUnsigned(std::string_view value, unsigned minimum, unsigned &result)
+    -> bool {
+  try {
+    long parsed = std::stol(std::string(value));
+    if (parsed < static_cast<long>(minimum)) {
+      return false;
+    }
+    result = static_cast<unsigned>(parsed);
+    return true;
+  } catch (const std::exception &) {
+    return false;
+  }
+}
+
+/// Parses the command line, returns false on an unknown or malformed option
+auto parseOptions(int argc, char **argv, LoadOptions &options) -> bool {
+  constexpr std::string_view address_flag = "--address=";
+  constexpr std::string_view lot_flag = "--lot=";
+  constexpr std::string_view clients_flag = "--clients=";
+  constexpr std::string_view channels_flag = "--channels=";
+  constexpr std::string_view slots_flag = "--slots=";
+  constexpr std::string_view stats_every_flag = "--stats-every=";
+  constexpr std::string_view warmup_flag = "--warmup=";
+  constexpr std::string_view duration_flag = "--duration=";
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    auto matches = [&arg](std::string_view flag) {
+      return arg.substr(0, flag.size()) == flag;
+    };
+    unsigned seconds = 0;
+    bool parsed = true;
+    if (matches(address_flag)) {
+      options.server_address = arg.substr(address_flag.size());
+    } else if (matches(lot_flag)) {
+      options.lot_id = arg.substr(lot_flag.size());
+    } else if (matches(clients_flag)) {
+      parsed =
+          parseUnsigned(arg.substr(clients_flag.size()), 1, options.clients);
+    } else if (matches(channels_flag)) {
+      parsed =
+          parseUnsigned(arg.substr(channels_flag.size()), 1, options.channels);
+    } else if (matches(slots_flag)) {
+      parsed = parseUnsigned(arg.substr(slots_flag.size()), 1, options.slots);
+    } else if (matches(stats_every_flag)) {
+      parsed = parseUnsigned(arg.substr(stats_every_flag.size()), 0,
+                             options.stats_every);
+    } else if (matches(warmup_flag)) {
+      parsed = parseUnsigned(arg.substr(warmup_flag.size()), 0, seconds);
+      options.warmup = std::chrono::seconds(seconds);
+    } else if (matches(duration_flag)) {
+      parsed = parseUnsigned(arg.substr(duration_flag.size()), 1, seconds);
+      options.duration = std::chrono::seconds(seconds);
+    } else {
+      return false;
+    }
+    if (!parsed) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Opens the lot on the server with the requested car slots on a single
+/// level. Slots the lot already has are kept.
+auto createLot(ParkingManager::Stub &stub, const LoadOptions &options)
+    -> grpc::Status {
+  ParkingLotDetails details;
+  details.set_name(options.lot_id);
+  details.set_levels(1);
+  details.add_level_vehicle_capacity()->set_car_capacity(options.slots);
+
+  ::Status response;
+  grpc::ClientContext context;
+  return stub.CreateParkingLot(&context, details, &response);
+}
+
+/// Runs the closed loop of a client: allocate a car slot, release it, and
+/// every stats_every cycles query the stats, each RPC waiting for the previous
+/// one. Only the RPCs started within [measure_from, measure_to) are recorded.
+void runClient(ParkingManager::Stub &stub, const LoadOptions &options,
+               Clock::time_point measure_from, Clock::time_point measure_to,
+               ClientResults &results) {
+  AllocateRequest allocate;
+  allocate.set_lot_id(options.lot_id);
+  allocate.set_vehicle_type(VehicleType::CAR);
+  ReleaseRequest release;
+  release.set_lot_id(options.lot_id);
+  StatsRequest stats;
+  stats.set_lot_id(options.lot_id);
+
+  auto measure = [&](Operation operation, auto &&call) {
+    auto start = Clock::now();
+    grpc::ClientContext context;
+    bool ok = call(context).ok();
+    auto end = Clock::now();
+    if (start < measure_from) {
+      return ok;
+    }
+    if (!ok) {
+      results.failures[operation]++;
+    }
+    results.latencies[operation].push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count());
+    return ok;
+  };
+
+  Slot slot;
+  ::Status released;
+  Stats counts;
+  for (uint64_t cycle = 1; Clock::now() < measure_to; cycle++) {
+    bool allocated = measure(ALLOCATE, [&](grpc::ClientContext &context) {
+      return stub.AllocateSlot(&context, allocate, &slot);
+    });
+    if (allocated) {
+      release.set_parking_id(slot.parking_id());
+      measure(RELEASE, [&](grpc::ClientContext &context) {
+        return stub.ReleaseSlot(&context, release, &released);
+      });
+    }
+    if (options.stats_every > 0 && cycle % options.stats_every == 0) {
+      measure(STATS, [&](grpc::ClientContext &context) {
+        return stub.GetStats(&context, stats, &counts);
+      });
+    }
+  }
+}
+
+/// Latency of the quantile of sorted latencies, in microseconds
+auto quantile(const std::vector<uint64_t> &sorted, double q) -> double {
+  if (sorted.empty()) {
+    return 0;
+  }
+  // Nearest rank: the smallest latency at least q of the requests stay within
+  auto rank = static_cast<std::size_t>(
+      std::ceil(q * static_cast<double>(sorted.size())));
+  return static_cast<double>(sorted[std::max<std::size_t>(rank, 1) - 1]) / 1e3;
+}
+
+/// Prints the throughput and the latency distribution of every operation
+void report(std::vector<ClientResults> &results, const LoadOptions &options) {
+  auto seconds = std::chrono::duration<double>(options.duration).count();
+  std::cout << std::left << std::setw(14) << "operation" << std::right
+            << std::setw(10) << "requests" << std::setw(9) << "failed"
+            << std::setw(12) << "req/s" << std::setw(11) << "p50 us"
+            << std::setw(11) << "p99 us" << std::setw(11) << "p999 us"
+            << std::setw(11) << "max us" << std::endl;
+
+  uint64_t total = 0;
+  for (unsigned operation = 0; operation < OPERATION_COUNT; operation++) {
+    std::vector<uint64_t> latencies;
+    uint64_t failures = 0;
+    for (auto &client : results) {
+      latencies.insert(latencies.end(), client.latencies[operation].begin(),
+                       client.latencies[operation].end());
+      failures += client.failures[operation];
+    }
+    if (latencies.empty()) {
+      continue;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    total += latencies.size();
+    auto throughput = static_cast<double>(latencies.size()) / seconds;
+    std::cout << std::left << std::setw(14) << operation_names[operation]
+              << std::right << std::setw(10) << latencies.size()
+              << std::setw(9) << failures << std::fixed << std::setprecision(0)
+              << std::setw(12) << throughput << std::setprecision(1)
+              << std::setw(11) << quantile(latencies, 0.5) << std::setw(11)
+              << quantile(latencies, 0.99) << std::setw(11)
+              << quantile(latencies, 0.999) << std::setw(11)
+              << static_cast<double>(latencies.back()) / 1e3 << std::endl;
+  }
+  std::cout << std::setprecision(0) << "Total " << total << " requests, "
+            << static_cast<double>(total) / seconds << " req/s with "
+            << options.clients << " clients" << std::endl;
+}
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  LoadOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<ParkingManager::Stub>> stubs;
+  for (unsigned i = 0; i < options.channels; i++) {
+    // Distinct channel arguments keep gRPC from sharing one connection
+    grpc::ChannelArguments arguments;
+    arguments.SetInt("load_generator.channel", static_cast<int>(i));
+    stubs.push_back(ParkingManager::NewStub(grpc::CreateCustomChannel(
+        options.server_address, grpc::InsecureChannelCredentials(),
+        arguments)));
+  }
+
+  auto status = createLot(*stubs.front(), options);
+  if (!status.ok()) {
+    std::cerr << "Unable to create the lot: " << status.error_message()
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<ClientResults> results(options.clients);
+  std::vector<std::thread> clients;
+  auto measure_from = Clock::now() + options.warmup;
+  auto measure_to = measure_from + options.duration;
+  for (unsigned i = 0; i < options.clients; i++) {
+    clients.emplace_back([&, i]() {
+      runClient(*stubs[i % stubs.size()], options, measure_from, measure_to,
+                results[i]);
+    });
+  }
+  for (auto &client : clients) {
+    client.join();
+  }
+
+  report(results, options);
+  return 0;
+}
@@ -1,12 +1,124 @@
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 
+#include "include/async_server.hh"
+#include "include/metrics.hh"
 #include "include/parking_manager.hh"
 #include <grpcpp/server_builder.h>
 
-void RunServer() {
-  std::string server_address("0.0.0.0:50051");
-  services::ParkingManagerImpl service;
+namespace {
+/// Server options read from the command line
+struct ServerOptions {
+  std::string server_address{"0.0.0.0:50051"};
+  bool async{false};
+  unsigned cq_threads{std::thread::hardware_concurrency()};
+  component::Durability durability{component::Durability::GROUP};
+  component::SlotSelection selection{component::SlotSelection::LOWEST_LEVEL};
+  /// Workers of the pool the lots share, zero for the default one
+  unsigned pool_threads{0};
+  /// File the metrics are dumped to in the Prometheus text format, none if
+  /// empty
+  std::string metrics_file;
+};
+
+/// Interval between two dumps of the metrics file
+constexpr std::chrono::seconds metrics_dump_interval{10};
+
+void printUsage(const char *program) {
+  std::cerr << "Usage: " << program
+            << " [--mode=sync|async] [--cq-threads=N] [--address=HOST:PORT]"
+               " [--durability=event|group|periodic]"
+               " [--slot-selection=lowest|least-loaded|zone|nearest]"
+               " [--pool-threads=N] [--metrics-file=PATH]"
+            << std::endl;
+}
+
+/// Parses the command line, returns false on an unknown or malformed option
+auto parseOptions(int argc, char **argv, ServerOptions &options) -> bool {
+  constexpr std::string_view mode_flag = "--mode=";
+  constexpr std::string_view cq_threads_flag = "--cq-threads=";
+  constexpr std::string_view address_flag = "--address=";
+  constexpr std::string_view durability_flag = "--durability=";
+  constexpr std::string_view selection_flag = "--slot-selection=";
+  constexpr std::string_view pool_threads_flag = "--pool-threads=";
+  constexpr std::string_view metrics_file_flag = "--metrics-file=";
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg.substr(0, mode_flag.size()) == mode_flag) {
+      auto mode = arg.substr(mode_flag.size());
+      if (mode != "sync" && mode != "async") {
+        return false;
+      }
+      options.async = mode == "async";
+    } else if (arg.substr(0, cq_threads_flag.size()) == cq_threads_flag) {
+      try {
+        int cq_threads =
+            std::stoi(std::string(arg.substr(cq_threads_flag.size())));
+        if (cq_threads <= 0) {
+          return false;
+        }
+        options.cq_threads = static_cast<unsigned>(cq_threads);
+      } catch (const std::exception &) {
+        return false;
+      }
+    } else if (arg.substr(0, pool_threads_flag.size()) == pool_threads_flag) {
+      try {
+        int pool_threads =
+            std::stoi(std::string(arg.substr(pool_threads_flag.size())));
+        if (pool_threads <= 0) {
+          return false;
+        }
+        options.pool_threads = static_cast<unsigned>(pool_threads);
+      } catch (const std::exception &) {
+        return false;
+      }
+    } else if (arg.substr(0, metrics_file_flag.size()) == metrics_file_flag) {
+      options.metrics_file = arg.substr(metrics_file_flag.size());
+    } else if (arg.substr(0, address_flag.size()) == address_flag) {
+      options.server_address = arg.substr(address_flag.size());
+    } else if (arg.substr(0, durability_flag.size()) == durability_flag) {
+      auto durability = arg.substr(durability_flag.size());
+      if (durability == "event") {
+        options.durability = component::Durability::PER_EVENT;
+      } else if (durability == "group") {
+        options.durability = component::Durability::GROUP;
+      } else if (durability == "periodic") {
+        options.durability = component::Durability::PERIODIC;
+      } else {
+        return false;
+      }
+    } else if (arg.substr(0, selection_flag.size()) == selection_flag) {
+      auto selection = arg.substr(selection_flag.size());
+      if (selection == "lowest") {
+        options.selection = component::SlotSelection::LOWEST_LEVEL;
+      } else if (selection == "least-loaded") {
+        options.selection = component::SlotSelection::LEAST_LOADED_LEVEL;
+      } else if (selection == "zone") {
+        options.selection = component::SlotSelection::ZONE_PACKING;
+      } else if (selection == "nearest") {
+        options.selection = component::SlotSelection::NEAREST_ENTRANCE;
+      } else {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+void RunServer(const std::string &server_address,
+               component::Durability durability,
+               component::SlotSelection selection,
+               std::shared_ptr<component::ThreadPool> pool) {
+  services::ParkingManagerImpl service(durability, selection, std::move(pool));
 
   grpc::ServerBuilder builder;
   builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
@@ -16,7 +128,39 @@ void RunServer() {
   server->Wait();
 }
 
+void RunAsyncServer(const std::string &server_address, unsigned cq_threads,
+                    component::Durability durability,
+                    component::SlotSelection selection,
+                    std::shared_ptr<component::ThreadPool> pool) {
+  services::ParkingManagerImpl service(durability, selection, std::move(pool));
+  services::AsyncServer server(service, cq_threads);
+  server.run(server_address);
+}
+
 auto main(int argc, char **argv) -> int {
-  RunServer();
+  ServerOptions options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  std::shared_ptr<component::ThreadPool> pool;
+  if (options.pool_threads > 0) {
+    pool = std::make_shared<component::ThreadPool>(options.pool_threads);
+  } else {
+    pool = component::ThreadPool::getShared();
+  }
+  if (!options.metrics_file.empty()) {
+    pool->scheduleEvery(metrics_dump_interval, [path = options.metrics_file]() {
+      component::Metrics::writePrometheusFile(path);
+    });
+  }
+  if (options.async) {
+    RunAsyncServer(options.server_address, options.cq_threads,
+                   options.durability, options.selection, std::move(pool));
+  } else {
+    RunServer(options.server_address, options.durability, options.selection,
+              std::move(pool));
+  }
   return 0;
 }
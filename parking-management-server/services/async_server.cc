@@ -0,0 +1,101 @@
+#include "../include/async_server.hh"
+
+#include <iostream>
+
+namespace services {
+AsyncServer::AsyncServer(ParkingManagerImpl &impl, unsigned cq_threads)
+    : m_impl(impl), m_cq_threads(cq_threads == 0 ? 1 : cq_threads),
+      m_service(impl) {
+  bindMethod(m_create_parking_lot, &HybridService::RequestCreateParkingLot,
+             &ParkingManagerImpl::CreateParkingLot);
+  bindMethod(m_allocate_slot, &HybridService::RequestAllocateSlot,
+             &ParkingManagerImpl::AllocateSlot);
+  bindMethod(m_release_slot, &HybridService::RequestReleaseSlot,
+             &ParkingManagerImpl::ReleaseSlot);
+  bindMethod(m_get_stats, &HybridService::RequestGetStats,
+             &ParkingManagerImpl::GetStats);
+  bindMethod(m_batch_allocate, &HybridService::RequestBatchAllocate,
+             &ParkingManagerImpl::BatchAllocate);
+  bindMethod(m_batch_release, &HybridService::RequestBatchRelease,
+             &ParkingManagerImpl::BatchRelease);
+  bindMethod(m_reserve_slot, &HybridService::RequestReserveSlot,
+             &ParkingManagerImpl::ReserveSlot);
+  bindMethod(m_confirm_reservation, &HybridService::RequestConfirmReservation,
+             &ParkingManagerImpl::ConfirmReservation);
+  bindMethod(m_cancel_reservation, &HybridService::RequestCancelReservation,
+             &ParkingManagerImpl::CancelReservation);
+  bindMethod(m_pay, &HybridService::RequestPay, &ParkingManagerImpl::Pay);
+  bindMethod(m_set_tariff, &HybridService::RequestSetTariff,
+             &ParkingManagerImpl::SetTariff);
+  bindMethod(m_settle_sessions, &HybridService::RequestSettleSessions,
+             &ParkingManagerImpl::SettleSessions);
+  bindMethod(m_get_metrics, &HybridService::RequestGetMetrics,
+             &ParkingManagerImpl::GetMetrics);
+  bindMethod(m_reconfigure_level, &HybridService::RequestReconfigureLevel,
+             &ParkingManagerImpl::ReconfigureLevel);
+}
+
+void AsyncServer::armCalls(::grpc::ServerCompletionQueue *cq) {
+  new UnaryCall<ParkingLotDetails, Status>(m_create_parking_lot, cq);
+  new UnaryCall<AllocateRequest, Slot>(m_allocate_slot, cq);
+  new UnaryCall<ReleaseRequest, Status>(m_release_slot, cq);
+  new UnaryCall<StatsRequest, Stats>(m_get_stats, cq);
+  new UnaryCall<BatchAllocateRequest, BatchAllocateResponse>(m_batch_allocate,
+                                                             cq);
+  new UnaryCall<BatchReleaseRequest, BatchReleaseResponse>(m_batch_release, cq);
+  new UnaryCall<ReserveRequest, Reservation>(m_reserve_slot, cq);
+  new UnaryCall<ReservationRequest, Slot>(m_confirm_reservation, cq);
+  new UnaryCall<ReservationRequest, Status>(m_cancel_reservation, cq);
+  new UnaryCall<PayRequest, Receipt>(m_pay, cq);
+  new UnaryCall<TariffTable, Status>(m_set_tariff, cq);
+  new UnaryCall<SettleRequest, Settlement>(m_settle_sessions, cq);
+  new UnaryCall<MetricsRequest, MetricsReport>(m_get_metrics, cq);
+  new UnaryCall<ReconfigureRequest, LevelChanges>(m_reconfigure_level, cq);
+}
+
+void AsyncServer::drain(::grpc::ServerCompletionQueue *cq) {
+  void *tag = nullptr;
+  bool ok = false;
+  while (cq->Next(&tag, &ok)) {
+    static_cast<AsyncCall *>(tag)->proceed(ok);
+  }
+}
+
+void AsyncServer::run(const std::string &server_address) {
+  ::grpc::ServerBuilder builder;
+  builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
+  builder.RegisterService(&m_service);
+  for (unsigned i = 0; i < m_cq_threads; i++) {
+    m_cqs.push_back(builder.AddCompletionQueue());
+  }
+  m_server = builder.BuildAndStart();
+  std::cout << "Async server listening on " << server_address << " with "
+            << m_cq_threads << " completion queue threads" << std::endl;
+
+  for (auto &cq : m_cqs) {
+    armCalls(cq.get());
+    m_threads.emplace_back(drain, cq.get());
+  }
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+  m_threads.clear();
+}
+
+void AsyncServer::shutdown() {
+  if (m_server == nullptr) {
+    return;
+  }
+  m_server->Shutdown();
+  for (auto &cq : m_cqs) {
+    cq->Shutdown();
+  }
+}
+
+AsyncServer::~AsyncServer() {
+  shutdown();
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+} // namespace services
@@ -1,19 +1,17 @@
 #include "../include/parking_manager.hh"
 
-namespace services {
+#include <algorithm>
+#include <limits>
+#include <sstream>
 
-void ParkingManagerImpl::addParkingSlot(unsigned level, const std::string &vt,
-                                        const std::string &zone, unsigned id) {
-  m_parking_lot.addParking(std::to_string(level) + "_" + vt + "_" + zone + "_" +
-                           std::to_string(id));
-}
+namespace services {
 
-void ParkingManagerImpl::addParkingSlotsForVehicle(unsigned level,
-                                                   const std::string &vt,
-                                                   const std::string &zone,
-                                                   unsigned capacity) {
+void ParkingManagerImpl::addParkingSlotsForVehicle(
+    std::vector<std::string> &unique_ids, unsigned level, const std::string &vt,
+    std::string_view zone, unsigned capacity) {
   for (unsigned i = 0; i < capacity; i++) {
-    addParkingSlot(level, vt, zone, i);
+    unique_ids.push_back(std::to_string(level) + "_" + vt + "_" +
+                         std::string(zone) + "_" + std::to_string(i));
   }
 }
 
@@ -21,17 +19,460 @@ void ParkingManagerImpl::addParkingSlotsForVehicle(unsigned level,
 ParkingManagerImpl::CreateParkingLot(::grpc::ServerContext *context,
                                      const ::ParkingLotDetails *request,
                                      ::Status *response) {
-  m_parking_lot.setName(request->name());
-  m_parking_lot.setParkingLevelCount(request->levels());
+  RpcMetrics rpc(component::Histogram::RPC_CREATE_PARKING_LOT);
+  auto lot = m_lots.open(request->name(), request->levels());
+  if (!lot) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT, "Invalid parking lot name"};
+  }
+  lot->setParkingLevelCount(request->levels());
 
+  std::vector<std::string> unique_ids;
   for (unsigned level = 0; level < request->levels(); level++) {
     const auto &capacity = request->level_vehicle_capacity(level);
-    addParkingSlotsForVehicle(level, "MV", "A", capacity.minivan_capacity());
-    addParkingSlotsForVehicle(level, "CA", "B", capacity.car_capacity());
-    addParkingSlotsForVehicle(level, "MC", "C", capacity.motocycle_capacity());
-    addParkingSlotsForVehicle(level, "CY", "D", capacity.cycle_capacity());
+    const auto &zones = component::level_zones;
+    addParkingSlotsForVehicle(unique_ids, level, "MV",
+                              zones[component::VehicleType::MINIVAN],
+                              capacity.minivan_capacity());
+    addParkingSlotsForVehicle(unique_ids, level, "CA",
+                              zones[component::VehicleType::CAR],
+                              capacity.car_capacity());
+    addParkingSlotsForVehicle(unique_ids, level, "MC",
+                              zones[component::VehicleType::MOTORCYCLE],
+                              capacity.motocycle_capacity());
+    addParkingSlotsForVehicle(unique_ids, level, "CY",
+                              zones[component::VehicleType::CYCLE],
+                              capacity.cycle_capacity());
   }
+  lot->addParkingBatch(unique_ids.begin(), unique_ids.end());
+
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::AllocateSlot(::grpc::ServerContext *context,
+                                 const ::AllocateRequest *request,
+                                 ::Slot *response) {
+  RpcMetrics rpc(component::Histogram::RPC_ALLOCATE_SLOT);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  if (!isKnownVehicleType(request->vehicle_type())) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT, "Unknown vehicle type"};
+  }
+  auto vt = static_cast<component::VehicleType>(request->vehicle_type());
+
+  auto slot = lot->getParking(vt);
+  if (!slot.isOk()) {
+    return {::grpc::StatusCode::RESOURCE_EXHAUSTED, "No parking available"};
+  }
+  fillSlot(response, slot.getData());
+  return ::grpc::Status::OK;
+}
 
+void ParkingManagerImpl::fillSlot(::Slot *response,
+                                  const component::SlotView &slot) {
+  response->set_parking_id(slot.getParkingSlotId());
+  response->set_parking_level(slot.getParkingLevel());
+  response->set_vehicle_type(static_cast<::VehicleType>(slot.getVehicleType()));
+  // A held slot is not occupied yet
+  response->set_occupied_at(slot.getParkingTime().valueOr(0));
+}
+
+::grpc::Status
+ParkingManagerImpl::ReleaseSlot(::grpc::ServerContext *context,
+                                const ::ReleaseRequest *request,
+                                ::Status *response) {
+  RpcMetrics rpc(component::Histogram::RPC_RELEASE_SLOT);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  auto key = component::SlotKey::parse(request->parking_id());
+  if (!key.isOk()) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT, "Malformed parking id"};
+  }
+  if (!lot->returnParking(key.getData())) {
+    return {::grpc::StatusCode::FAILED_PRECONDITION,
+            "Parking slot is unknown or not occupied"};
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::BatchAllocate(::grpc::ServerContext *context,
+                                  const ::BatchAllocateRequest *request,
+                                  ::BatchAllocateResponse *response) {
+  RpcMetrics rpc(component::Histogram::RPC_BATCH_ALLOCATE);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  std::vector<component::VehicleType> vehicle_types;
+  vehicle_types.reserve(request->vehicle_types_size());
+  for (int vt : request->vehicle_types()) {
+    // Unknown types fail on their own without failing the whole batch
+    vehicle_types.push_back(isKnownVehicleType(vt)
+                                ? static_cast<component::VehicleType>(vt)
+                                : component::VehicleType::TOTALVEHICLETYPE);
+  }
+
+  for (const auto &slot : lot->getParkings(vehicle_types.begin(),
+                                           vehicle_types.end())) {
+    auto *result = response->add_results();
+    result->set_allocated(slot.isOk());
+    if (slot.isOk()) {
+      fillSlot(result->mutable_slot(), slot.getData());
+    }
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::BatchRelease(::grpc::ServerContext *context,
+                                 const ::BatchReleaseRequest *request,
+                                 ::BatchReleaseResponse *response) {
+  RpcMetrics rpc(component::Histogram::RPC_BATCH_RELEASE);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  std::vector<component::SlotKey> keys;
+  keys.reserve(request->parking_ids_size());
+  for (const auto &parking_id : request->parking_ids()) {
+    auto key = component::SlotKey::parse(parking_id);
+    keys.push_back(key.isOk() ? key.getData() : component::SlotKey());
+  }
+
+  for (bool released : lot->returnParkings(keys.begin(), keys.end())) {
+    response->add_released(released);
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::ReserveSlot(::grpc::ServerContext *context,
+                                const ::ReserveRequest *request,
+                                ::Reservation *response) {
+  RpcMetrics rpc(component::Histogram::RPC_RESERVE_SLOT);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  if (!isKnownVehicleType(request->vehicle_type())) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT, "Unknown vehicle type"};
+  }
+  auto vt = static_cast<component::VehicleType>(request->vehicle_type());
+  if (request->hold_seconds() <= 0) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT,
+            "Hold duration must be positive"};
+  }
+
+  auto hold = lot->reserve(vt, std::chrono::seconds(request->hold_seconds()));
+  if (!hold.isOk()) {
+    return {::grpc::StatusCode::RESOURCE_EXHAUSTED, "No parking available"};
+  }
+  response->set_reservation_id(hold.getData().id);
+  fillSlot(response->mutable_slot(), hold.getData().slot);
+  response->set_expires_at(hold.getData().expires_at);
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::ConfirmReservation(::grpc::ServerContext *context,
+                                       const ::ReservationRequest *request,
+                                       ::Slot *response) {
+  RpcMetrics rpc(component::Histogram::RPC_CONFIRM_RESERVATION);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  auto slot = lot->confirm(request->reservation_id());
+  if (!slot.isOk()) {
+    return {::grpc::StatusCode::NOT_FOUND,
+            "Reservation is unknown, cancelled or expired"};
+  }
+  fillSlot(response, slot.getData());
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::CancelReservation(::grpc::ServerContext *context,
+                                      const ::ReservationRequest *request,
+                                      ::Status *response) {
+  RpcMetrics rpc(component::Histogram::RPC_CANCEL_RESERVATION);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  if (!lot->cancel(request->reservation_id())) {
+    return {::grpc::StatusCode::NOT_FOUND,
+            "Reservation is unknown, confirmed or expired"};
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status ParkingManagerImpl::Pay(::grpc::ServerContext *context,
+                                       const ::PayRequest *request,
+                                       ::Receipt *response) {
+  RpcMetrics rpc(component::Histogram::RPC_PAY);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  auto key = component::SlotKey::parse(request->parking_id());
+  if (!key.isOk()) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT, "Malformed parking id"};
+  }
+  auto session = lot->checkout(key.getData());
+  if (!session.isOk()) {
+    return {::grpc::StatusCode::FAILED_PRECONDITION,
+            "Parking slot is unknown or not occupied"};
+  }
+  response->set_parking_id(request->parking_id());
+  response->set_vehicle_type(
+      static_cast<::VehicleType>(key.getData().getVehicleType()));
+  response->set_occupied_at(session.getData().occupied_at);
+  response->set_released_at(session.getData().released_at);
+  response->set_fee_cents(session.getData().fee_cents);
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status ParkingManagerImpl::SetTariff(::grpc::ServerContext *context,
+                                             const ::TariffTable *request,
+                                             ::Status *response) {
+  RpcMetrics rpc(component::Histogram::RPC_SET_TARIFF);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  component::TariffConfig config;
+  config.utc_offset_seconds = request->utc_offset_seconds();
+  for (const auto &vehicle : request->vehicles()) {
+    if (!isKnownVehicleType(vehicle.vehicle_type())) {
+      return {::grpc::StatusCode::INVALID_ARGUMENT, "Unknown vehicle type"};
+    }
+    auto vt = static_cast<component::VehicleType>(vehicle.vehicle_type());
+    auto &tariff = config.vehicles[vt];
+    tariff.daily_cap_cents = vehicle.daily_cap_cents();
+    for (const auto &band : vehicle.bands()) {
+      if (band.start_minute() < 0 || band.end_minute() < 0) {
+        return {::grpc::StatusCode::INVALID_ARGUMENT, "Negative minute"};
+      }
+      tariff.bands.push_back({static_cast<unsigned>(band.start_minute()),
+                              static_cast<unsigned>(band.end_minute()),
+                              band.cents_per_hour()});
+    }
+  }
+
+  auto tariff = component::Tariff::compile(config);
+  if (!tariff.isOk()) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT,
+            "Tariff band is empty or does not fit in a day"};
+  }
+  lot->setTariff(std::move(tariff).getData());
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::SettleSessions(::grpc::ServerContext *context,
+                                   const ::SettleRequest *request,
+                                   ::Settlement *response) {
+  RpcMetrics rpc(component::Histogram::RPC_SETTLE_SESSIONS);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  std::time_t to = request->to() != 0 ? request->to()
+                                      : std::numeric_limits<std::time_t>::max();
+  auto settled = lot->settle(request->from(), to);
+  response->set_total_cents(settled.total_cents);
+  response->set_sessions(settled.count);
+  return ::grpc::Status::OK;
+}
+
+void ParkingManagerImpl::fillOccupancyCount(
+    ::OccupancyCount *count, const component::ParkingLot &lot, unsigned level,
+    const component::VehicleType &vt) {
+  count->set_parking_level(level);
+  count->set_vehicle_type(static_cast<::VehicleType>(vt));
+  count->set_available(lot.getAvailableParkingForVehicleTypeAtLevel(level, vt));
+  count->set_occupied(lot.getOccupiedParkingForVehicleTypeAtLevel(level, vt));
+  count->set_held(lot.getHeldParkingForVehicleTypeAtLevel(level, vt));
+}
+
+::grpc::Status ParkingManagerImpl::GetStats(::grpc::ServerContext *context,
+                                            const ::StatsRequest *request,
+                                            ::Stats *response) {
+  RpcMetrics rpc(component::Histogram::RPC_GET_STATS);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  response->set_total_available(lot->getTotalAvailableParking());
+  response->set_total_occupied(lot->getTotalOccupiedParking());
+  response->set_total_held(lot->getTotalHeldParking());
+  for (unsigned level = 0; level < lot->getParkingLevelCount(); level++) {
+    for (unsigned vt = 0; vt < component::VehicleType::TOTALVEHICLETYPE;
+         vt++) {
+      fillOccupancyCount(response->add_counts(), *lot, level,
+                         static_cast<component::VehicleType>(vt));
+    }
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status ParkingManagerImpl::WatchOccupancy(
+    ::grpc::ServerContext *context, const ::WatchRequest *request,
+    ::grpc::ServerWriter<::OccupancyCount> *writer) {
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  // Subscribe before taking the snapshot so that no change slips in between
+  auto subscription = lot->subscribeOccupancy();
+
+  ::OccupancyCount count;
+  for (unsigned level = 0; level < lot->getParkingLevelCount(); level++) {
+    for (unsigned vt = 0; vt < component::VehicleType::TOTALVEHICLETYPE;
+         vt++) {
+      fillOccupancyCount(&count, *lot, level,
+                         static_cast<component::VehicleType>(vt));
+      if (!writer->Write(count)) {
+        return ::grpc::Status::OK;
+      }
+    }
+  }
+
+  while (!context->IsCancelled() && !subscription->isClosed()) {
+    for (const auto &update : subscription->wait(watch_poll_interval)) {
+      count.set_parking_level(update.level);
+      count.set_vehicle_type(static_cast<::VehicleType>(update.vt));
+      count.set_available(update.available);
+      count.set_occupied(update.occupied);
+      count.set_held(update.held);
+      if (!writer->Write(count)) {
+        return ::grpc::Status::OK;
+      }
+    }
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status ParkingManagerImpl::ExportSessions(
+    ::grpc::ServerContext *context, const ::ExportRequest *request,
+    ::grpc::ServerWriter<::SessionBatch> *writer) {
+  RpcMetrics rpc(component::Histogram::RPC_EXPORT_SESSIONS);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  int chunk_rows = request->chunk_rows() > 0
+                       ? std::min(request->chunk_rows(), max_export_chunk_rows)
+                       : export_chunk_rows;
+  std::time_t to = request->to() != 0 ? request->to()
+                                      : std::numeric_limits<std::time_t>::max();
+
+  ::SessionBatch batch;
+  bool open = true;
+  lot->exportSessions(
+      request->from(), to, static_cast<std::size_t>(chunk_rows),
+      [context, writer, &batch, &open](const component::SessionChunk &chunk) {
+        if (!open || context->IsCancelled()) {
+          open = false;
+          return;
+        }
+        batch.Clear();
+        for (std::size_t i = 0; i < chunk.size(); i++) {
+          batch.add_parking_ids(
+              component::SlotKey(chunk.slot_keys[i]).toString());
+          batch.add_parking_levels(chunk.parking_levels[i]);
+          batch.add_vehicle_types(
+              static_cast<::VehicleType>(chunk.vehicle_types[i]));
+        }
+        batch.mutable_occupied_at()->Add(chunk.occupied_at.begin(),
+                                         chunk.occupied_at.end());
+        batch.mutable_released_at()->Add(chunk.released_at.begin(),
+                                         chunk.released_at.end());
+        batch.mutable_fees_cents()->Add(chunk.fees_cents.begin(),
+                                        chunk.fees_cents.end());
+        open = writer->Write(batch);
+      });
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::GetMetrics(::grpc::ServerContext *context,
+                               const ::MetricsRequest *request,
+                               ::MetricsReport *response) {
+  RpcMetrics rpc(component::Histogram::RPC_GET_METRICS);
+  auto snapshot = component::Metrics::snapshot();
+  for (unsigned i = 0; i < component::COUNTER_COUNT; i++) {
+    auto *counter = response->add_counters();
+    counter->set_name(component::counter_names.at(i));
+    counter->set_value(static_cast<int64_t>(snapshot->counters.at(i)));
+  }
+  for (unsigned i = 0; i < component::GAUGE_COUNT; i++) {
+    auto *gauge = response->add_gauges();
+    gauge->set_name(component::gauge_names.at(i));
+    gauge->set_value(snapshot->gauges.at(i));
+  }
+  for (unsigned i = 0; i < component::HISTOGRAM_COUNT; i++) {
+    const auto &histogram = snapshot->histograms.at(i);
+    auto *latency = response->add_latencies();
+    latency->set_name(component::histogram_names.at(i));
+    latency->set_count(histogram.getCount());
+    latency->set_sum_ns(histogram.getSum());
+    latency->set_max_ns(histogram.getMax());
+    latency->set_p50_ns(histogram.getQuantile(0.5));
+    latency->set_p90_ns(histogram.getQuantile(0.9));
+    latency->set_p99_ns(histogram.getQuantile(0.99));
+    latency->set_p999_ns(histogram.getQuantile(0.999));
+  }
+  if (request->prometheus()) {
+    std::ostringstream text;
+    snapshot->writePrometheus(text);
+    response->set_prometheus_text(text.str());
+  }
+  return ::grpc::Status::OK;
+}
+
+::grpc::Status
+ParkingManagerImpl::ReconfigureLevel(::grpc::ServerContext *context,
+                                     const ::ReconfigureRequest *request,
+                                     ::LevelChanges *response) {
+  RpcMetrics rpc(component::Histogram::RPC_RECONFIGURE_LEVEL);
+  auto lot = m_lots.find(request->lot_id());
+  if (!lot) {
+    return unknownLot();
+  }
+  const auto &requested = request->capacity();
+  std::array<int32_t, component::TOTALVEHICLETYPE> capacities = {
+      requested.minivan_capacity(), requested.car_capacity(),
+      requested.motocycle_capacity(), requested.cycle_capacity()};
+  if (request->level() < 0 ||
+      std::any_of(capacities.begin(), capacities.end(),
+                  [](int32_t capacity) { return capacity < 0; })) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT,
+            "Negative parking level or capacity"};
+  }
+  if (std::any_of(capacities.begin(), capacities.end(), [](int32_t capacity) {
+        return static_cast<unsigned>(capacity) >=
+               component::max_level_capacity;
+      })) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT, "Capacity beyond the limit"};
+  }
+
+  component::LevelCapacity capacity;
+  std::copy(capacities.begin(), capacities.end(), capacity.begin());
+  auto changes = lot->reconfigureLevel(request->level(), capacity);
+  if (!changes.isOk()) {
+    return {::grpc::StatusCode::INVALID_ARGUMENT,
+            "Parking level beyond the limit"};
+  }
+  response->set_added(changes.getData().added);
+  response->set_retired(changes.getData().retired);
+  response->set_draining(changes.getData().draining);
   return ::grpc::Status::OK;
 }
-} // namespace services
\ No newline at end of file
+} // namespace services